@@ -9,7 +9,11 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shader.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
 #include "camera.hpp"
+#include "texture_registry.hpp"
+#include "frame_uniforms.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -48,7 +52,7 @@ int main()
     //-------------------------------------
     // glfw: initialize and configure
     //-------------------------------------
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -65,7 +69,6 @@ int main()
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -167,33 +170,11 @@ int main()
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<GLvoid*>(3 * sizeof(GLfloat)));
     glEnableVertexAttribArray(1);
 
-    //--------------------------------
-    // bind uniform buffer to point 0
-    //--------------------------------
-    auto uniformBlockIndexAxis = glGetUniformBlockIndex(axisShader.prog_id(), "Matrices");
-    glUniformBlockBinding(axisShader.prog_id(), uniformBlockIndexAxis, 0);
-
-    auto uniformBlockIndexCube = glGetUniformBlockIndex(defaultShader.prog_id(), "Matrices");
-    glUniformBlockBinding(defaultShader.prog_id(), uniformBlockIndexCube, 0);
-
-    //----------------------------------
-    // create buffer and bind to point 0
-    //----------------------------------
-    unsigned int uboMatrices;
-    glGenBuffers(1, &uboMatrices);
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), nullptr, GL_STATIC_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-    glBindBufferRange(GL_UNIFORM_BUFFER, 0, uboMatrices, 0, 2 * sizeof(glm::mat4));
-
-    //-----------------------------------
-    // fill the uniform buffer
-    //-----------------------------------
+    //-----------------------------------------------------------------------------
+    // both shaders declare the Frame block, Shader bound it to point 0 when linking
+    //-----------------------------------------------------------------------------
+    auto& frameUniforms = frame_uniforms::shared();
     auto projection = glm::perspective(glm::radians(camera.Zoom), static_cast<float>(SCR_WIDTH / SCR_HEIGHT), 0.1f, 100.0f);
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
     //--------------------------------------
     // lighting
@@ -218,10 +199,9 @@ int main()
         glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        auto view = camera.GetViewMatrix();
-        glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-        glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        // the camera of this frame, uploaded once for both shaders
+        frameUniforms.begin_frame();
+        frameUniforms.set_frame(camera, projection, currentFrame);
 
         // axis
         {
@@ -240,10 +220,11 @@ int main()
 
         // Swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
         glfwPollEvents();
     }
 
-    glfwTerminate();
+    frameUniforms.report();
     return 0;
 }
 
@@ -299,8 +280,10 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 
 unsigned int loadTexture(const std::filesystem::path& path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // shared with every Model and helper in the process, only the first request decodes the file
+    const auto [textureID, created] = texture_registry::shared().acquire(path);
+    if (!created)
+        return textureID;
 
     int width, height, nrComponents;
     if (const auto data = ::stbi_load(path.generic_string().c_str(), &width, &height, &nrComponents, 0))
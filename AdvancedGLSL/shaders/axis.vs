@@ -4,16 +4,19 @@ layout (location = 1) in vec3 aColor;
 
 out vec3 Color;
 
-layout (std140) uniform Matrices
+layout (std140) uniform Frame
 {
-    mat4 projection;
     mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec3 viewPos;
+    float time;
 };
 uniform mat4 model;
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = viewProj * model * vec4(aPos, 1.0);
 	Color = aColor;
 
 }
\ No newline at end of file
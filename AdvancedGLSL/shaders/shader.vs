@@ -1,14 +1,17 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-layout (std140) uniform Matrices
+layout (std140) uniform Frame
 {
-    mat4 projection;
     mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec3 viewPos;
+    float time;
 };
 uniform mat4 model;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProj * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
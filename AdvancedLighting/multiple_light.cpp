@@ -9,7 +9,10 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shader.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
 #include "camera.hpp"
+#include "texture_registry.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -43,7 +46,7 @@ int main()
     //-------------------------------------
     // glfw: initialize and configure
     //-------------------------------------
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -60,7 +63,6 @@ int main()
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -376,13 +378,13 @@ int main()
 
         // Swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
         glfwPollEvents();
     }
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteVertexArrays(1, &lightVAO);
     glDeleteBuffers(1, &vbo);
 
-    glfwTerminate();
     return 0;
 }
 
@@ -449,8 +451,10 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 
 unsigned int loadTexture(const std::filesystem::path& path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // shared with every Model and helper in the process, only the first request decodes the file
+    const auto [textureID, created] = texture_registry::shared().acquire(path);
+    if (!created)
+        return textureID;
 
     int width, height, nrComponents;
     if (const auto data = ::stbi_load(path.generic_string().c_str(), &width, &height, &nrComponents, 0))
@@ -9,7 +9,11 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shader.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
+#include "gpu_memory.hpp"
 #include "camera.hpp"
+#include "texture_registry.hpp"
 #include "vertices.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -42,7 +46,7 @@ int main()
     //-------------------------------------
     // glfw: initialize and configure
     //-------------------------------------
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -60,7 +64,6 @@ int main()
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -77,6 +80,9 @@ int main()
         std::cout << "Failed to initialize GLAD\n";
         return -1;
     }
+    // record the storage of every buffer, texture and renderbuffer, owned by the demo unless a scope says otherwise
+    gpu_memory::shared().install();
+    const gpu_memory::owner_scope owner{ PROJECT_NAME };
 
     //-------------------------------------
     // Create shader
@@ -141,6 +147,8 @@ int main()
     glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+    gpu_memory::shared().set_owner(gpu_memory::kind::texture, textureColorbuffer, "MSAA color");
+    gpu_memory::shared().set_owner(gpu_memory::kind::renderbuffer, rbo, "MSAA depth stencil");
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
     {
@@ -163,7 +171,8 @@ int main()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, screenTexture, 0);	
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, screenTexture, 0);
+    gpu_memory::shared().set_owner(gpu_memory::kind::texture, screenTexture, "MSAA resolve");	
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "ERROR::FRAMEBUFFER:: Intermediate framebuffer is not complete!" << std::endl;
@@ -231,10 +240,12 @@ int main()
 
         // Swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
         glfwPollEvents();
     }
 
-    glfwTerminate();
+    gpu_memory::shared().report();
+    gpu_memory::shared().save_json(PROJECT_NAME "_gpu_memory.json");
     return 0;
 }
 
@@ -290,8 +301,11 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 
 unsigned int loadTexture(const std::filesystem::path& path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // shared with every Model and helper in the process, only the first request decodes the file
+    const auto [textureID, created] = texture_registry::shared().acquire(path);
+    if (!created)
+        return textureID;
+    const gpu_memory::owner_scope owner{ path.generic_string() };
 
     int width, height, nrComponents;
     if (const auto data = ::stbi_load(path.generic_string().c_str(), &width, &height, &nrComponents, 0))
@@ -9,6 +9,8 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shader.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
 #include "camera.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -48,7 +50,7 @@ int main()
     //-------------------------------------
     // glfw: initialize and configure
     //-------------------------------------
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -65,7 +67,6 @@ int main()
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -275,12 +276,12 @@ int main()
 
         // Swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
         glfwPollEvents();
     }
     glDeleteVertexArrays(2, vao);
     glDeleteBuffers(1, &vbo);
 
-    glfwTerminate();
     return 0;
 }
 
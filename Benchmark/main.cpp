@@ -0,0 +1,1573 @@
+#include <format>
+#include <chrono>
+#include <random>
+#include <optional>
+#include <iostream>
+#include <string_view>
+#include <filesystem>
+
+// third_party
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "model.hpp"
+#include "gl_state.hpp"
+#include "gl_handle.hpp"
+#include "gpu_arena.hpp"
+#include "gpu_memory.hpp"
+#include "glfw_session.hpp"
+#include "frustum.hpp"
+#include "mesh_batch.hpp"
+#include "program_cache.hpp"
+#include "parallel_compile.hpp"
+#include "render_queue.hpp"
+#include "shader_variants.hpp"
+#include "stream_buffer.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#define ALLOCATION_COUNTER_IMPLEMENTATION
+#include "allocation_counter.hpp"
+
+#define PROJECT_NAME "Benchmark"
+
+// bundled models, relative to resource/
+constexpr std::string_view bundled_models[] = {
+    "nanosuit/nanosuit.obj",
+    "zzz/joe.pmx",
+    "planet/planet.obj",
+    "rock/rock.obj",
+};
+
+auto resource_path(std::string_view relative) -> std::filesystem::path
+{
+    return std::filesystem::current_path() / "../../../../resource" / relative;
+}
+
+// wall time of f in milliseconds, including the GL work it queued
+template <typename F>
+auto time_ms(F&& f) -> double
+{
+    const auto start = std::chrono::steady_clock::now();
+    std::forward<F>(f)();
+    glFinish();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//-------------------------------------
+// benchmarks
+//-------------------------------------
+
+// Model construction without (cold) and with (warm) the baked mesh cache
+void bench_mesh_cache()
+{
+    std::cout << std::format("{:<24}{:>12}{:>12}{:>10}{:>14}\n", "model", "cold ms", "warm ms", "speedup", "cache KiB");
+    for (auto name : bundled_models)
+    {
+        const auto path = resource_path(name);
+        const auto cache = mesh_cache::cache_path_for(path.generic_string());
+        std::filesystem::remove(cache);
+
+        const auto cold = time_ms([&] { Model model{ path }; });
+        const auto warm = time_ms([&] { Model model{ path }; });
+
+        std::error_code ec;
+        const auto cache_size = std::filesystem::file_size(cache, ec);
+        std::cout << std::format("{:<24}{:>12.2f}{:>12.2f}{:>9.2f}x{:>14}\n",
+                                 name, cold, warm, cold / warm, ec ? 0 : cache_size / 1024);
+    }
+}
+
+// Model construction with serial and thread pool texture decoding, meshes come from a warm cache
+void bench_texture_decode()
+{
+    std::cout << std::format("{} worker threads\n", thread_pool::shared().size());
+    std::cout << std::format("{:<24}{:>10}{:>12}{:>14}{:>10}\n", "model", "textures", "serial ms", "parallel ms", "speedup");
+    for (auto name : bundled_models)
+    {
+        const auto path = resource_path(name);
+        std::size_t texture_count = 0;
+        time_ms([&] { texture_count = Model{ path }.textures_loaded.size(); }); // warm the mesh cache and the file system
+
+        const auto serial = time_ms([&] { Model model{ path, false, { .parallelTextureDecode = false } }; });
+        const auto parallel = time_ms([&] { Model model{ path, false, { .parallelTextureDecode = true } }; });
+        std::cout << std::format("{:<24}{:>10}{:>12.2f}{:>14.2f}{:>9.2f}x\n",
+                                 name, texture_count, serial, parallel, serial / parallel);
+    }
+}
+
+// every bundled model alive at once, the texture registry shares files referenced by several of them
+void bench_texture_registry()
+{
+    const auto before = texture_registry::shared().stats();
+    std::vector<Model> models;
+    double total = 0.0;
+    for (auto name : { "nanosuit/nanosuit.obj", "nanosuit_reflection/nanosuit.obj", "planet/planet.obj", "rock/rock.obj", "nanosuit/nanosuit.obj" })
+    {
+        total += time_ms([&] { models.emplace_back(resource_path(name)); });
+    }
+    const auto after = texture_registry::shared().stats();
+    std::cout << std::format("{} models in {:.2f} ms: {} hits, {} misses, {} live textures\n",
+                             models.size(), total, after.hits - before.hits, after.misses - before.misses, after.live);
+}
+
+// aiMesh -> Vertex/index arrays, the old loader that push_back-ed one Vertex at a time, filling it field by field,
+// against Model's bulk conversion.
+// GL upload is left out, both paths hand the same arrays to glBufferData.
+void bench_mesh_build()
+{
+    constexpr int iterations = 20;
+    const auto path = resource_path("zzz/joe.pmx");
+
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path.generic_string(), Model::importFlags);
+    if (!scene || !scene->mRootNode)
+    {
+        std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << '\n';
+        return;
+    }
+
+    struct mesh_arrays
+    {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+    };
+
+    auto legacy = [](const aiMesh* mesh) {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+        {
+            Vertex vertex{};
+            vertex.Position = { mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z };
+            if (mesh->HasNormals())
+                vertex.Normal = { mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z };
+            if (mesh->mTextureCoords[0])
+            {
+                vertex.TexCoords = { mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y };
+                vertex.Tangent = { mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z };
+                vertex.Bitangent = { mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z };
+            }
+            vertices.push_back(vertex);
+        }
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+        {
+            aiFace face = mesh->mFaces[i];
+            for (unsigned int j = 0; j < face.mNumIndices; j++)
+                indices.push_back(face.mIndices[j]);
+        }
+        // the old Mesh constructor copied its const& arguments
+        mesh_arrays result;
+        result.vertices = vertices;
+        result.indices = indices;
+        return result;
+    };
+
+    auto bulk = [](const aiMesh* mesh) {
+        return mesh_arrays{ Model::convertVertices(mesh), Model::convertIndices(mesh) };
+    };
+
+    std::size_t vertex_count = 0;
+    for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+        vertex_count += scene->mMeshes[m]->mNumVertices;
+
+    auto run = [&](auto convert) {
+        return time_ms([&] {
+            for (int n = 0; n < iterations; n++)
+            {
+                std::vector<mesh_arrays> meshes;
+                for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+                    meshes.push_back(convert(scene->mMeshes[m]));
+            }
+        }) / iterations;
+    };
+    const auto legacy_ms = run(legacy);
+    const auto bulk_ms = run(bulk);
+    std::cout << std::format("joe.pmx: {} meshes, {} vertices\n", scene->mNumMeshes, vertex_count);
+    std::cout << std::format("{:<12}{:>12}\n{:<12}{:>12.3f}\n{:<12}{:>12.3f}\nspeedup {:.2f}x\n",
+                             "path", "ms / load", "push_back", legacy_ms, "bulk", bulk_ms, legacy_ms / bulk_ms);
+}
+
+// draw calls and texture binds per Model::Draw, one Mesh per aiMesh against one Mesh per material
+void bench_mesh_merge()
+{
+    auto binds = [](const Model& model) {
+        std::size_t count = 0;
+        for (const auto& mesh : model.meshes)
+            count += mesh.textures.size();
+        return count;
+    };
+
+    std::cout << std::format("{:<24}{:>14}{:>14}{:>14}{:>14}\n", "model", "draws", "merged draws", "binds", "merged binds");
+    for (auto name : bundled_models)
+    {
+        const Model separate{ resource_path(name) };
+        const Model merged{ resource_path(name), false, { .mergeByMaterial = true } };
+        std::cout << std::format("{:<24}{:>14}{:>14}{:>14}{:>14}\n",
+                                 name, separate.meshes.size(), merged.meshes.size(), binds(separate), binds(merged));
+    }
+}
+
+// vertex buffer memory and vertex fetch of the Full and Compact layouts.
+// fetch is the upper bound of one draw (every index fetches a vertex), the draws run with rasterization
+// disabled so the time is dominated by vertex fetch and shading.
+void bench_vertex_format()
+{
+    constexpr int draws = 200;
+    const Shader shader{
+        shader_entity<GL_VERTEX_SHADER>{ std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/vertex_fetch.vs" },
+        shader_entity<GL_FRAGMENT_SHADER>{ std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/vertex_fetch.fs" }
+    };
+    shader.set("mvp", glm::mat4{ 1.0f });
+
+    struct layout_stats
+    {
+        std::size_t bytes;
+        std::size_t fetch;
+        double ms;
+    };
+    auto measure = [&](const Model& model) {
+        layout_stats stats{};
+        for (const auto& mesh : model.meshes)
+        {
+            stats.bytes += mesh.vertexBufferSize();
+            stats.fetch += mesh.indices.size() * mesh.vertexStride();
+        }
+        glEnable(GL_RASTERIZER_DISCARD);
+        stats.ms = time_ms([&] {
+            for (int n = 0; n < draws; n++)
+            {
+                for (const auto& mesh : model.meshes)
+                {
+                    glBindVertexArray(mesh.VAO);
+                    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()), mesh.indexType,
+                                   reinterpret_cast<void*>(mesh.indexByteOffset(0)));
+                }
+            }
+        }) / draws;
+        glDisable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(0);
+        return stats;
+    };
+
+    std::cout << std::format("{:<24}{:>10}{:>12}{:>14}{:>12}{:>14}{:>12}{:>14}\n",
+                             "model", "vertices", "full KiB", "compact KiB", "full fetch", "compact fetch", "full ms", "compact ms");
+    for (auto name : bundled_models)
+    {
+        const Model full{ resource_path(name) };
+        const Model compact{ resource_path(name), false, { .compactVertices = true } };
+
+        std::size_t vertex_count = 0;
+        for (const auto& mesh : full.meshes)
+            vertex_count += mesh.vertices.size();
+
+        const auto f = measure(full);
+        const auto c = measure(compact);
+        std::cout << std::format("{:<24}{:>10}{:>12}{:>14}{:>9} KiB{:>11} KiB{:>12.3f}{:>14.3f}\n",
+                                 name, vertex_count, f.bytes / 1024, c.bytes / 1024, f.fetch / 1024, c.fetch / 1024, f.ms, c.ms);
+    }
+}
+
+// vertex count and vertex buffer memory with and without welding, per model and load mode
+void bench_vertex_weld()
+{
+    auto totals = [](const Model& model) {
+        std::size_t vertices = 0, bytes = 0;
+        for (const auto& mesh : model.meshes)
+        {
+            vertices += mesh.vertices.size();
+            bytes += mesh.vertexBufferSize();
+        }
+        return std::pair{ vertices, bytes };
+    };
+
+    std::cout << std::format("{:<24}{:>8}{:>12}{:>12}{:>10}{:>14}{:>10}\n",
+                             "model", "merged", "vertices", "welded", "ratio", "VBO KiB", "saved");
+    for (auto name : bundled_models)
+    {
+        for (bool merged : { false, true })
+        {
+            const Model raw{ resource_path(name), false, { .mergeByMaterial = merged, .weldVertices = false } };
+            const Model welded{ resource_path(name), false, { .mergeByMaterial = merged, .weldVertices = true } };
+            const auto [raw_vertices, raw_bytes] = totals(raw);
+            const auto [welded_vertices, welded_bytes] = totals(welded);
+            std::cout << std::format("{:<24}{:>8}{:>12}{:>12}{:>9.2f}x{:>14}{:>9} KiB\n",
+                                     name, merged, raw_vertices, welded_vertices,
+                                     static_cast<double>(raw_vertices) / std::max<std::size_t>(welded_vertices, 1),
+                                     welded_bytes / 1024, (raw_bytes - welded_bytes) / 1024);
+        }
+    }
+}
+
+// post-transform cache efficiency (FIFO, 16 and 32 entries) of the imported, cache optimized and
+// cache + overdraw optimized triangle orders, and the index buffer size with 16 bit indices
+void bench_vertex_cache()
+{
+    struct order_stats
+    {
+        vertex_cache_statistics fifo16;
+        vertex_cache_statistics fifo32;
+        std::size_t index_bytes;
+    };
+    auto measure = [](const Model& model) {
+        // weighted by triangles and vertices over all meshes
+        double misses16 = 0.0, misses32 = 0.0;
+        std::size_t triangles = 0, vertices = 0, index_bytes = 0;
+        for (const auto& mesh : model.meshes)
+        {
+            const auto s16 = analyze_vertex_cache(mesh.indices, mesh.vertices.size(), 16);
+            const auto s32 = analyze_vertex_cache(mesh.indices, mesh.vertices.size(), 32);
+            misses16 += s16.acmr * (mesh.indices.size() / 3);
+            misses32 += s32.acmr * (mesh.indices.size() / 3);
+            triangles += mesh.indices.size() / 3;
+            vertices += mesh.vertices.size();
+            index_bytes += mesh.indexBufferSize();
+        }
+        return order_stats{
+            { misses16 / triangles, misses16 / vertices },
+            { misses32 / triangles, misses32 / vertices },
+            index_bytes
+        };
+    };
+
+    std::cout << std::format("{:<24}{:<10}{:>10}{:>10}{:>10}{:>10}{:>12}\n",
+                             "model", "order", "ACMR 16", "ATVR 16", "ACMR 32", "ATVR 32", "index KiB");
+    for (auto name : bundled_models)
+    {
+        const Model imported{ resource_path(name), false, { .optimizeVertexCache = false } };
+        const Model cache{ resource_path(name), false, { .optimizeVertexCache = true } };
+        const Model overdraw{ resource_path(name), false, { .optimizeVertexCache = true, .optimizeOverdraw = true } };
+
+        std::size_t index_count = 0;
+        for (const auto& mesh : imported.meshes)
+            index_count += mesh.indices.size();
+        std::cout << std::format("{:<24}{:<10}{:>10}{:>10}{:>10}{:>10}{:>12}\n",
+                                 name, "32 bit", "", "", "", "", index_count * sizeof(unsigned int) / 1024);
+        for (const auto& [order, model] : { std::pair{ "imported", &imported }, std::pair{ "cache", &cache }, std::pair{ "overdraw", &overdraw } })
+        {
+            const auto stats = measure(*model);
+            std::cout << std::format("{:<24}{:<10}{:>10.3f}{:>10.3f}{:>10.3f}{:>10.3f}{:>12}\n",
+                                     "", order, stats.fifo16.acmr, stats.fifo16.atvr, stats.fifo32.acmr, stats.fifo32.atvr, stats.index_bytes / 1024);
+        }
+    }
+}
+
+// level of detail chains of the bundled models: triangles and error per level, and the distance from which
+// a level is selected for a 1600 pixel high viewport at the default field of view. load time covers the simplifier.
+void bench_lod()
+{
+    constexpr float viewport_height = 1600.0f;
+    const Camera camera;
+    const auto pixel_scale = lod_pixel_scale(camera, viewport_height);
+
+    std::cout << std::format("{:<24}{:>6}{:>12}{:>12}{:>14}\n", "model", "lod", "triangles", "error", "distance");
+    for (auto name : bundled_models)
+    {
+        const auto path = resource_path(name);
+        std::filesystem::remove(mesh_cache::cache_path_for(path.generic_string()));
+        const auto without_ms = time_ms([&] { Model model{ path, false, { .generateLods = false } }; });
+        std::filesystem::remove(mesh_cache::cache_path_for(path.generic_string()));
+        std::optional<Model> model;
+        const auto with_ms = time_ms([&] { model.emplace(path); });
+
+        // per level over all meshes, meshes with shorter chains keep drawing their coarsest level
+        std::size_t levels = 0;
+        for (const auto& mesh : model->meshes)
+            levels = std::max(levels, mesh.lods.size());
+        for (std::size_t lod = 0; lod < levels; lod++)
+        {
+            std::size_t triangles = 0;
+            float error = 0.0f;
+            for (const auto& mesh : model->meshes)
+            {
+                const auto& level = mesh.lods[std::min(lod, mesh.lods.size() - 1)];
+                triangles += level.indexCount / 3;
+                error = std::max(error, level.error);
+            }
+            std::cout << std::format("{:<24}{:>6}{:>12}{:>12.5f}{:>14.2f}\n",
+                                     lod == 0 ? name : "", lod, triangles, error, error * pixel_scale);
+        }
+        std::cout << std::format("{:<24}cold load {:.2f} ms without, {:.2f} ms with levels of detail\n", "", without_ms, with_ms);
+    }
+}
+
+// Model construction against Model::loadAsync from a warm cache: total time until the model is usable,
+// and how much of it the main thread spent blocked (start plus the polls that ran the GL uploads)
+void bench_async_load()
+{
+    std::cout << std::format("{:<24}{:>12}{:>12}{:>16}\n", "model", "sync ms", "async ms", "main thread ms");
+    for (auto name : bundled_models)
+    {
+        const auto path = resource_path(name);
+        time_ms([&] { Model model{ path }; }); // warm the mesh cache and the file system
+
+        const auto sync = time_ms([&] { Model model{ path }; });
+
+        double blocked = 0.0;
+        const auto async = time_ms([&] {
+            std::optional<async_result<std::unique_ptr<Model>>> load;
+            blocked += time_ms([&] { load.emplace(start(Model::loadAsync(path))); });
+            while (!load->ready())
+                blocked += time_ms([] { main_thread_queue::shared().poll(); });
+        });
+        std::cout << std::format("{:<24}{:>12.2f}{:>12.2f}{:>16.2f}\n", name, sync, async, blocked);
+    }
+}
+
+// heap allocations and CPU time of drawing every mesh of a model once per frame. the first frame resolves the
+// binding tables of Mesh::Draw, later frames reuse them. legacy rebuilds the sampler names and looks them up
+// on every draw, like Mesh::Draw did before the tables
+void bench_draw_allocations()
+{
+    constexpr int frames = 100;
+    Shader shader{
+        shader_entity<GL_VERTEX_SHADER>{ std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/vertex_fetch.vs" },
+        shader_entity<GL_FRAGMENT_SHADER>{ std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/material.fs" }
+    };
+    shader.set("mvp", glm::mat4{ 1.0f });
+
+    auto draw_legacy = [&](const Mesh& mesh) {
+        unsigned int diffuseNr = 1, specularNr = 1, normalNr = 1, heightNr = 1;
+        for (unsigned int i = 0; i < mesh.textures.size(); i++)
+        {
+            std::string number;
+            std::string name = mesh.textures[i].type;
+            if (name == "diffuse")
+                number = std::to_string(diffuseNr++);
+            else if (name == "specular")
+                number = std::to_string(specularNr++);
+            else if (name == "normal")
+                number = std::to_string(normalNr++);
+            else if (name == "height")
+                number = std::to_string(heightNr++);
+            glActiveTexture(GL_TEXTURE0 + i);
+            shader.set("material" + number + '.' + name, i);
+            glBindTexture(GL_TEXTURE_2D, mesh.textures[i].id);
+        }
+        glBindVertexArray(mesh.VAO);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.lods[0].indexCount), mesh.indexType,
+                       reinterpret_cast<void*>(mesh.indexByteOffset(0)));
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    };
+
+    std::cout << std::format("{:<24}{:>8}{:>14}{:>16}{:>14}{:>12}{:>10}\n",
+                             "model", "meshes", "first frame", "legacy/frame", "allocs/frame", "legacy ms", "ms");
+    glEnable(GL_RASTERIZER_DISCARD);
+    for (auto name : bundled_models)
+    {
+        Model model{ resource_path(name) };
+
+        std::size_t legacy_allocations = 0, allocations = 0;
+        const auto legacy_ms = time_ms([&] {
+            legacy_allocations = count_allocations([&] {
+                for (int n = 0; n < frames; n++)
+                {
+                    for (const auto& mesh : model.meshes)
+                        draw_legacy(mesh);
+                }
+            });
+        }) / frames;
+        const auto first_frame = count_allocations([&] { model.Draw(shader); });
+        const auto ms = time_ms([&] {
+            allocations = count_allocations([&] {
+                for (int n = 0; n < frames; n++)
+                    model.Draw(shader);
+            });
+        }) / frames;
+
+        std::cout << std::format("{:<24}{:>8}{:>14}{:>16}{:>14}{:>12.3f}{:>10.3f}\n", name, model.meshes.size(), first_frame,
+                                 legacy_allocations / frames, allocations / frames, legacy_ms, ms);
+    }
+    glDisable(GL_RASTERIZER_DISCARD);
+}
+
+// the Shader::set calls of one frame of MultipleLight and of GammaCorrection, on their own shaders without drawing.
+// legacy binds the program and looks the name up on every call, taking it as std::string, like Shader::set used to
+void bench_uniform_set()
+{
+    constexpr int frames = 10000;
+    auto load = [](std::string_view demo, std::string_view vs, std::string_view fs) {
+        const auto dir = std::filesystem::current_path() / "../../../.." / demo / "shaders";
+        return Shader{ shader_entity<GL_VERTEX_SHADER>{ dir / vs }, shader_entity<GL_FRAGMENT_SHADER>{ dir / fs } };
+    };
+
+    const Camera camera{ { 0.0f, 0.0f, 3.0f } };
+    const auto view = camera.GetViewMatrix();
+    const auto projection = glm::perspective(glm::radians(camera.Zoom), 1.0f, 0.1f, 100.0f);
+    const glm::vec3 lights[] = { { 0.7f, 0.2f, 2.0f }, { 2.3f, -3.3f, -4.0f }, { -4.0f, 2.0f, -12.0f }, { 0.0f, 0.0f, -3.0f } };
+
+    const auto axis = load("MultipleLight", "axis.vs", "axis.fs");
+    const auto lighting = load("MultipleLight", "material.vs", "material.fs");
+    const auto lightCube = load("MultipleLight", "light_cube.vs", "light_cube.fs");
+    auto multiple_light = [&](auto&& set) {
+        set(axis, "projection", projection);
+        set(axis, "view", view);
+        set(axis, "model", glm::mat4{ 1.0f });
+        set(lighting, "dirLight.direction", glm::vec3{ -0.2f, -1.0f, -0.3f });
+        set(lighting, "dirLight.ambient", glm::vec3{ 0.05f, 0.05f, 0.05f });
+        set(lighting, "dirLight.diffuse", glm::vec3{ 0.4f, 0.4f, 0.4f });
+        set(lighting, "dirLight.specular", glm::vec3{ 0.5f, 0.5f, 0.5f });
+        set(lighting, "pointLights[0].position", lights[0]);
+        set(lighting, "pointLights[0].ambient", glm::vec3{ 0.05f, 0.05f, 0.05f });
+        set(lighting, "pointLights[0].diffuse", glm::vec3{ 0.8f, 0.8f, 0.8f });
+        set(lighting, "pointLights[0].specular", glm::vec3{ 1.0f, 1.0f, 1.0f });
+        set(lighting, "pointLights[0].constant", 1.0f);
+        set(lighting, "pointLights[0].linear", 0.09f);
+        set(lighting, "pointLights[0].quadratic", 0.032f);
+        set(lighting, "pointLights[1].position", lights[1]);
+        set(lighting, "pointLights[1].ambient", glm::vec3{ 0.05f, 0.05f, 0.05f });
+        set(lighting, "pointLights[1].diffuse", glm::vec3{ 0.8f, 0.8f, 0.8f });
+        set(lighting, "pointLights[1].specular", glm::vec3{ 1.0f, 1.0f, 1.0f });
+        set(lighting, "pointLights[1].constant", 1.0f);
+        set(lighting, "pointLights[1].linear", 0.09f);
+        set(lighting, "pointLights[1].quadratic", 0.032f);
+        set(lighting, "pointLights[2].position", lights[2]);
+        set(lighting, "pointLights[2].ambient", glm::vec3{ 0.05f, 0.05f, 0.05f });
+        set(lighting, "pointLights[2].diffuse", glm::vec3{ 0.8f, 0.8f, 0.8f });
+        set(lighting, "pointLights[2].specular", glm::vec3{ 1.0f, 1.0f, 1.0f });
+        set(lighting, "pointLights[2].constant", 1.0f);
+        set(lighting, "pointLights[2].linear", 0.09f);
+        set(lighting, "pointLights[2].quadratic", 0.032f);
+        set(lighting, "pointLights[3].position", lights[3]);
+        set(lighting, "pointLights[3].ambient", glm::vec3{ 0.05f, 0.05f, 0.05f });
+        set(lighting, "pointLights[3].diffuse", glm::vec3{ 0.8f, 0.8f, 0.8f });
+        set(lighting, "pointLights[3].specular", glm::vec3{ 1.0f, 1.0f, 1.0f });
+        set(lighting, "pointLights[3].constant", 1.0f);
+        set(lighting, "pointLights[3].linear", 0.09f);
+        set(lighting, "pointLights[3].quadratic", 0.032f);
+        set(lighting, "spotLight.position", camera.Position);
+        set(lighting, "spotLight.direction", camera.Front);
+        set(lighting, "spotLight.ambient", glm::vec3{ 0.0f, 0.0f, 0.0f });
+        set(lighting, "spotLight.diffuse", glm::vec3{ 1.0f, 1.0f, 1.0f });
+        set(lighting, "spotLight.specular", glm::vec3{ 1.0f, 1.0f, 1.0f });
+        set(lighting, "spotLight.constant", 1.0f);
+        set(lighting, "spotLight.linear", 0.09f);
+        set(lighting, "spotLight.quadratic", 0.032f);
+        set(lighting, "spotLight.cutOff", glm::cos(glm::radians(12.5f)));
+        set(lighting, "spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+        set(lighting, "viewPos", camera.Position);
+        set(lighting, "projection", projection);
+        set(lighting, "view", view);
+        for (int i = 0; i < 10; i++)
+            set(lighting, "model", glm::rotate(glm::mat4{ 1.0f }, glm::radians(20.0f * i), glm::vec3{ 1.0f, 0.3f, 0.5f }));
+        set(lightCube, "projection", projection);
+        set(lightCube, "view", view);
+        set(lightCube, "cubeColor", glm::vec3{ 1.0f });
+        for (const auto& light : lights)
+            set(lightCube, "model", glm::translate(glm::mat4{ 1.0f }, light));
+    };
+
+    const auto floor = load("GammaCorrection", "floor.vs", "floor.fs");
+    const auto lightSrc = load("GammaCorrection", "light_cube.vs", "light_cube.fs");
+    auto gamma_correction = [&](auto&& set) {
+        set(axis, "projection", projection);
+        set(axis, "view", view);
+        set(axis, "model", glm::mat4{ 1.0f });
+        set(floor, "view", view);
+        set(floor, "projection", projection);
+        set(floor, "model", glm::mat4{ 1.0f });
+        set(floor, "viewPos", camera.Position);
+        set(lightSrc, "projection", projection);
+        set(lightSrc, "view", view);
+        set(lightSrc, "cubeColor", glm::vec3{ 1.0f });
+        for (const auto& light : lights)
+        {
+            set(lightSrc, "model", glm::translate(glm::mat4{ 1.0f }, light));
+            set(lightSrc, "cubeColor", light);
+        }
+    };
+
+    auto cached = [](const Shader& shader, uniform_name name, const auto& value) { shader.set(name, value); };
+    auto legacy = [](const Shader& shader, const std::string& name, const auto& value) {
+        using T = std::remove_cvref_t<decltype(value)>;
+        glUseProgram(shader);
+        const auto location = glGetUniformLocation(shader, name.c_str());
+        if constexpr (std::integral<T>)
+            glUniform1i(location, static_cast<int>(value));
+        else if constexpr (std::is_same_v<T, float>)
+            glUniform1f(location, value);
+        else if constexpr (std::is_same_v<T, glm::vec3>)
+            glUniform3fv(location, 1, glm::value_ptr(value));
+        else
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+    };
+
+    std::cout << std::format("{:<18}{:>8}{:>14}{:>14}{:>16}{:>14}\n", "frame", "sets", "legacy ns", "cached ns", "legacy allocs", "cached allocs");
+    auto run = [&](std::string_view name, auto&& frame) {
+        std::size_t sets = 0;
+        frame([&](auto&&...) { ++sets; });
+
+        auto measure = [&](auto&& set, std::size_t& allocations) {
+            return time_ms([&] {
+                allocations = count_allocations([&] {
+                    for (int n = 0; n < frames; n++)
+                        frame(set);
+                });
+            }) * 1e6 / (static_cast<double>(frames) * sets);
+        };
+        frame(cached); // first lookups
+        std::size_t legacy_allocations = 0, cached_allocations = 0;
+        const auto legacy_ns = measure(legacy, legacy_allocations);
+        const auto cached_ns = measure(cached, cached_allocations);
+        std::cout << std::format("{:<18}{:>8}{:>14.1f}{:>14.1f}{:>16}{:>14}\n", name, sets, legacy_ns, cached_ns,
+                                 legacy_allocations / frames, cached_allocations / frames);
+    };
+    run("MultipleLight", multiple_light);
+    run("GammaCorrection", gamma_correction);
+}
+
+// The uniforms of a MultipleLight frame, set by name (Shader::set, a table lookup and an upload per call) and through
+// handles taken once (Shader::write, uploaded together by the next use()). The lights move and the models turn every
+// frame, the rest stays. uploads counts the glUniform calls reaching GL per frame, unchanged values are left out by both
+void bench_shader_parameters()
+{
+    constexpr int frames = 10000;
+    constexpr int models = 10;
+    const auto dir = std::filesystem::current_path() / "../../../../MultipleLight/shaders";
+    const Shader lighting{ shader_entity<GL_VERTEX_SHADER>{ dir / "material.vs" }, shader_entity<GL_FRAGMENT_SHADER>{ dir / "material.fs" } };
+    lighting.parameters().report("MultipleLight material");
+
+    const Camera camera{ { 0.0f, 0.0f, 3.0f } };
+    const auto view = camera.GetViewMatrix();
+    const auto projection = glm::perspective(glm::radians(camera.Zoom), 1.0f, 0.1f, 100.0f);
+    const glm::vec3 lights[] = { { 0.7f, 0.2f, 2.0f }, { 2.3f, -3.3f, -4.0f }, { -4.0f, 2.0f, -12.0f }, { 0.0f, 0.0f, -3.0f } };
+    const glm::vec3 diffuse{ 0.8f, 0.8f, 0.8f };
+    auto moving = [](int frame) { return glm::vec3{ std::sin(frame * 0.01f), 0.0f, 0.0f }; };
+    auto turned = [](int frame, int i) {
+        return glm::rotate(glm::mat4{ 1.0f }, glm::radians(20.0f * i + frame), glm::vec3{ 1.0f, 0.3f, 0.5f });
+    };
+
+    auto by_name = [&](int frame) {
+        lighting.set("pointLights[0].position", lights[0] + moving(frame));
+        lighting.set("pointLights[0].diffuse", diffuse);
+        lighting.set("pointLights[1].position", lights[1] + moving(frame));
+        lighting.set("pointLights[1].diffuse", diffuse);
+        lighting.set("pointLights[2].position", lights[2] + moving(frame));
+        lighting.set("pointLights[2].diffuse", diffuse);
+        lighting.set("pointLights[3].position", lights[3] + moving(frame));
+        lighting.set("pointLights[3].diffuse", diffuse);
+        lighting.set("viewPos", camera.Position);
+        lighting.set("projection", projection);
+        lighting.set("view", view);
+        for (int i = 0; i < models; i++)
+            lighting.set("model", turned(frame, i));
+    };
+
+    struct point_light
+    {
+        shader_parameter<glm::vec3> position;
+        shader_parameter<glm::vec3> diffuse;
+    };
+    std::array<point_light, 4> point_lights;
+    for (std::size_t i = 0; i < point_lights.size(); i++)
+    {
+        point_lights[i] = { lighting.parameter<glm::vec3>(std::format("pointLights[{}].position", i)),
+                            lighting.parameter<glm::vec3>(std::format("pointLights[{}].diffuse", i)) };
+    }
+    const auto viewPos = lighting.parameter<glm::vec3>("viewPos");
+    const auto projectionParameter = lighting.parameter<glm::mat4>("projection");
+    const auto viewParameter = lighting.parameter<glm::mat4>("view");
+    const auto model = lighting.parameter<glm::mat4>("model");
+    auto indexed = [&](int frame) {
+        for (std::size_t i = 0; i < point_lights.size(); i++)
+        {
+            lighting.write(point_lights[i].position, lights[i] + moving(frame));
+            lighting.write(point_lights[i].diffuse, diffuse);
+        }
+        lighting.write(viewPos, camera.Position);
+        lighting.write(projectionParameter, projection);
+        lighting.write(viewParameter, view);
+        // a draw follows every model, each one is uploaded on its own
+        for (int i = 0; i < models; i++)
+        {
+            lighting.write(model, turned(frame, i));
+            lighting.use();
+        }
+    };
+
+    constexpr int sets = 8 + 3 + models;
+    std::cout << std::format("{:<10}{:>8}{:>10}{:>10}\n", "frame", "sets", "ns/set", "uploads");
+    auto run = [&](std::string_view name, auto&& frame) {
+        frame(-1);
+        const auto before = lighting.parameters().stats().uploads;
+        const auto ms = time_ms([&] {
+            for (int n = 0; n < frames; n++)
+                frame(n);
+        });
+        const auto uploads = lighting.parameters().stats().uploads - before;
+        std::cout << std::format("{:<10}{:>8}{:>10.1f}{:>10}\n", name, sets, ms * 1e6 / (static_cast<double>(frames) * sets),
+                                 uploads / frames);
+    };
+    run("by name", by_name);
+    run("indexed", indexed);
+}
+
+// state calls of a PointShadows like frame per model: a depth and a lit pass, each drawing five cubes, the room cube
+// with culling disabled and the model. raw goes straight to the driver, filtered through gl_state
+void bench_gl_state()
+{
+    constexpr int frames = 1000;
+    auto load = [] {
+        return Shader{
+            shader_entity<GL_VERTEX_SHADER>{ std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/vertex_fetch.vs" },
+            shader_entity<GL_FRAGMENT_SHADER>{ std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/material.fs" }
+        };
+    };
+    auto depth = load();
+    auto lit = load();
+    GLuint cubeVAO, woodTexture, shadowTexture, depthMapFBO;
+    glGenVertexArrays(1, &cubeVAO);
+    glGenTextures(1, &woodTexture);
+    glGenTextures(1, &shadowTexture);
+    glGenFramebuffers(1, &depthMapFBO);
+
+    auto renderScene = [&](const Shader& shader) {
+        shader.use();
+        glDisable(GL_CULL_FACE);
+        glBindVertexArray(cubeVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glBindVertexArray(0);
+        glEnable(GL_CULL_FACE);
+        for (int i = 0; i < 5; i++)
+        {
+            glBindVertexArray(cubeVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glBindVertexArray(0);
+        }
+    };
+    auto frame = [&](Model& model) {
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+        renderScene(depth);
+        model.Draw(depth);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, woodTexture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, shadowTexture);
+        renderScene(lit);
+        model.Draw(lit);
+    };
+
+    auto& state = gl_state::shared();
+    std::cout << std::format("{:<24}{:>12}{:>12}{:>12}{:>10}{:>12}\n", "model", "calls", "issued", "skipped", "raw ms", "filtered ms");
+    glEnable(GL_RASTERIZER_DISCARD);
+    for (auto name : bundled_models)
+    {
+        Model model{ resource_path(name) };
+        frame(model);
+
+        const auto raw_ms = time_ms([&] {
+            for (int n = 0; n < frames; n++)
+                frame(model);
+        }) / frames;
+
+        state.install();
+        frame(model);
+        state.end_frame();
+        const auto filtered_ms = time_ms([&] {
+            for (int n = 0; n < frames; n++)
+            {
+                frame(model);
+                state.end_frame();
+            }
+        }) / frames;
+        state.uninstall();
+
+        const auto [issued, skipped] = state.last_frame();
+        std::cout << std::format("{:<24}{:>12}{:>12}{:>12}{:>10.3f}{:>12.3f}\n", name, issued + skipped, issued, skipped,
+                                 raw_ms, filtered_ms);
+    }
+    glDisable(GL_RASTERIZER_DISCARD);
+    glDeleteFramebuffers(1, &depthMapFBO);
+    glDeleteTextures(1, &shadowTexture);
+    glDeleteTextures(1, &woodTexture);
+    glDeleteVertexArrays(1, &cubeVAO);
+}
+
+// the two passes of a ShadowMapping frame per model, drawn in the hand written order of the demo (immediate) and
+// through render_queue. calls counts every state call reaching gl_state, issued the ones it let through
+void bench_render_queue()
+{
+    constexpr int frames = 1000;
+    auto load = [] {
+        return Shader{
+            shader_entity<GL_VERTEX_SHADER>{ std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/vertex_fetch.vs" },
+            shader_entity<GL_FRAGMENT_SHADER>{ std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/material.fs" }
+        };
+    };
+    auto depth = load();
+    auto entity = load();
+    auto man = load();
+    auto lightSrc = load();
+    auto axis = load();
+    GLuint vertexArrays[3], textures[2];
+    glGenVertexArrays(3, vertexArrays);
+    glGenTextures(2, textures);
+    const auto [planeVAO, cubeVAO, axisVAO] = vertexArrays;
+    const render_queue::material sceneMaterial{ { { 0, GL_TEXTURE_2D, textures[0] }, { 1, GL_TEXTURE_2D, textures[1] } } };
+    const Camera camera{ { 0.0f, 0.0f, 3.0f } };
+    const glm::mat4 cubes[] = {
+        glm::scale(glm::translate(glm::mat4{ 1.0f }, { 0.0f, 1.5f, 0.0f }), glm::vec3{ 0.5f }),
+        glm::scale(glm::translate(glm::mat4{ 1.0f }, { 2.0f, 0.0f, 1.0f }), glm::vec3{ 0.5f }),
+        glm::scale(glm::translate(glm::mat4{ 1.0f }, { -1.0f, 0.0f, 2.0f }), glm::vec3{ 0.25f }),
+    };
+    const auto light = glm::scale(glm::translate(glm::mat4{ 1.0f }, { -6.0f, 4.0f, 0.0f }), glm::vec3{ 0.1f });
+    const auto man_model = glm::scale(glm::translate(glm::mat4{ 1.0f }, { -2.0f, -0.5f, 0.0f }), glm::vec3{ 0.2f });
+
+    auto immediate = [&](Model& model) {
+        auto scene = [&](const Shader& shader) {
+            shader.set("model", glm::mat4{ 1.0f });
+            glBindVertexArray(planeVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            for (const auto& cube : cubes)
+            {
+                shader.set("model", cube);
+                glBindVertexArray(cubeVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+                glBindVertexArray(0);
+            }
+        };
+        depth.use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, textures[0]);
+        scene(depth);
+        depth.set("model", man_model);
+        model.Draw(depth, camera, man_model, 720.0f);
+
+        entity.use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, textures[0]);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        scene(entity);
+        man.set("model", man_model);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        model.Draw(man, camera, man_model, 720.0f);
+        lightSrc.use();
+        lightSrc.set("model", light);
+        glBindVertexArray(cubeVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        glBindVertexArray(0);
+        axis.use();
+        axis.set("model", glm::mat4{ 1.0f });
+        glBindVertexArray(axisVAO);
+        glDrawArrays(GL_LINES, 0, 6);
+    };
+
+    render_queue queue;
+    auto queued = [&](Model& model) {
+        auto scene = [&](const Shader& shader, const render_queue::material* material) {
+            queue.submit(shader, material, planeVAO, GL_TRIANGLES, 0, 6, glm::mat4{ 1.0f });
+            for (const auto& cube : cubes)
+                queue.submit(shader, material, cubeVAO, GL_TRIANGLES, 0, 36, cube);
+        };
+        queue.begin({ -6.0f, 4.0f, 0.0f }, 15.0f);
+        scene(depth, nullptr);
+        model.Submit(queue, depth, camera, man_model, 720.0f);
+        queue.flush();
+
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, textures[1]);
+        queue.begin(camera.Position, 100.0f);
+        scene(entity, &sceneMaterial);
+        model.Submit(queue, man, camera, man_model, 720.0f);
+        queue.submit(lightSrc, nullptr, cubeVAO, GL_TRIANGLES, 0, 36, light);
+        queue.submit(axis, nullptr, axisVAO, GL_LINES, 0, 6, glm::mat4{ 1.0f }, { .layer = 1 });
+        queue.flush();
+    };
+
+    auto& state = gl_state::shared();
+    std::cout << std::format("{:<24}{:>16}{:>16}{:>14}{:>14}{:>14}{:>12}\n", "model", "immediate calls",
+                             "queued calls", "imm. issued", "queue issued", "immediate ms", "queued ms");
+    glEnable(GL_RASTERIZER_DISCARD);
+    state.install();
+    for (auto name : bundled_models)
+    {
+        Model model{ resource_path(name) };
+        auto measure = [&](auto&& frame, gl_state::statistics& calls) {
+            frame(model);
+            state.end_frame();
+            const auto ms = time_ms([&] {
+                for (int n = 0; n < frames; n++)
+                {
+                    frame(model);
+                    state.end_frame();
+                }
+            }) / frames;
+            calls = state.last_frame();
+            return ms;
+        };
+        gl_state::statistics immediate_calls{}, queued_calls{};
+        const auto immediate_ms = measure(immediate, immediate_calls);
+        const auto queued_ms = measure(queued, queued_calls);
+
+        std::cout << std::format("{:<24}{:>16}{:>16}{:>14}{:>14}{:>14.3f}{:>12.3f}\n", name,
+                                 immediate_calls.issued + immediate_calls.skipped, queued_calls.issued + queued_calls.skipped,
+                                 immediate_calls.issued, queued_calls.issued, immediate_ms, queued_ms);
+    }
+    state.uninstall();
+    glDisable(GL_RASTERIZER_DISCARD);
+    queue.report("both passes");
+    glDeleteTextures(2, textures);
+    glDeleteVertexArrays(3, vertexArrays);
+}
+
+// every mesh of a model drawn one by one (a depth pass through Model::Draw) against one multi draw of its mesh_batch,
+// with a per draw tint fetched by draw id. calls counts the state calls reaching gl_state per frame, on top of one
+// draw per mesh or the one multi draw
+void bench_multi_draw()
+{
+    constexpr int frames = 1000;
+    auto load = [](std::string_view vertex) {
+        return Shader{
+            shader_entity<GL_VERTEX_SHADER>{ std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders" / vertex },
+            shader_entity<GL_FRAGMENT_SHADER>{ std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/material.fs" }
+        };
+    };
+    auto perMesh = load("vertex_fetch.vs");
+    auto packed = load("draw_id.vs");
+    packed.set("drawData", 4);
+
+    auto& state = gl_state::shared();
+    std::cout << std::format("{} path\n", mesh_batch::indirect_supported() ? "glMultiDrawElementsIndirect" : "glMultiDrawElementsBaseVertex");
+    std::cout << std::format("{:<24}{:>8}{:>14}{:>14}{:>12}{:>12}\n", "model", "meshes", "per mesh calls", "packed calls",
+                             "per mesh ms", "packed ms");
+    glEnable(GL_RASTERIZER_DISCARD);
+    state.install();
+    for (auto name : bundled_models)
+    {
+        Model model{ resource_path(name), false, { .packMeshes = true } };
+        std::vector<glm::vec4> tints(model.meshes.size());
+        for (std::size_t i = 0; i < tints.size(); i++)
+            tints[i] = glm::vec4{ static_cast<float>(i % 3 == 0), static_cast<float>(i % 3 == 1), static_cast<float>(i % 3 == 2), 1.0f };
+        model.batch.set_draw_data(tints);
+
+        auto measure = [&](auto&& frame) {
+            frame();
+            state.end_frame();
+            const auto ms = time_ms([&] {
+                for (int n = 0; n < frames; n++)
+                {
+                    frame();
+                    state.end_frame();
+                }
+            }) / frames;
+            const auto calls = state.last_frame();
+            return std::pair{ calls.issued + calls.skipped, ms };
+        };
+        const auto [per_mesh_calls, per_mesh_ms] = measure([&] {
+            perMesh.use();
+            for (const auto& mesh : model.meshes)
+            {
+                glBindVertexArray(mesh.VAO);
+                mesh.DrawElements(0);
+            }
+        });
+        const auto [packed_calls, packed_ms] = measure([&] {
+            packed.use();
+            model.batch.bind_draw_data(4);
+            model.batch.draw();
+        });
+
+        std::cout << std::format("{:<24}{:>8}{:>14}{:>14}{:>12.3f}{:>12.3f}\n", name, model.meshes.size(), per_mesh_calls,
+                                 packed_calls, per_mesh_ms, packed_ms);
+    }
+    state.uninstall();
+    glDisable(GL_RASTERIZER_DISCARD);
+}
+
+// per frame uniform data of many draws: one 128 byte block (two matrices) per draw, bound before a point draw.
+// glBufferData respecifies a buffer per draw, glBufferSubData updates one the previous frame may still read,
+// stream_buffer writes into a region nothing reads any more
+void bench_stream_buffer()
+{
+    constexpr int frames = 200;
+    constexpr std::size_t draws = 512;
+    struct Matrices
+    {
+        glm::mat4 projection;
+        glm::mat4 view;
+    };
+    const Matrices block{ glm::mat4{ 1.0f }, glm::mat4{ 2.0f } };
+    const Shader shader{ shader_entity<GL_VERTEX_SHADER>{ std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/matrices.vs" } };
+    glUniformBlockBinding(shader.prog_id(), glGetUniformBlockIndex(shader.prog_id(), "Matrices"), 0);
+    shader.use();
+    GLuint vertexArray, uniformBuffer;
+    glGenVertexArrays(1, &vertexArray);
+    glGenBuffers(1, &uniformBuffer);
+    glBindVertexArray(vertexArray);
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    auto measure = [&](auto&& frame) {
+        frame();
+        glFinish();
+        return time_ms([&] {
+            for (int n = 0; n < frames; n++)
+                frame();
+            glFinish();
+        }) / frames;
+    };
+    const auto buffer_data_ms = measure([&] {
+        for (std::size_t i = 0; i < draws; i++)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(Matrices), &block, GL_DYNAMIC_DRAW);
+            glBindBufferBase(GL_UNIFORM_BUFFER, 0, uniformBuffer);
+            glDrawArrays(GL_POINTS, 0, 1);
+        }
+    });
+    glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Matrices), nullptr, GL_DYNAMIC_DRAW);
+    const auto sub_data_ms = measure([&] {
+        for (std::size_t i = 0; i < draws; i++)
+        {
+            glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Matrices), &block);
+            glBindBufferBase(GL_UNIFORM_BUFFER, 0, uniformBuffer);
+            glDrawArrays(GL_POINTS, 0, 1);
+        }
+    });
+    stream_buffer stream{ draws * std::max(sizeof(Matrices), stream_buffer::uniform_alignment()) };
+    const auto stream_ms = measure([&] {
+        stream.begin_frame();
+        for (std::size_t i = 0; i < draws; i++)
+        {
+            glBindBufferRange(GL_UNIFORM_BUFFER, 0, stream.id(), stream.write_uniform(block), sizeof(Matrices));
+            glDrawArrays(GL_POINTS, 0, 1);
+        }
+        stream.end_frame();
+    });
+
+    glDisable(GL_RASTERIZER_DISCARD);
+    std::cout << std::format("{} draws per frame, ms per frame\n", draws);
+    std::cout << std::format("{:>14}{:>16}{:>16}\n", "glBufferData", "glBufferSubData", "stream_buffer");
+    std::cout << std::format("{:>14.3f}{:>16.3f}{:>16.3f}\n", buffer_data_ms, sub_data_ms, stream_ms);
+    stream.report("uniforms");
+    glDeleteBuffers(1, &uniformBuffer);
+    glDeleteVertexArrays(1, &vertexArray);
+}
+
+// a frame of every model drawn mesh by mesh with its own textures (Model::Draw) against one multi draw with the
+// textures packed into arrays (Model::DrawAtlased). binds counts the texture binds gl_state let through
+void bench_material_atlas()
+{
+    constexpr int frames = 1000;
+    auto load = [](std::string_view vertex, std::string_view fragment) {
+        const auto shaders = std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders";
+        return Shader{ shader_entity<GL_VERTEX_SHADER>{ shaders / vertex }, shader_entity<GL_FRAGMENT_SHADER>{ shaders / fragment } };
+    };
+    auto perMesh = load("vertex_fetch.vs", "material.fs");
+    auto atlased = load("atlas.vs", "atlas.fs");
+    const Camera camera{ { 0.0f, 0.0f, 3.0f } };
+    const glm::mat4 placement{ 1.0f };
+
+    // binds of one frame, texture binds are what gl_state filters besides programs and vertex arrays
+    std::size_t binds = 0;
+    static std::size_t* counter = nullptr;
+    counter = &binds;
+    static PFNGLBINDTEXTUREPROC bindTexture = nullptr;
+    bindTexture = glad_glBindTexture;
+    glad_glBindTexture = [](GLenum target, GLuint texture) {
+        ++*counter;
+        bindTexture(target, texture);
+    };
+
+    auto& state = gl_state::shared();
+    std::cout << std::format("{:<24}{:>8}{:>12}{:>12}{:>12}{:>12}{:>12}{:>12}\n", "model", "meshes", "mesh binds", "atlas binds",
+                             "mesh draws", "atlas draws", "mesh ms", "atlas ms");
+    glEnable(GL_RASTERIZER_DISCARD);
+    state.install();
+    for (auto name : bundled_models)
+    {
+        Model model{ resource_path(name), false, { .atlasMaterials = true } };
+        auto measure = [&](auto&& frame) {
+            frame();
+            state.end_frame();
+            binds = 0;
+            frame();
+            state.end_frame();
+            const auto frame_binds = binds;
+            const auto ms = time_ms([&] {
+                for (int n = 0; n < frames; n++)
+                {
+                    frame();
+                    state.end_frame();
+                }
+            }) / frames;
+            return std::pair{ frame_binds, ms };
+        };
+        const auto [mesh_binds, mesh_ms] = measure([&] { model.Draw(perMesh, camera, placement, 720.0f); });
+        const auto [atlas_binds, atlas_ms] = measure([&] { model.DrawAtlased(atlased, camera, placement, 720.0f); });
+
+        std::cout << std::format("{:<24}{:>8}{:>12}{:>12}{:>12}{:>12}{:>12.3f}{:>12.3f}\n", name, model.meshes.size(), mesh_binds,
+                                 atlas_binds, model.meshes.size(), model.atlas.empty() ? model.meshes.size() : 1, mesh_ms, atlas_ms);
+        model.atlas.report(name);
+    }
+    state.uninstall();
+    glad_glBindTexture = bindTexture;
+    glDisable(GL_RASTERIZER_DISCARD);
+}
+
+// GL buffers behind the meshes of every model, one per mesh stream as before the arena against the arena blocks,
+// and the GL objects loading and unloading them all leaves behind. The churn times the offset allocator alone
+void bench_gpu_arena()
+{
+    constexpr int reloads = 5;
+    constexpr std::size_t operations = 200000;
+    auto& vertices = gpu_arena::vertices();
+    auto& indices = gpu_arena::indices();
+    auto& objects = gl_objects::shared();
+    auto live = [&] {
+        return std::array{ objects.live(gl_object::buffer), objects.live(gl_object::vertex_array), objects.live(gl_object::texture),
+                           objects.live(gl_object::program) };
+    };
+
+    std::cout << std::format("{:<24}{:>8}{:>18}{:>14}{:>12}\n", "model", "meshes", "per mesh buffers", "arena blocks", "arena MiB");
+    for (auto name : bundled_models)
+    {
+        const Model model{ resource_path(name) };
+        std::size_t buffers = 0;
+        for (const auto& mesh : model.meshes)
+            buffers += 2 + (mesh.layout == VertexLayout::Compact && mesh.skinned ? 1 : 0);
+        std::cout << std::format("{:<24}{:>8}{:>18}{:>14}{:>12.2f}\n", name, model.meshes.size(), buffers,
+                                 vertices.stats().blocks + indices.stats().blocks,
+                                 (vertices.stats().used + indices.stats().used) / 1048576.0);
+    }
+
+    const auto before = live();
+    const auto ms = time_ms([&] {
+        for (int n = 0; n < reloads; n++)
+        {
+            for (auto name : bundled_models)
+                const Model model{ resource_path(name) };
+            objects.end_frame();
+        }
+    });
+    const auto after = live();
+    std::cout << std::format("{} reloads of every model in {:.1f} ms, live objects afterwards (before)\n", reloads, ms);
+    for (std::size_t kind = 0; kind < after.size(); kind++)
+        std::cout << std::format("  {:<16}{:>8} ({})\n", gl_objects::names[kind], after[kind], before[kind]);
+    vertices.report();
+    indices.report();
+
+    // random sizes from a vertex buffer of a small mesh to one of a large mesh, allocated and freed at random
+    offset_allocator allocator{ gpu_arena::default_block_size };
+    std::vector<std::pair<std::size_t, std::size_t>> allocations;
+    std::mt19937 rng{ 1 };
+    std::uniform_int_distribution<std::size_t> sizes{ 256, 256 * 1024 };
+    std::size_t failed = 0;
+    const auto churn_ms = time_ms([&] {
+        for (std::size_t n = 0; n < operations; n++)
+        {
+            if (allocations.empty() || rng() % 2)
+            {
+                const auto size = sizes(rng);
+                if (const auto offset = allocator.allocate(size, 16))
+                    allocations.emplace_back(*offset, size);
+                else
+                    ++failed;
+            }
+            else
+            {
+                const auto i = rng() % allocations.size();
+                allocator.free(allocations[i].first, allocations[i].second);
+                allocations[i] = allocations.back();
+                allocations.pop_back();
+            }
+        }
+    });
+    std::cout << std::format("offset allocator: {} operations in {:.2f} ms, {:.0f} ns each, {} failed, {} live in {} free ranges, "
+                             "largest {:.2f} MiB\n",
+                             operations, churn_ms, churn_ms * 1e6 / operations, failed, allocations.size(), allocator.free_ranges(),
+                             allocator.largest_free() / 1048576.0);
+}
+
+// GPU memory recorded for every bundled model, written as a snapshot to compare between builds, and what the
+// recording costs a glBufferData call (a binding query each)
+void bench_gpu_memory()
+{
+    constexpr int calls = 10000;
+    auto& memory = gpu_memory::shared();
+    memory.install();
+    {
+        std::vector<Model> models;
+        for (auto name : bundled_models)
+            models.emplace_back(resource_path(name), false, ModelOptions{ .packMeshes = true });
+        memory.report(10);
+        memory.save_json(PROJECT_NAME "_gpu_memory.json");
+    }
+
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    const std::array<std::byte, 256> data{};
+    auto measure = [&] {
+        return time_ms([&] {
+            for (int n = 0; n < calls; n++)
+                glBufferData(GL_ARRAY_BUFFER, data.size(), data.data(), GL_STREAM_DRAW);
+        }) * 1000.0 / calls;
+    };
+    const auto recorded_us = measure();
+    memory.uninstall();
+    const auto plain_us = measure();
+    glDeleteBuffers(1, &buffer);
+    std::cout << std::format("glBufferData of {} bytes: {:.3f} us plain, {:.3f} us recorded\n", data.size(), plain_us, recorded_us);
+}
+
+// the programs of the ShadowMapping and PointShadows demos
+struct demo_program
+{
+    std::string_view project;
+    std::string_view name;
+    bool geometry;
+
+    [[nodiscard]] auto stage(std::string_view extension) const -> std::filesystem::path
+    {
+        return std::filesystem::current_path() / "../../../.." / project / "shaders" / std::format("{}.{}", name, extension);
+    }
+};
+
+constexpr demo_program demo_programs[] = {
+    { "ShadowMapping", "depth_view", false }, { "ShadowMapping", "depth", false },
+    { "ShadowMapping", "shader", false },     { "ShadowMapping", "light_cube", false },
+    { "ShadowMapping", "man", false },        { "ShadowMapping", "axis", false },
+    { "PointShadows", "depth_view", false },  { "PointShadows", "depth", true },
+    { "PointShadows", "shader", false },      { "PointShadows", "light_cube", false },
+    { "PointShadows", "man", false },
+};
+
+// Shader construction of the ShadowMapping and PointShadows programs, compiled from source with an empty program
+// cache (cold) and loaded from the binaries the cold run stored (warm). Drivers keep a shader cache of their own, so
+// cold is not the first run on a machine, it is what is left once the driver cache is warm as well.
+void bench_program_cache()
+{
+    auto build_all = [&] {
+        std::vector<Shader> shaders;
+        for (const auto& p : demo_programs)
+        {
+            if (p.geometry)
+                shaders.emplace_back(shader_entity<GL_VERTEX_SHADER>{ p.stage("vs") }, shader_entity<GL_FRAGMENT_SHADER>{ p.stage("fs") },
+                                     shader_entity<GL_GEOMETRY_SHADER>{ p.stage("gs") });
+            else
+                shaders.emplace_back(shader_entity<GL_VERTEX_SHADER>{ p.stage("vs") }, shader_entity<GL_FRAGMENT_SHADER>{ p.stage("fs") });
+        }
+    };
+
+    auto& cache = program_cache::shared();
+    if (!cache.enabled())
+    {
+        std::cout << "program cache: the context supports no program binary format\n";
+        return;
+    }
+    const auto directory = cache.directory();
+    cache.set_directory(std::filesystem::current_path() / "program_cache_benchmark");
+    cache.clear();
+    std::cout << std::format("{:<8}{:>10}{:>10}{:>10}{:>12}\n", "cache", "programs", "loaded", "compiled", "ms");
+    for (const auto run : { "cold", "warm" })
+    {
+        cache.reset_stats();
+        const auto ms = time_ms(build_all);
+        const auto& stats = cache.stats();
+        std::cout << std::format("{:<8}{:>10}{:>10}{:>10}{:>12.2f}\n", run, std::size(demo_programs), stats.loaded, stats.compiled, ms);
+    }
+    cache.clear();
+    cache.set_directory(directory);
+}
+
+// Startup of the ShadowMapping and PointShadows programs, each one compiled and checked before the next (serial)
+// against all of them submitted first and checked after (parallel_compile.hpp). Every run adds a comment of its own
+// to the sources, so neither the program cache nor the shader cache of the driver has seen them.
+void bench_parallel_compile()
+{
+    struct sources
+    {
+        std::string vertex;
+        std::string fragment;
+        std::string geometry;
+    };
+    auto read = [](const std::filesystem::path& path) { return shader_preprocessor::run(read_shader_file(path), path.parent_path()); };
+    std::vector<sources> programs;
+    for (const auto& p : demo_programs)
+        programs.push_back({ read(p.stage("vs")), read(p.stage("fs")), p.geometry ? read(p.stage("gs")) : std::string{} });
+
+    auto& cache = program_cache::shared();
+    auto& compile = parallel_compile::shared();
+    cache.set_enabled(false);
+    int run = 0;
+    auto build_all = [&] {
+        const auto salt = std::format("\n// run {}\n", run++);
+        std::vector<Shader> shaders;
+        for (const auto& p : programs)
+        {
+            if (p.geometry.empty())
+                shaders.emplace_back(shader_source<GL_VERTEX_SHADER>{ p.vertex + salt }, shader_source<GL_FRAGMENT_SHADER>{ p.fragment + salt });
+            else
+                shaders.emplace_back(shader_source<GL_VERTEX_SHADER>{ p.vertex + salt }, shader_source<GL_FRAGMENT_SHADER>{ p.fragment + salt },
+                                     shader_source<GL_GEOMETRY_SHADER>{ p.geometry + salt });
+        }
+        // first use, where a deferred build waits
+        for (const auto& shader : shaders)
+            shader.use();
+    };
+
+    constexpr int rounds = 5;
+    double serial_ms = 0.0;
+    double parallel_ms = 0.0;
+    for (int round = 0; round < rounds; round++)
+    {
+        compile.disable();
+        serial_ms += time_ms(build_all);
+        compile.enable(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
+        parallel_ms += time_ms(build_all);
+    }
+    compile.disable();
+    cache.set_enabled(true);
+    std::cout << std::format("{} programs, {}: serial {:.2f} ms, submitted up front {:.2f} ms\n", std::size(demo_programs),
+                             compile.extension() ? "KHR_parallel_shader_compile" : "no parallel compile extension",
+                             serial_ms / rounds, parallel_ms / rounds);
+    compile.report();
+}
+
+// Fragment cost of the PointShadows lit shader with the 20-tap PCF path on and off, compiled as variants with and
+// without #define PCF against the same source branching on a uniform bool pcfEnabled, as the shader was before it went
+// through shader_variants. Every pass is a full screen quad of 1024x1024 fragments sampling a depth cube map.
+void bench_shader_variants()
+{
+    constexpr GLsizei size = 1024;
+    constexpr GLsizei cube_size = 512;
+    constexpr int passes = 100;
+    const auto shaders = std::filesystem::current_path() / "../../../../PointShadows/shaders";
+
+    shader_variants variants{ { "PCF" }, shader_entity<GL_VERTEX_SHADER>{ shaders / "shader.vs" },
+                              shader_entity<GL_FRAGMENT_SHADER>{ shaders / "shader.fs" } };
+    variants.prepare(1);
+
+    // the #ifndef PCF / #else / #endif of shadow.glsl turned back into a branch on a uniform
+    auto branching = shader_preprocessor::run(read_shader_file(shaders / "shader.fs"), shaders);
+    auto replace = [&](std::string_view line, std::string_view with, std::size_t from) {
+        const auto at = branching.find(line, from);
+        assert(at != std::string::npos);
+        branching.replace(at, line.size(), with);
+        return at;
+    };
+    replace("#endif", "", replace("#else", "else", replace("#ifndef PCF", "if (!pcfEnabled)", 0)));
+    replace("uniform float far_plane;", "uniform float far_plane;\nuniform bool pcfEnabled;", 0);
+    const Shader uniform_branch{ shader_source<GL_VERTEX_SHADER>{ shader_preprocessor::run(read_shader_file(shaders / "shader.vs"), shaders) },
+                                 shader_source<GL_FRAGMENT_SHADER>{ branching } };
+
+    // a quad facing the light, half of the cube map closer than the fragments so both shadow outcomes are taken
+    GLuint vao, vbo, cube, texture, fbo, color;
+    const float quad[] = {
+        -1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+         1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
+        -1.0f,  1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+         1.0f,  1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
+    };
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), nullptr);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), reinterpret_cast<void*>(6 * sizeof(float)));
+
+    std::vector<float> depths(static_cast<std::size_t>(cube_size) * cube_size);
+    for (std::size_t i = 0; i < depths.size(); i++)
+        depths[i] = (i / cube_size) % 64 < 32 ? 0.01f : 1.0f;
+    glGenTextures(1, &cube);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cube);
+    for (GLenum face = 0; face < 6; face++)
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT, cube_size, cube_size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, depths.data());
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    const unsigned char white[] = { 255, 255, 255, 255 };
+    glGenTextures(1, &texture);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glViewport(0, 0, size, size);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+
+    auto measure = [&](const Shader& shader, bool pcf) {
+        shader.use();
+        shader.set("diffuseTexture", 0);
+        shader.set("depthMap", 1);
+        shader.set("projection", glm::mat4{ 1.0f });
+        shader.set("view", glm::mat4{ 1.0f });
+        shader.set("model", glm::mat4{ 1.0f });
+        shader.set("lightPos", glm::vec3{ 0.0f, 0.0f, 2.0f });
+        shader.set("viewPos", glm::vec3{ 0.0f, 0.0f, 3.0f });
+        shader.set("far_plane", 25.0f);
+        if (&shader == &uniform_branch)
+            shader.set("pcfEnabled", pcf);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        return time_ms([&] {
+            for (int n = 0; n < passes; n++)
+                glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }) / passes;
+    };
+
+    std::cout << std::format("{}x{} fragments per pass\n", size, size);
+    std::cout << std::format("{:<10}{:>18}{:>14}{:>10}\n", "shadow", "uniform branch ms", "variant ms", "speedup");
+    for (const bool pcf : { false, true })
+    {
+        const auto branch_ms = measure(uniform_branch, pcf);
+        const auto variant_ms = measure(variants.get(pcf ? 1 : 0), pcf);
+        std::cout << std::format("{:<10}{:>18.3f}{:>14.3f}{:>9.2f}x\n", pcf ? "pcf" : "1 tap", branch_ms, variant_ms, branch_ms / variant_ms);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &color);
+    glDeleteTextures(1, &texture);
+    glDeleteTextures(1, &cube);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+}
+
+// Bounding spheres tested against a camera frustum one at a time and four per step (frustum::cull_spheres), for a
+// ring of rocks around the camera like Instancing and for spheres scattered in a cube around it. Both paths have to
+// agree on every sphere, the visible share is what a draw of the instances would be left with
+void bench_frustum_culling()
+{
+    constexpr int rounds = 200;
+    const Camera camera{ { 0.0f, 0.0f, 0.0f } };
+    const auto view = frustum::of(camera, glm::perspective(glm::radians(camera.Zoom), 1.0f, 0.1f, 100.0f));
+
+    std::mt19937 random{ 42 };
+    std::uniform_real_distribution<float> unit{ 0.0f, 1.0f };
+    std::vector<glm::vec4> ring(10'000);
+    for (std::size_t i = 0; i < ring.size(); i++)
+    {
+        const auto angle = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(ring.size());
+        ring[i] = { std::sin(angle) * 50.0f + unit(random) * 5.0f - 2.5f, unit(random) - 0.5f,
+                    std::cos(angle) * 50.0f + unit(random) * 5.0f - 2.5f, 0.05f + unit(random) * 0.2f };
+    }
+    std::vector<glm::vec4> scattered(1'000'000);
+    for (auto& sphere : scattered)
+        sphere = { unit(random) * 200.0f - 100.0f, unit(random) * 200.0f - 100.0f, unit(random) * 200.0f - 100.0f, unit(random) };
+
+    std::cout << std::format("{:<12}{:>10}{:>10}{:>14}{:>12}{:>10}\n", "spheres", "count", "visible", "scalar ns/1k", "sse ns/1k", "speedup");
+    for (const auto& [name, spheres] : { std::pair{ "ring", &ring }, std::pair{ "scattered", &scattered } })
+    {
+        std::vector<std::uint8_t> scalar(spheres->size()), batched(spheres->size());
+        std::size_t visible = 0;
+        auto measure = [&](auto&& cull) {
+            return time_ms([&] {
+                for (int n = 0; n < rounds; n++)
+                    visible = cull();
+            }) * 1e6 / (static_cast<double>(rounds) * static_cast<double>(spheres->size()) / 1000.0);
+        };
+        const auto scalar_ns = measure([&] { return view.cull_spheres_scalar(*spheres, scalar); });
+        const auto batched_ns = measure([&] { return view.cull_spheres(*spheres, batched); });
+        if (scalar != batched)
+            std::cout << std::format("{}: the batched test disagrees with the scalar one\n", name);
+        std::cout << std::format("{:<12}{:>10}{:>10}{:>14.1f}{:>12.1f}{:>9.2f}x\n", name, spheres->size(), visible, scalar_ns, batched_ns,
+                                 scalar_ns / batched_ns);
+    }
+}
+
+struct benchmark
+{
+    std::string_view name;
+    void (*run)();
+};
+
+constexpr benchmark benchmarks[] = {
+    { "mesh_cache", bench_mesh_cache },
+    { "texture_decode", bench_texture_decode },
+    { "texture_registry", bench_texture_registry },
+    { "mesh_build", bench_mesh_build },
+    { "mesh_merge", bench_mesh_merge },
+    { "vertex_format", bench_vertex_format },
+    { "vertex_weld", bench_vertex_weld },
+    { "vertex_cache", bench_vertex_cache },
+    { "lod", bench_lod },
+    { "async_load", bench_async_load },
+    { "draw_allocations", bench_draw_allocations },
+    { "uniform_set", bench_uniform_set },
+    { "shader_parameters", bench_shader_parameters },
+    { "gl_state", bench_gl_state },
+    { "render_queue", bench_render_queue },
+    { "multi_draw", bench_multi_draw },
+    { "stream_buffer", bench_stream_buffer },
+    { "material_atlas", bench_material_atlas },
+    { "gpu_arena", bench_gpu_arena },
+    { "gpu_memory", bench_gpu_memory },
+    { "program_cache", bench_program_cache },
+    { "parallel_compile", bench_parallel_compile },
+    { "shader_variants", bench_shader_variants },
+    { "frustum_culling", bench_frustum_culling },
+};
+
+// usage: Benchmark [name...], runs every benchmark when no name is given
+int main(int argc, char* argv[])
+{
+    //-------------------------------------
+    // glfw: initialize and configure
+    //-------------------------------------
+    const glfw_session glfw;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+    //-------------------------------------
+    // hidden window, only the context is used
+    //-------------------------------------
+    GLFWwindow* window = glfwCreateWindow(64, 64, PROJECT_NAME, nullptr, nullptr);
+    if (window == nullptr)
+    {
+        std::cout << "Failed to create GLFW window\n";
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+
+    //----------------------------------------
+    // glad: load all OpenGL function pointers
+    //----------------------------------------
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(glfwGetProcAddress)))
+    {
+        std::cout << "Failed to initialize GLAD\n";
+        return -1;
+    }
+
+    for (const auto& [name, run] : benchmarks)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+            selected |= name == argv[i];
+        if (!selected)
+            continue;
+
+        std::cout << std::format("== {}\n", name);
+        run();
+        std::cout << '\n';
+    }
+
+    return 0;
+}
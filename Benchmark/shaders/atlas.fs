@@ -0,0 +1,22 @@
+#version 330 core
+struct MaterialArray {
+    sampler2DArray diffuse;
+    sampler2DArray specular;
+    sampler2DArray normal;
+};
+
+in vec3 Normal;
+in vec2 TexCoords;
+in vec3 Bitangent;
+flat in vec4 Layers;
+
+out vec4 FragColor;
+
+uniform MaterialArray materialArray;
+
+// material.fs with the textures taken from the layers of the material arrays
+void main()
+{
+    FragColor = texture(materialArray.diffuse, vec3(TexCoords, Layers.x)) + texture(materialArray.specular, vec3(TexCoords, Layers.y))
+              + texture(materialArray.normal, vec3(TexCoords, Layers.z)) * vec4(Normal + Bitangent, 1.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec4 aTangent;
+layout (location = 7) in uint aDrawID;
+
+out vec3 Normal;
+out vec2 TexCoords;
+out vec3 Bitangent;
+flat out vec4 Layers;
+
+uniform mat4 mvp;
+// material_atlas layers of every mesh
+uniform samplerBuffer drawData;
+
+void main()
+{
+    Normal = aNormal;
+    TexCoords = aTexCoords;
+    Bitangent = cross(aNormal, aTangent.xyz) * sign(aTangent.w);
+    Layers = texelFetch(drawData, int(aDrawID));
+    gl_Position = mvp * vec4(aPos, 1.0);
+}
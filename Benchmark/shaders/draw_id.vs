@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec4 aTangent;
+layout (location = 7) in uint aDrawID;
+
+out vec3 Normal;
+out vec2 TexCoords;
+out vec3 Bitangent;
+
+uniform mat4 mvp;
+// one texel per mesh of the batch
+uniform samplerBuffer drawData;
+
+// vertex_fetch.vs with a per draw tint looked up by the draw id of mesh_batch
+void main()
+{
+    Normal = aNormal * texelFetch(drawData, int(aDrawID)).rgb;
+    TexCoords = aTexCoords;
+    Bitangent = cross(aNormal, aTangent.xyz) * sign(aTangent.w);
+    gl_Position = mvp * vec4(aPos, 1.0);
+}
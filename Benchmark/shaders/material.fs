@@ -0,0 +1,21 @@
+#version 330 core
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+    sampler2D normal;
+};
+
+in vec3 Normal;
+in vec2 TexCoords;
+in vec3 Bitangent;
+
+out vec4 FragColor;
+
+uniform Material material1;
+
+// samples the material textures Mesh::Draw binds, the output only keeps them alive
+void main()
+{
+    FragColor = texture(material1.diffuse, TexCoords) + texture(material1.specular, TexCoords)
+              + texture(material1.normal, TexCoords) * vec4(Normal + Bitangent, 1.0);
+}
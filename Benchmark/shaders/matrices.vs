@@ -0,0 +1,12 @@
+#version 330 core
+layout (std140) uniform Matrices
+{
+    mat4 projection;
+    mat4 view;
+};
+
+// reads the whole block so every draw depends on the buffer bound for it
+void main()
+{
+    gl_Position = projection * view * vec4(0.0, 0.0, 0.0, 1.0);
+}
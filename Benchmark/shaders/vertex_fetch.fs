@@ -0,0 +1,11 @@
+#version 330 core
+in vec3 Normal;
+in vec2 TexCoords;
+in vec3 Bitangent;
+
+out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(Normal + Bitangent, TexCoords.x + TexCoords.y);
+}
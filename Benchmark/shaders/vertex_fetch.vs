@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec4 aTangent;
+
+out vec3 Normal;
+out vec2 TexCoords;
+out vec3 Bitangent;
+
+uniform mat4 mvp;
+
+// reads every attribute of both vertex layouts, the Full layout feeds w = 1 for the tangent
+void main()
+{
+    Normal = aNormal;
+    TexCoords = aTexCoords;
+    Bitangent = cross(aNormal, aTangent.xyz) * sign(aTangent.w);
+    gl_Position = mvp * vec4(aPos, 1.0);
+}
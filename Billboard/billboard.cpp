@@ -9,7 +9,11 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shader.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
 #include "camera.hpp"
+#include "texture_registry.hpp"
+#include "stream_buffer.hpp"
 #include "model.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -45,7 +49,7 @@ int main()
     //-------------------------------------
     // glfw: initialize and configure
     //-------------------------------------
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -62,7 +66,6 @@ int main()
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -200,10 +203,19 @@ int main()
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
     glBindVertexArray(0);
-    // Grass VAO
-    unsigned int GrassVAO, GrassVBO;
+    // Grass VAO, the quad faces the camera and is rebuilt every frame into the stream buffer.
+    // the attributes point at the start of the buffer, a frame draws from the vertex its data was written at
+    constexpr GLsizei grassStride = 5 * sizeof(float);
+    stream_buffer grassStream{ 64 * grassStride };
+    unsigned int GrassVAO;
     glGenVertexArrays(1, &GrassVAO);
-    glGenBuffers(1, &GrassVBO);
+    glBindVertexArray(GrassVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, grassStream.id());
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, grassStride, (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, grassStride, (void*)(3 * sizeof(float)));
+    glBindVertexArray(0);
     //glBindVertexArray(GrassVAO);
     //glBindBuffer(GL_ARRAY_BUFFER, GrassVAO);
     //glBufferData(GL_ARRAY_BUFFER, sizeof(vegetationVertices), &vegetationVertices, GL_STATIC_DRAW);
@@ -231,6 +243,7 @@ int main()
 
         // input
         processInput(window);
+        grassStream.begin_frame();
 
         // render
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -281,13 +294,8 @@ int main()
             rt.x, rt.y, rt.z, 1,0,
             lt.x, lt.y, lt.z, 0,0
         };
+        const auto grassFirst = static_cast<GLint>(grassStream.write(std::span{ grassVertices }, grassStride) / grassStride);
         glBindVertexArray(GrassVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, GrassVAO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(grassVertices), grassVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
         
         glEnable(GL_TEXTURE_2D);
         glBindTexture(GL_TEXTURE_2D, grassTexture);
@@ -297,19 +305,21 @@ int main()
             model = glm::mat4{ 1.0f };
             model = glm::translate(model, pos);
             modelShader.set("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glDrawArrays(GL_TRIANGLES, grassFirst, 6);
         }
 
         glBindVertexArray(0);
+        grassStream.end_frame();
 
 
 
         // Swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
         glfwPollEvents();
     }
 
-    glfwTerminate();
+    grassStream.report("grass");
     return 0;
 }
 
@@ -361,8 +371,10 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 
 unsigned int loadTexture(const std::filesystem::path& path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // shared with every Model and helper in the process, only the first request decodes the file
+    const auto [textureID, created] = texture_registry::shared().acquire(path);
+    if (!created)
+        return textureID;
 
     int width, height, nrComponents;
     if (const auto data = ::stbi_load(path.generic_string().c_str(), &width, &height, &nrComponents, 0))
@@ -10,7 +10,10 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shader.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
 #include "camera.hpp"
+#include "texture_registry.hpp"
 #include "model.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -46,7 +49,7 @@ int main()
     //-------------------------------------
     // glfw: initialize and configure
     //-------------------------------------
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -63,7 +66,6 @@ int main()
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -289,10 +291,10 @@ int main()
 
         // Swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
         glfwPollEvents();
     }
 
-    glfwTerminate();
     return 0;
 }
 
@@ -344,8 +346,10 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 
 unsigned int loadTexture(const std::filesystem::path& path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // shared with every Model and helper in the process, only the first request decodes the file
+    const auto [textureID, created] = texture_registry::shared().acquire(path);
+    if (!created)
+        return textureID;
 
     int width, height, nrComponents;
     if (const auto data = ::stbi_load(path.generic_string().c_str(), &width, &height, &nrComponents, 0))
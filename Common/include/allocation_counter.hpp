@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Process wide count of heap allocations made through the global operator new, to check that hot paths allocate nothing.
+// Like stb_image, define ALLOCATION_COUNTER_IMPLEMENTATION in exactly one source file before including this header,
+// that file then replaces the global operator new and delete with counting versions. Without it the count stays zero.
+// Over-aligned allocations (the std::align_val_t overloads) are not counted.
+
+namespace detail
+{
+    inline std::atomic<std::size_t> allocation_count{ 0 };
+}
+
+[[nodiscard]] inline auto allocation_count() -> std::size_t
+{
+    return detail::allocation_count.load(std::memory_order_relaxed);
+}
+
+// allocations made by every thread while f runs
+template <typename F>
+[[nodiscard]] auto count_allocations(F&& f) -> std::size_t
+{
+    const auto before = allocation_count();
+    std::forward<F>(f)();
+    return allocation_count() - before;
+}
+
+#ifdef ALLOCATION_COUNTER_IMPLEMENTATION
+#include <new>
+#include <cstdlib>
+
+// the array and nothrow forms forward to these by default
+void* operator new(std::size_t size)
+{
+    detail::allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+    while (true)
+    {
+        if (void* p = std::malloc(size))
+            return p;
+        const auto handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc{};
+        handler();
+    }
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
@@ -0,0 +1,115 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#include <iostream>
+#include <filesystem>
+
+#include <glad/glad.h>
+
+#include "task.hpp"
+#include "image.hpp"
+#include "shader.hpp"
+#include "thread_pool.hpp"
+#include "texture_registry.hpp"
+
+// Asset loaders built on task.hpp. Files are read and decoded on thread_pool::shared(),
+// GL objects are created on the main thread, so the render loop has to poll main_thread_queue::shared().
+// Arguments are taken by value, a coroutine outlives the expression that created it.
+
+// whole file as text, throws like Shader when the file cannot be opened
+inline auto read_file_async(std::filesystem::path path) -> task<std::string>
+{
+    co_await schedule_on(thread_pool::shared());
+    std::ifstream stream{ path, std::ios::binary };
+    if (not stream)
+    {
+        throw std::ios_base::failure("file does not exist");
+    }
+    std::stringstream content;
+    content << stream.rdbuf();
+    co_return content.str();
+}
+
+// decoded pixels, an invalid image if the file cannot be decoded
+inline auto decode_image_async(std::filesystem::path path) -> task<decoded_image>
+{
+    co_await schedule_on(thread_pool::shared());
+    co_return decoded_image{ path.generic_string() };
+}
+
+// 2D texture through the texture registry, same sampling as loadTexture of the demos.
+// only the first request of a file decodes it, later ones share the name right away.
+// the decode also hashes the file, a copy of an image already loaded ends up with its name
+inline auto load_texture_async(std::filesystem::path path, std::string variant = {}) -> task<GLuint>
+{
+    co_await resume_on_main_thread();
+    const auto [created_id, created] = texture_registry::shared().acquire(path, variant);
+    if (!created)
+        co_return created_id;
+
+    auto image = co_await decode_image_async(path);
+    co_await resume_on_main_thread();
+    const auto id = texture_registry::shared().resolve(created_id, image.content(), variant);
+    if (id != created_id)
+        co_return id;
+    if (image)
+        upload_image(id, image);
+    else
+        std::cout << "Texture failed to load at path: " << path << '\n';
+    co_return id;
+}
+
+// cube map of 6 faces in +x, -x, +y, -y, +z, -z order, the faces are decoded in parallel
+inline auto load_cubemap_async(std::vector<std::filesystem::path> faces) -> task<GLuint>
+{
+    std::vector<task<decoded_image>> decodes;
+    decodes.reserve(faces.size());
+    for (const auto& face : faces)
+        decodes.push_back(decode_image_async(face));
+    auto images = co_await when_all(std::move(decodes));
+
+    co_await resume_on_main_thread();
+    GLuint id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, id);
+    for (std::size_t i = 0; i < images.size(); i++)
+    {
+        const auto& image = images[i];
+        if (image)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<GLenum>(i), 0, image.format(), image.width(), image.height(), 0,
+                         image.format(), GL_UNSIGNED_BYTE, image.data());
+        else
+            std::cout << "Cube map texture failed to load at path: " << faces[i] << '\n';
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    co_return id;
+}
+
+// shader stage file run through shader_preprocessor like Shader does for a shader_entity, #include resolves
+// relative to it. the included files are read on the pool as well
+inline auto read_shader_async(std::filesystem::path path) -> task<std::string>
+{
+    auto source = co_await read_file_async(path);
+    co_return shader_preprocessor::run(source, path.parent_path());
+}
+
+// program of the given stages, the sources are read and preprocessed in parallel and compiled on the main thread
+template <int... I>
+auto load_shader_async(shader_entity<I>... stages) -> task<Shader>
+{
+    std::vector<task<std::string>> reads;
+    reads.reserve(sizeof...(I));
+    (reads.push_back(read_shader_async(std::move(stages.path))), ...);
+    auto sources = co_await when_all(std::move(reads));
+
+    co_await resume_on_main_thread();
+    std::size_t i = 0;
+    co_return Shader{ shader_source<I>{ std::move(sources[i++]) }... };
+}
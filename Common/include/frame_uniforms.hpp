@@ -0,0 +1,88 @@
+#pragma once
+#include <optional>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "camera.hpp"
+#include "gpu_memory.hpp"
+#include "stream_buffer.hpp"
+#include "uniform_blocks.hpp"
+
+// Uploads the shared uniform blocks of uniform_blocks.hpp. A frame calls begin_frame() and then set_frame() once
+// per camera, and every program declaring the Frame block sees that camera without setting view, projection or
+// viewPos itself. set_object() does the same per draw for the Object block, render_queue calls it for programs that
+// declare the block. Both are written to a stream_buffer and bound by range, so nothing waits on the GPU.
+// Like the rest of the GL side it is only used from the context thread, after the GL functions are loaded.
+class frame_uniforms
+{
+public:
+    // objects one frame can set, past that stream_buffer::write throws
+    static constexpr std::size_t max_objects_per_frame = 4096;
+
+    [[nodiscard]] static auto shared() -> frame_uniforms&
+    {
+        static frame_uniforms instance;
+        return instance;
+    }
+
+    frame_uniforms(const frame_uniforms&) = delete;
+    frame_uniforms& operator=(const frame_uniforms&) = delete;
+
+    // fences what the previous frame wrote and starts the next one, before the first set_*
+    void begin_frame()
+    {
+        if (started_)
+            stream().end_frame();
+        stream().begin_frame();
+        started_ = true;
+    }
+
+    void set_frame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& view_position, float time)
+    {
+        const auto offset = stream().write_uniform(frame_block{ view, projection, projection * view, view_position, time });
+        glBindBufferRange(GL_UNIFORM_BUFFER, frame_block::binding, stream().id(), offset, sizeof(frame_block));
+    }
+
+    void set_frame(const Camera& camera, const glm::mat4& projection, float time)
+    {
+        set_frame(camera.GetViewMatrix(), projection, camera.Position, time);
+    }
+
+    void set_object(const glm::mat4& model)
+    {
+        const auto offset = stream().write_uniform(object_block{ model, glm::transpose(glm::inverse(model)) });
+        glBindBufferRange(GL_UNIFORM_BUFFER, object_block::binding, stream().id(), offset, sizeof(object_block));
+    }
+
+    // deletes the stream buffer, the next begin_frame() creates another one. glfw_session clears the instance
+    // before glfwTerminate()
+    void clear()
+    {
+        stream_.reset();
+        started_ = false;
+    }
+
+    void report() const
+    {
+        if (stream_)
+            stream_->report("frame uniforms");
+    }
+
+private:
+    frame_uniforms() = default;
+
+    // created on first use, the GL functions are not loaded when the instance may be
+    auto stream() -> stream_buffer&
+    {
+        if (!stream_)
+        {
+            const gpu_memory::owner_scope owner{ "frame uniforms" };
+            stream_.emplace((max_objects_per_frame + 4) * stream_buffer::uniform_alignment());
+        }
+        return *stream_;
+    }
+
+    std::optional<stream_buffer> stream_;
+    bool started_{ false };
+};
@@ -0,0 +1,207 @@
+#pragma once
+#include <span>
+#include <array>
+#include <cmath>
+#include <format>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <string_view>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+#include "camera.hpp"
+
+// bounding sphere placed with model, as (center, radius) in the space model maps to. the radius grows with the
+// largest axis scale, so the sphere still encloses the mesh under non-uniform scaling
+[[nodiscard]] inline auto world_sphere(const glm::vec3& center, float radius, const glm::mat4& model) -> glm::vec4
+{
+    const auto scale = std::max({ glm::length(glm::vec3{ model[0] }), glm::length(glm::vec3{ model[1] }), glm::length(glm::vec3{ model[2] }) });
+    return { glm::vec3{ model * glm::vec4{ center, 1.0f } }, radius * scale };
+}
+
+// The six planes bounding what view_projection maps into clip space (Gribb and Hartmann), normals pointing inside.
+// A bound is culled only when it lies entirely behind one plane, so bounds crossing a corner outside the volume
+// are kept, the usual conservative answer.
+//   const frustum view{ projection * camera.GetViewMatrix() };
+//   model.Draw(shader, view, camera, placement, SCR_HEIGHT);
+// cull_spheres() tests a batch of spheres, four per step where SSE is available, for thousands of instances a frame.
+class frustum
+{
+public:
+    explicit frustum(const glm::mat4& view_projection)
+    {
+        const auto row = [&](int i) { return glm::vec4{ view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i] }; };
+        planes_ = { row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1), row(3) + row(2), row(3) - row(2) };
+        for (auto& plane : planes_)
+            plane /= glm::length(glm::vec3{ plane });
+    }
+
+    [[nodiscard]] static auto of(const Camera& camera, const glm::mat4& projection) -> frustum
+    {
+        return frustum{ projection * camera.GetViewMatrix() };
+    }
+
+    // the same planes in the space model maps from, for testing bounds without moving them. they are left
+    // unnormalized, which box tests do not mind. spheres need the planes of the space they are given in
+    [[nodiscard]] auto transformed(const glm::mat4& model) const -> frustum
+    {
+        frustum local{ *this };
+        const auto to_local = glm::transpose(model);
+        for (auto& plane : local.planes_)
+            plane = to_local * plane;
+        return local;
+    }
+
+    [[nodiscard]] auto intersects_sphere(const glm::vec3& center, float radius) const -> bool
+    {
+        for (const auto& plane : planes_)
+        {
+            if (glm::dot(glm::vec3{ plane }, center) + plane.w < -radius)
+                return false;
+        }
+        return true;
+    }
+
+    [[nodiscard]] auto intersects_sphere(const glm::vec4& sphere) const -> bool
+    {
+        return intersects_sphere(glm::vec3{ sphere }, sphere.w);
+    }
+
+    // the corner of the box furthest along each normal decides
+    [[nodiscard]] auto intersects_box(const glm::vec3& lower, const glm::vec3& upper) const -> bool
+    {
+        for (const auto& plane : planes_)
+        {
+            const glm::vec3 furthest{ plane.x >= 0.0f ? upper.x : lower.x, plane.y >= 0.0f ? upper.y : lower.y,
+                                      plane.z >= 0.0f ? upper.z : lower.z };
+            if (glm::dot(glm::vec3{ plane }, furthest) + plane.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    // visible[i] = whether spheres[i] (center, radius) intersects, returns how many do. visible holds at least as
+    // many entries as spheres
+    auto cull_spheres(std::span<const glm::vec4> spheres, std::span<std::uint8_t> visible) const -> std::size_t
+    {
+        std::size_t first = 0;
+        std::size_t count = 0;
+#ifdef FRUSTUM_SSE
+        __m128 nx[6], ny[6], nz[6], d[6];
+        for (std::size_t p = 0; p < planes_.size(); p++)
+        {
+            nx[p] = _mm_set1_ps(planes_[p].x);
+            ny[p] = _mm_set1_ps(planes_[p].y);
+            nz[p] = _mm_set1_ps(planes_[p].z);
+            d[p] = _mm_set1_ps(planes_[p].w);
+        }
+        for (; first + 4 <= spheres.size(); first += 4)
+        {
+            // four (x, y, z, r) rows into one register per component
+            auto x = _mm_loadu_ps(&spheres[first].x);
+            auto y = _mm_loadu_ps(&spheres[first + 1].x);
+            auto z = _mm_loadu_ps(&spheres[first + 2].x);
+            auto r = _mm_loadu_ps(&spheres[first + 3].x);
+            _MM_TRANSPOSE4_PS(x, y, z, r);
+            const auto negative_r = _mm_sub_ps(_mm_setzero_ps(), r);
+            auto outside = _mm_setzero_ps();
+            for (std::size_t p = 0; p < planes_.size(); p++)
+            {
+                const auto distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)),
+                                                 _mm_add_ps(_mm_mul_ps(nz[p], z), d[p]));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negative_r));
+            }
+            const auto mask = _mm_movemask_ps(outside);
+            for (std::size_t i = 0; i < 4; i++)
+            {
+                const auto in = static_cast<std::uint8_t>(((mask >> i) & 1) == 0);
+                visible[first + i] = in;
+                count += in;
+            }
+        }
+#endif
+        return count + cull_spheres_scalar(spheres.subspan(first), visible.subspan(first));
+    }
+
+    // one sphere at a time, the reference the SSE path is measured and checked against
+    auto cull_spheres_scalar(std::span<const glm::vec4> spheres, std::span<std::uint8_t> visible) const -> std::size_t
+    {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < spheres.size(); i++)
+        {
+            visible[i] = intersects_sphere(spheres[i]);
+            count += visible[i];
+        }
+        return count;
+    }
+
+    [[nodiscard]] auto planes() const -> const std::array<glm::vec4, 6>& { return planes_; }
+
+private:
+    // left, right, bottom, top, near, far
+    std::array<glm::vec4, 6> planes_;
+};
+
+// Bounds tested against a frustum by Model and the demos, per frame and in total. end_frame() closes the counts of a
+// frame, like gl_state and gl_objects it is only used from the context thread
+class cull_counters
+{
+public:
+    struct counts
+    {
+        std::size_t visible;
+        std::size_t culled;
+    };
+
+    [[nodiscard]] static auto shared() -> cull_counters&
+    {
+        static cull_counters counters;
+        return counters;
+    }
+
+    cull_counters(const cull_counters&) = delete;
+    cull_counters& operator=(const cull_counters&) = delete;
+
+    void add(std::size_t visible, std::size_t culled)
+    {
+        frame_.visible += visible;
+        frame_.culled += culled;
+    }
+
+    // call once per frame after glfwSwapBuffers
+    void end_frame()
+    {
+        last_ = frame_;
+        total_.visible += frame_.visible;
+        total_.culled += frame_.culled;
+        frame_ = {};
+        ++frames_;
+    }
+
+    [[nodiscard]] auto last_frame() const -> counts { return last_; }
+    [[nodiscard]] auto total() const -> counts { return total_; }
+
+    void report() const
+    {
+        const auto tested = total_.visible + total_.culled;
+        if (frames_ == 0 || tested == 0)
+            return;
+        std::cout << std::format("frustum culling: {} frames, {:.1f} visible and {:.1f} culled per frame ({:.1f}% culled)\n", frames_,
+                                 static_cast<double>(total_.visible) / frames_, static_cast<double>(total_.culled) / frames_,
+                                 100.0 * static_cast<double>(total_.culled) / static_cast<double>(tested));
+    }
+
+private:
+    cull_counters() = default;
+
+    counts frame_{};
+    counts last_{};
+    counts total_{};
+    std::size_t frames_{ 0 };
+};
@@ -0,0 +1,181 @@
+#pragma once
+#include <array>
+#include <format>
+#include <cstddef>
+#include <utility>
+#include <iostream>
+#include <string_view>
+
+#include <glad/glad.h>
+
+// kinds of GL objects a gl_handle owns
+enum class gl_object : std::size_t
+{
+    buffer,
+    vertex_array,
+    texture,
+    program,
+};
+
+// Objects of each kind created and deleted through gl_handles, and the frames they leak in.
+// A frame that has warmed up deletes as many objects as it creates. end_frame() closes the counts of a frame,
+// and a frame ending with more live objects than it started with counts as leaking, with the first one
+// of each kind printed as it happens. The first warmup_frames frames are left out, demos still load then.
+// Like the rest of the GL side it is only used from the context thread.
+class gl_objects
+{
+public:
+    static constexpr std::array<std::string_view, 4> names{ "buffers", "vertex arrays", "textures", "programs" };
+    static constexpr std::size_t warmup_frames = 2;
+
+    struct counts
+    {
+        std::size_t created;
+        std::size_t destroyed;
+
+        [[nodiscard]] auto live() const -> std::size_t { return created - destroyed; }
+    };
+
+    [[nodiscard]] static auto shared() -> gl_objects&
+    {
+        static gl_objects objects;
+        return objects;
+    }
+
+    gl_objects(const gl_objects&) = delete;
+    gl_objects& operator=(const gl_objects&) = delete;
+
+    void created(gl_object kind) { ++frame_[index(kind)].created; }
+    void destroyed(gl_object kind) { ++frame_[index(kind)].destroyed; }
+
+    // closes the counts of the current frame, call once per frame after glfwSwapBuffers
+    void end_frame()
+    {
+        for (std::size_t kind = 0; kind < names.size(); kind++)
+        {
+            const auto& frame = frame_[kind];
+            if (frames_ >= warmup_frames && frame.created > frame.destroyed)
+            {
+                if (leaking_frames_[kind]++ == 0)
+                    std::cout << std::format("gl objects: frame {} leaked {} {}\n", frames_, frame.created - frame.destroyed, names[kind]);
+                leaked_[kind] += frame.created - frame.destroyed;
+            }
+            total_[kind].created += frame.created;
+            total_[kind].destroyed += frame.destroyed;
+        }
+        last_frame_ = std::exchange(frame_, {});
+        ++frames_;
+    }
+
+    // everything so far, the open frame included
+    [[nodiscard]] auto total(gl_object kind) const -> counts
+    {
+        const auto i = index(kind);
+        return { total_[i].created + frame_[i].created, total_[i].destroyed + frame_[i].destroyed };
+    }
+    [[nodiscard]] auto live(gl_object kind) const -> std::size_t { return total(kind).live(); }
+    [[nodiscard]] auto last_frame(gl_object kind) const -> counts { return last_frame_[index(kind)]; }
+    [[nodiscard]] auto frames() const -> std::size_t { return frames_; }
+
+    void report() const
+    {
+        std::cout << std::format("gl objects: {} frames\n", frames_);
+        std::cout << std::format("  {:<16}{:>10}{:>10}{:>10}{:>16}{:>10}\n", "kind", "created", "deleted", "live",
+                                 "leaking frames", "leaked");
+        for (std::size_t kind = 0; kind < names.size(); kind++)
+        {
+            const auto counts = total(static_cast<gl_object>(kind));
+            std::cout << std::format("  {:<16}{:>10}{:>10}{:>10}{:>16}{:>10}\n", names[kind], counts.created,
+                                     counts.destroyed, counts.live(), leaking_frames_[kind], leaked_[kind]);
+        }
+    }
+
+private:
+    gl_objects() = default;
+
+    static constexpr auto index(gl_object kind) -> std::size_t { return static_cast<std::size_t>(kind); }
+
+    std::array<counts, names.size()> frame_{};
+    std::array<counts, names.size()> last_frame_{};
+    std::array<counts, names.size()> total_{};
+    std::array<std::size_t, names.size()> leaking_frames_{};
+    std::array<std::size_t, names.size()> leaked_{};
+    std::size_t frames_{ 0 };
+};
+
+// Sole owner of one GL object name, deleted with the handle. Move-only, a moved-from handle holds 0.
+// Converts to the name, so a handle goes wherever GL takes one: glBindVertexArray(mesh.VAO).
+template <gl_object Kind>
+class gl_handle
+{
+public:
+    gl_handle() = default;
+
+    // takes ownership of a name created elsewhere, e.g. by glCreateProgram
+    explicit gl_handle(GLuint id)
+        : id_{ id }
+    {
+        if (id_)
+            gl_objects::shared().created(Kind);
+    }
+
+    [[nodiscard]] static auto create() -> gl_handle
+    {
+        GLuint id = 0;
+        if constexpr (Kind == gl_object::buffer)
+            glGenBuffers(1, &id);
+        else if constexpr (Kind == gl_object::vertex_array)
+            glGenVertexArrays(1, &id);
+        else if constexpr (Kind == gl_object::texture)
+            glGenTextures(1, &id);
+        else
+            id = glCreateProgram();
+        return gl_handle{ id };
+    }
+
+    gl_handle(const gl_handle&) = delete;
+    gl_handle& operator=(const gl_handle&) = delete;
+    gl_handle(gl_handle&& other) noexcept
+        : id_{ std::exchange(other.id_, 0) }
+    {
+    }
+    gl_handle& operator=(gl_handle&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            id_ = std::exchange(other.id_, 0);
+        }
+        return *this;
+    }
+
+    ~gl_handle() { reset(); }
+
+    // deletes the object now, the handle holds 0 afterwards
+    void reset()
+    {
+        if (!id_)
+            return;
+        if constexpr (Kind == gl_object::buffer)
+            glDeleteBuffers(1, &id_);
+        else if constexpr (Kind == gl_object::vertex_array)
+            glDeleteVertexArrays(1, &id_);
+        else if constexpr (Kind == gl_object::texture)
+            glDeleteTextures(1, &id_);
+        else
+            glDeleteProgram(id_);
+        gl_objects::shared().destroyed(Kind);
+        id_ = 0;
+    }
+
+    [[nodiscard]] constexpr auto id() const -> GLuint { return id_; }
+    constexpr operator GLuint() const { return id_; }
+
+private:
+    GLuint id_{ 0 };
+};
+
+using gl_buffer = gl_handle<gl_object::buffer>;
+using gl_vertex_array = gl_handle<gl_object::vertex_array>;
+using gl_texture = gl_handle<gl_object::texture>;
+using gl_program = gl_handle<gl_object::program>;
@@ -0,0 +1,433 @@
+#pragma once
+#include <array>
+#include <tuple>
+#include <format>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <iostream>
+#include <optional>
+#include <algorithm>
+
+#include <glad/glad.h>
+
+// Redundant state filter between the demos and the driver.
+// install() swaps the glad entry points of the state setters below for versions that remember the value last set
+// and drop calls which would not change it, so plain GL code (Shader::use, Mesh::Draw, the demos) is filtered
+// without rewriting it. State set before install() is unknown, the first call of each setter always goes through.
+//   filtered:  glUseProgram, glBindVertexArray, glActiveTexture, glBindTexture (units 0-31, common targets),
+//              glBindFramebuffer, glEnable, glDisable, glDepthFunc, glDepthMask, glBlendFunc(Separate),
+//              glStencilFunc, glStencilOp, glStencilMask, glCullFace
+//   tracked:   glDelete{Textures,VertexArrays,Framebuffers,Program} reset bindings of deleted names to 0,
+//              the separate stencil setters pass through and forget the stencil state
+// install_program_filter() hooks glUseProgram and glDeleteProgram alone. Shader calls it for every program it
+// creates, so binding the current program again never reaches the driver, whether or not a demo installs the rest.
+// Code that changes state without glad (another library sharing the context) has to call invalidate().
+// Like the rest of the GL side it is only used from the context thread.
+class gl_state
+{
+public:
+    struct statistics
+    {
+        // calls that reached the driver
+        std::size_t issued;
+        // redundant calls dropped
+        std::size_t skipped;
+    };
+
+    static gl_state& shared()
+    {
+        static gl_state state;
+        return state;
+    }
+
+    // call once after gladLoadGLLoader, with the context current
+    void install()
+    {
+        if (installed_)
+            return;
+        installed_ = true;
+        entry_points(hook);
+    }
+
+    // only the program binding, installed with the first Shader. stays when the full filter is uninstalled
+    void install_program_filter()
+    {
+        if (program_filter_)
+            return;
+        program_filter_ = true;
+        program_entry_points(hook);
+    }
+
+    // gives the entry points back to the driver and forgets the shadowed values, the counters are kept
+    void uninstall()
+    {
+        if (!installed_)
+            return;
+        installed_ = false;
+        entry_points([](auto& entry, auto& original, auto) {
+            if (original)
+                entry = original;
+        });
+        if (program_filter_)
+            program_entry_points(hook);
+        invalidate();
+    }
+
+    [[nodiscard]] bool installed() const { return installed_; }
+
+    // forgets every shadowed value, the next call of each setter goes through
+    void invalidate()
+    {
+        auto capabilities = std::move(cache_.capabilities);
+        capabilities.clear();
+        cache_ = {};
+        cache_.capabilities = std::move(capabilities);
+    }
+
+    // closes the counters of the current frame, call once per frame after glfwSwapBuffers
+    void end_frame()
+    {
+        last_frame_ = frame_;
+        total_.issued += frame_.issued;
+        total_.skipped += frame_.skipped;
+        frame_ = {};
+        ++frames_;
+    }
+
+    [[nodiscard]] auto last_frame() const -> statistics { return last_frame_; }
+    [[nodiscard]] auto total() const -> statistics { return total_; }
+    [[nodiscard]] auto frames() const -> std::size_t { return frames_; }
+
+    void report() const
+    {
+        const auto frames = static_cast<double>(std::max<std::size_t>(frames_, 1));
+        std::cout << std::format("gl state: {} frames, per frame {:.1f} state calls issued, {:.1f} redundant skipped "
+                                 "(last frame {} issued, {} skipped)\n",
+                                 frames_, total_.issued / frames, total_.skipped / frames,
+                                 last_frame_.issued, last_frame_.skipped);
+    }
+
+private:
+    static constexpr std::size_t tracked_units = 32;
+    static constexpr std::array<GLenum, 5> tracked_targets{
+        GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_2D_MULTISAMPLE, GL_TEXTURE_3D
+    };
+
+    struct cache
+    {
+        std::optional<GLuint> program;
+        std::optional<GLuint> vertex_array;
+        std::optional<GLuint> draw_framebuffer;
+        std::optional<GLuint> read_framebuffer;
+        std::optional<GLenum> active_texture;
+        std::array<std::array<std::optional<GLuint>, tracked_targets.size()>, tracked_units> textures;
+        // glEnable / glDisable, a handful of capabilities, searched linearly
+        std::vector<std::pair<GLenum, bool>> capabilities;
+        std::optional<GLenum> depth_func;
+        std::optional<GLboolean> depth_mask;
+        // source rgb, destination rgb, source alpha, destination alpha
+        std::optional<std::array<GLenum, 4>> blend_func;
+        // front and back faces alike, the separate setters reset these
+        std::optional<std::tuple<GLenum, GLint, GLuint>> stencil_func;
+        std::optional<std::array<GLenum, 3>> stencil_op;
+        std::optional<GLuint> stencil_mask;
+        std::optional<GLenum> cull_face;
+    };
+
+    // the entry points glad loaded, the hooks forward to these
+    struct driver
+    {
+        PFNGLUSEPROGRAMPROC use_program;
+        PFNGLBINDVERTEXARRAYPROC bind_vertex_array;
+        PFNGLACTIVETEXTUREPROC active_texture;
+        PFNGLBINDTEXTUREPROC bind_texture;
+        PFNGLBINDFRAMEBUFFERPROC bind_framebuffer;
+        PFNGLENABLEPROC enable;
+        PFNGLDISABLEPROC disable;
+        PFNGLDEPTHFUNCPROC depth_func;
+        PFNGLDEPTHMASKPROC depth_mask;
+        PFNGLBLENDFUNCPROC blend_func;
+        PFNGLBLENDFUNCSEPARATEPROC blend_func_separate;
+        PFNGLSTENCILFUNCPROC stencil_func;
+        PFNGLSTENCILOPPROC stencil_op;
+        PFNGLSTENCILMASKPROC stencil_mask;
+        PFNGLSTENCILFUNCSEPARATEPROC stencil_func_separate;
+        PFNGLSTENCILOPSEPARATEPROC stencil_op_separate;
+        PFNGLSTENCILMASKSEPARATEPROC stencil_mask_separate;
+        PFNGLCULLFACEPROC cull_face;
+        PFNGLDELETETEXTURESPROC delete_textures;
+        PFNGLDELETEVERTEXARRAYSPROC delete_vertex_arrays;
+        PFNGLDELETEFRAMEBUFFERSPROC delete_framebuffers;
+        PFNGLDELETEPROGRAMPROC delete_program;
+    };
+
+    gl_state() = default;
+
+    // swaps entry for replacement, remembering the driver function. an entry hooked already keeps its original
+    static constexpr auto hook = [](auto& entry, auto& original, auto replacement) {
+        if (entry == replacement)
+            return;
+        original = entry;
+        if (entry)
+            entry = replacement;
+    };
+
+    // visit(glad entry point, driver entry point, hook) for the program binding
+    template <typename Visit>
+    void program_entry_points(Visit visit)
+    {
+        visit(glad_glUseProgram, driver_.use_program, &hooks::use_program);
+        visit(glad_glDeleteProgram, driver_.delete_program, &hooks::delete_program);
+    }
+
+    // visit(glad entry point, driver entry point, hook) for every filtered function
+    template <typename Visit>
+    void entry_points(Visit visit)
+    {
+        program_entry_points(visit);
+        visit(glad_glBindVertexArray, driver_.bind_vertex_array, &hooks::bind_vertex_array);
+        visit(glad_glActiveTexture, driver_.active_texture, &hooks::active_texture);
+        visit(glad_glBindTexture, driver_.bind_texture, &hooks::bind_texture);
+        visit(glad_glBindFramebuffer, driver_.bind_framebuffer, &hooks::bind_framebuffer);
+        visit(glad_glEnable, driver_.enable, &hooks::enable);
+        visit(glad_glDisable, driver_.disable, &hooks::disable);
+        visit(glad_glDepthFunc, driver_.depth_func, &hooks::depth_func);
+        visit(glad_glDepthMask, driver_.depth_mask, &hooks::depth_mask);
+        visit(glad_glBlendFunc, driver_.blend_func, &hooks::blend_func);
+        visit(glad_glBlendFuncSeparate, driver_.blend_func_separate, &hooks::blend_func_separate);
+        visit(glad_glStencilFunc, driver_.stencil_func, &hooks::stencil_func);
+        visit(glad_glStencilOp, driver_.stencil_op, &hooks::stencil_op);
+        visit(glad_glStencilMask, driver_.stencil_mask, &hooks::stencil_mask);
+        visit(glad_glStencilFuncSeparate, driver_.stencil_func_separate, &hooks::stencil_func_separate);
+        visit(glad_glStencilOpSeparate, driver_.stencil_op_separate, &hooks::stencil_op_separate);
+        visit(glad_glStencilMaskSeparate, driver_.stencil_mask_separate, &hooks::stencil_mask_separate);
+        visit(glad_glCullFace, driver_.cull_face, &hooks::cull_face);
+        visit(glad_glDeleteTextures, driver_.delete_textures, &hooks::delete_textures);
+        visit(glad_glDeleteVertexArrays, driver_.delete_vertex_arrays, &hooks::delete_vertex_arrays);
+        visit(glad_glDeleteFramebuffers, driver_.delete_framebuffers, &hooks::delete_framebuffers);
+    }
+
+    // stores value and runs call unless slot already holds it
+    template <typename T, typename Call>
+    void filter(std::optional<T>& slot, const T& value, Call&& call)
+    {
+        if (slot == value)
+        {
+            ++frame_.skipped;
+            return;
+        }
+        slot = value;
+        ++frame_.issued;
+        std::forward<Call>(call)();
+    }
+
+    // state the cache does not shadow, e.g. an unknown texture target
+    template <typename Call>
+    void pass(Call&& call)
+    {
+        ++frame_.issued;
+        std::forward<Call>(call)();
+    }
+
+    auto texture_slot(GLenum target) -> std::optional<GLuint>*
+    {
+        const auto it = std::ranges::find(tracked_targets, target);
+        if (it == tracked_targets.end() || !cache_.active_texture)
+            return nullptr;
+        const auto unit = static_cast<std::size_t>(*cache_.active_texture - GL_TEXTURE0);
+        if (unit >= tracked_units)
+            return nullptr;
+        return &cache_.textures[unit][static_cast<std::size_t>(it - tracked_targets.begin())];
+    }
+
+    void set_capability(GLenum capability, bool enabled)
+    {
+        auto it = std::ranges::find(cache_.capabilities, capability, &std::pair<GLenum, bool>::first);
+        if (it != cache_.capabilities.end() && it->second == enabled)
+        {
+            ++frame_.skipped;
+            return;
+        }
+        if (it == cache_.capabilities.end())
+            cache_.capabilities.emplace_back(capability, enabled);
+        else
+            it->second = enabled;
+        pass([&] { (enabled ? driver_.enable : driver_.disable)(capability); });
+    }
+
+    // a deleted name bound somewhere is replaced by 0 there
+    static void forget(std::optional<GLuint>& slot, GLsizei n, const GLuint* names)
+    {
+        if (slot && *slot != 0 && std::find(names, names + n, *slot) != names + n)
+            slot = 0;
+    }
+
+    struct hooks
+    {
+        static void APIENTRY use_program(GLuint program)
+        {
+            auto& s = shared();
+            s.filter(s.cache_.program, program, [&] { s.driver_.use_program(program); });
+        }
+
+        static void APIENTRY bind_vertex_array(GLuint array)
+        {
+            auto& s = shared();
+            s.filter(s.cache_.vertex_array, array, [&] { s.driver_.bind_vertex_array(array); });
+        }
+
+        static void APIENTRY active_texture(GLenum unit)
+        {
+            auto& s = shared();
+            s.filter(s.cache_.active_texture, unit, [&] { s.driver_.active_texture(unit); });
+        }
+
+        static void APIENTRY bind_texture(GLenum target, GLuint texture)
+        {
+            auto& s = shared();
+            const auto call = [&] { s.driver_.bind_texture(target, texture); };
+            if (auto* slot = s.texture_slot(target))
+                s.filter(*slot, texture, call);
+            else
+                s.pass(call);
+        }
+
+        static void APIENTRY bind_framebuffer(GLenum target, GLuint framebuffer)
+        {
+            auto& s = shared();
+            const auto call = [&] { s.driver_.bind_framebuffer(target, framebuffer); };
+            if (target == GL_DRAW_FRAMEBUFFER)
+                s.filter(s.cache_.draw_framebuffer, framebuffer, call);
+            else if (target == GL_READ_FRAMEBUFFER)
+                s.filter(s.cache_.read_framebuffer, framebuffer, call);
+            else if (s.cache_.draw_framebuffer == framebuffer && s.cache_.read_framebuffer == framebuffer)
+                ++s.frame_.skipped;
+            else
+            {
+                s.cache_.draw_framebuffer = s.cache_.read_framebuffer = framebuffer;
+                s.pass(call);
+            }
+        }
+
+        static void APIENTRY enable(GLenum capability) { shared().set_capability(capability, true); }
+
+        static void APIENTRY disable(GLenum capability) { shared().set_capability(capability, false); }
+
+        static void APIENTRY depth_func(GLenum func)
+        {
+            auto& s = shared();
+            s.filter(s.cache_.depth_func, func, [&] { s.driver_.depth_func(func); });
+        }
+
+        static void APIENTRY depth_mask(GLboolean flag)
+        {
+            auto& s = shared();
+            s.filter(s.cache_.depth_mask, flag, [&] { s.driver_.depth_mask(flag); });
+        }
+
+        static void APIENTRY blend_func(GLenum source, GLenum destination)
+        {
+            auto& s = shared();
+            s.filter(s.cache_.blend_func, std::array{ source, destination, source, destination },
+                     [&] { s.driver_.blend_func(source, destination); });
+        }
+
+        static void APIENTRY blend_func_separate(GLenum source_rgb, GLenum destination_rgb,
+                                                 GLenum source_alpha, GLenum destination_alpha)
+        {
+            auto& s = shared();
+            s.filter(s.cache_.blend_func, std::array{ source_rgb, destination_rgb, source_alpha, destination_alpha },
+                     [&] { s.driver_.blend_func_separate(source_rgb, destination_rgb, source_alpha, destination_alpha); });
+        }
+
+        static void APIENTRY stencil_func(GLenum func, GLint reference, GLuint mask)
+        {
+            auto& s = shared();
+            s.filter(s.cache_.stencil_func, std::tuple{ func, reference, mask },
+                     [&] { s.driver_.stencil_func(func, reference, mask); });
+        }
+
+        static void APIENTRY stencil_op(GLenum stencil_fail, GLenum depth_fail, GLenum depth_pass)
+        {
+            auto& s = shared();
+            s.filter(s.cache_.stencil_op, std::array{ stencil_fail, depth_fail, depth_pass },
+                     [&] { s.driver_.stencil_op(stencil_fail, depth_fail, depth_pass); });
+        }
+
+        static void APIENTRY stencil_mask(GLuint mask)
+        {
+            auto& s = shared();
+            s.filter(s.cache_.stencil_mask, mask, [&] { s.driver_.stencil_mask(mask); });
+        }
+
+        static void APIENTRY stencil_func_separate(GLenum face, GLenum func, GLint reference, GLuint mask)
+        {
+            auto& s = shared();
+            s.cache_.stencil_func.reset();
+            s.pass([&] { s.driver_.stencil_func_separate(face, func, reference, mask); });
+        }
+
+        static void APIENTRY stencil_op_separate(GLenum face, GLenum stencil_fail, GLenum depth_fail, GLenum depth_pass)
+        {
+            auto& s = shared();
+            s.cache_.stencil_op.reset();
+            s.pass([&] { s.driver_.stencil_op_separate(face, stencil_fail, depth_fail, depth_pass); });
+        }
+
+        static void APIENTRY stencil_mask_separate(GLenum face, GLuint mask)
+        {
+            auto& s = shared();
+            s.cache_.stencil_mask.reset();
+            s.pass([&] { s.driver_.stencil_mask_separate(face, mask); });
+        }
+
+        static void APIENTRY cull_face(GLenum mode)
+        {
+            auto& s = shared();
+            s.filter(s.cache_.cull_face, mode, [&] { s.driver_.cull_face(mode); });
+        }
+
+        static void APIENTRY delete_textures(GLsizei n, const GLuint* textures)
+        {
+            auto& s = shared();
+            for (auto& unit : s.cache_.textures)
+            {
+                for (auto& slot : unit)
+                    forget(slot, n, textures);
+            }
+            s.driver_.delete_textures(n, textures);
+        }
+
+        static void APIENTRY delete_vertex_arrays(GLsizei n, const GLuint* arrays)
+        {
+            auto& s = shared();
+            forget(s.cache_.vertex_array, n, arrays);
+            s.driver_.delete_vertex_arrays(n, arrays);
+        }
+
+        static void APIENTRY delete_framebuffers(GLsizei n, const GLuint* framebuffers)
+        {
+            auto& s = shared();
+            forget(s.cache_.draw_framebuffer, n, framebuffers);
+            forget(s.cache_.read_framebuffer, n, framebuffers);
+            s.driver_.delete_framebuffers(n, framebuffers);
+        }
+
+        static void APIENTRY delete_program(GLuint program)
+        {
+            auto& s = shared();
+            forget(s.cache_.program, 1, &program);
+            s.driver_.delete_program(program);
+        }
+    };
+
+    bool installed_{ false };
+    bool program_filter_{ false };
+    driver driver_{};
+    cache cache_{};
+    statistics frame_{};
+    statistics last_frame_{};
+    statistics total_{};
+    std::size_t frames_{ 0 };
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "gpu_arena.hpp"
+#include "frame_uniforms.hpp"
+#include "texture_registry.hpp"
+
+// GLFW from glfwInit() to glfwTerminate(), declared first in main() in place of the glfwInit() call:
+//   const glfw_session glfw;
+// Locals go in reverse order, so every Shader, Model and render_queue of main() deletes its GL objects while the
+// context is still there. The session then empties the process wide owners, which would outlive the context
+// otherwise: the textures of texture_registry, the blocks of the Mesh arenas and the stream of frame_uniforms.
+// Returning early from main() terminates GLFW the same way.
+class glfw_session
+{
+public:
+    glfw_session() { glfwInit(); }
+
+    glfw_session(const glfw_session&) = delete;
+    glfw_session& operator=(const glfw_session&) = delete;
+
+    ~glfw_session()
+    {
+        frame_uniforms::shared().clear();
+        texture_registry::shared().clear();
+        gpu_arena::vertices().clear();
+        gpu_arena::indices().clear();
+        glfwTerminate();
+    }
+};
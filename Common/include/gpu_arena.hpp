@@ -0,0 +1,306 @@
+#pragma once
+#include <map>
+#include <span>
+#include <format>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <iostream>
+#include <optional>
+#include <algorithm>
+#include <string_view>
+
+#include <glad/glad.h>
+
+#include "gl_handle.hpp"
+#include "gpu_memory.hpp"
+
+// Free ranges of [0, capacity), handed out best fit. Free ranges are kept twice, by offset to merge a freed range
+// with its neighbours and by size to find the smallest one that fits. Sizes and offsets are bytes, the allocator
+// itself never touches GL.
+class offset_allocator
+{
+public:
+    explicit offset_allocator(std::size_t capacity)
+        : capacity_{ capacity }
+    {
+        if (capacity_)
+            insert(0, capacity_);
+    }
+
+    // offset of size bytes, a multiple of alignment (a power of two), nothing if no free range fits them
+    [[nodiscard]] auto allocate(std::size_t size, std::size_t alignment) -> std::optional<std::size_t>
+    {
+        // the smallest ranges first, a range only fails on the padding the alignment needs
+        for (auto it = by_size_.lower_bound(size); it != by_size_.end(); ++it)
+        {
+            const auto [range_size, start] = *it;
+            const auto offset = (start + alignment - 1) & ~(alignment - 1);
+            if (offset - start + size > range_size)
+                continue;
+            by_size_.erase(it);
+            by_offset_.erase(start);
+            if (offset > start)
+                insert(start, offset - start);
+            if (const auto end = offset + size; end < start + range_size)
+                insert(end, start + range_size - end);
+            used_ += size;
+            return offset;
+        }
+        return std::nullopt;
+    }
+
+    // gives back a range allocate() returned
+    void free(std::size_t offset, std::size_t size)
+    {
+        used_ -= size;
+        auto next = by_offset_.lower_bound(offset);
+        if (next != by_offset_.end() && offset + size == next->first)
+        {
+            size += next->second;
+            erase(next);
+        }
+        if (auto previous = by_offset_.lower_bound(offset); previous != by_offset_.begin())
+        {
+            --previous;
+            if (previous->first + previous->second == offset)
+            {
+                offset = previous->first;
+                size += previous->second;
+                erase(previous);
+            }
+        }
+        insert(offset, size);
+    }
+
+    [[nodiscard]] auto capacity() const -> std::size_t { return capacity_; }
+    [[nodiscard]] auto used() const -> std::size_t { return used_; }
+    [[nodiscard]] auto free_ranges() const -> std::size_t { return by_offset_.size(); }
+    [[nodiscard]] auto largest_free() const -> std::size_t { return by_size_.empty() ? 0 : by_size_.rbegin()->first; }
+
+private:
+    void insert(std::size_t offset, std::size_t size)
+    {
+        by_offset_.emplace(offset, size);
+        by_size_.emplace(size, offset);
+    }
+
+    void erase(std::map<std::size_t, std::size_t>::iterator range)
+    {
+        auto [first, last] = by_size_.equal_range(range->second);
+        by_size_.erase(std::find_if(first, last, [&](const auto& entry) { return entry.second == range->first; }));
+        by_offset_.erase(range);
+    }
+
+    std::size_t capacity_;
+    std::size_t used_{ 0 };
+    // offset -> size, and size -> offset
+    std::map<std::size_t, std::size_t> by_offset_;
+    std::multimap<std::size_t, std::size_t> by_size_;
+};
+
+class gpu_arena;
+
+// Range of one buffer of a gpu_arena, given back to the arena with the handle. Move-only.
+class gpu_allocation
+{
+public:
+    gpu_allocation() = default;
+
+    gpu_allocation(const gpu_allocation&) = delete;
+    gpu_allocation& operator=(const gpu_allocation&) = delete;
+    gpu_allocation(gpu_allocation&& other) noexcept
+        : arena_{ std::exchange(other.arena_, nullptr) }, block_{ other.block_ }, buffer_{ other.buffer_ },
+          offset_{ other.offset_ }, size_{ other.size_ }
+    {
+    }
+    gpu_allocation& operator=(gpu_allocation&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            arena_ = std::exchange(other.arena_, nullptr);
+            block_ = other.block_;
+            buffer_ = other.buffer_;
+            offset_ = other.offset_;
+            size_ = other.size_;
+        }
+        return *this;
+    }
+
+    ~gpu_allocation() { reset(); }
+
+    inline void reset();
+
+    explicit operator bool() const { return arena_ != nullptr; }
+    // the buffer and the byte offset of the range in it
+    [[nodiscard]] auto buffer() const -> GLuint { return buffer_; }
+    [[nodiscard]] auto offset() const -> std::size_t { return offset_; }
+    [[nodiscard]] auto size() const -> std::size_t { return size_; }
+
+    // copies size bytes to at bytes into the range, through GL_COPY_WRITE_BUFFER
+    void upload(const void* data, std::size_t size, std::size_t at = 0) const
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(offset_ + at), static_cast<GLsizeiptr>(size), data);
+    }
+
+    template <typename T, std::size_t Extent>
+    void upload(std::span<T, Extent> values, std::size_t at = 0) const
+    {
+        upload(values.data(), values.size_bytes(), at);
+    }
+
+private:
+    friend class gpu_arena;
+
+    gpu_allocation(gpu_arena* arena, std::size_t block, GLuint buffer, std::size_t offset, std::size_t size)
+        : arena_{ arena }, block_{ block }, buffer_{ buffer }, offset_{ offset }, size_{ size }
+    {
+    }
+
+    gpu_arena* arena_{ nullptr };
+    std::size_t block_{ 0 };
+    GLuint buffer_{ 0 };
+    std::size_t offset_{ 0 };
+    std::size_t size_{ 0 };
+};
+
+// Static GPU data sub-allocated from a few large buffers instead of a buffer per object. Each buffer (block) is
+// block_size bytes of GL_STATIC_DRAW storage, carved up by an offset_allocator, and another one is added when none
+// has room left. Allocations larger than a block get a block of their own. Blocks stay until the arena goes, so a
+// model loaded again reuses the ranges the last one gave back.
+// Users bind the block and add offset() to their attribute and index offsets:
+//   glBindBuffer(GL_ARRAY_BUFFER, vertices.buffer());
+//   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)vertices.offset());
+// vertices() and indices() are the arenas of Mesh, index data lives apart from vertex data because some drivers
+// place a buffer by the target it is first bound to.
+// gpu_memory sees every allocation as a range of its block, owned by the owner_scope open when it is made, and the
+// block as the bytes no allocation holds.
+// Like the rest of the GL side it is only used from the context thread.
+class gpu_arena
+{
+public:
+    static constexpr std::size_t default_block_size = std::size_t{ 32 } << 20;
+
+    struct statistics
+    {
+        std::size_t blocks;
+        std::size_t capacity;
+        std::size_t used;
+        std::size_t allocations;
+        std::size_t free_ranges;
+        std::size_t largest_free;
+    };
+
+    explicit gpu_arena(std::string name, std::size_t block_size = default_block_size)
+        : name_{ std::move(name) }, block_size_{ block_size }
+    {
+    }
+
+    gpu_arena(const gpu_arena&) = delete;
+    gpu_arena& operator=(const gpu_arena&) = delete;
+
+    [[nodiscard]] static auto vertices() -> gpu_arena&
+    {
+        static gpu_arena arena{ "vertices" };
+        return arena;
+    }
+
+    [[nodiscard]] static auto indices() -> gpu_arena&
+    {
+        static gpu_arena arena{ "indices" };
+        return arena;
+    }
+
+    // size bytes at an offset that is a multiple of alignment (a power of two), empty when size is 0
+    [[nodiscard]] auto allocate(std::size_t size, std::size_t alignment = 16) -> gpu_allocation
+    {
+        if (size == 0)
+            return {};
+        for (std::size_t i = 0; i < blocks_.size(); i++)
+        {
+            if (auto offset = blocks_[i].allocator.allocate(size, alignment))
+                return allocated(i, *offset, size);
+        }
+        add_block(std::max(block_size_, size));
+        return allocated(blocks_.size() - 1, *blocks_.back().allocator.allocate(size, alignment), size);
+    }
+
+    // deletes the blocks, every allocation has to be given back first. vertices() and indices() outlive the
+    // context, glfw_session clears them before glfwTerminate()
+    void clear()
+    {
+        assert(allocations_ == 0 && "allocations still point into the blocks");
+        blocks_.clear();
+    }
+
+    [[nodiscard]] auto stats() const -> statistics
+    {
+        statistics stats{ blocks_.size(), 0, 0, allocations_, 0, 0 };
+        for (const auto& block : blocks_)
+        {
+            stats.capacity += block.allocator.capacity();
+            stats.used += block.allocator.used();
+            stats.free_ranges += block.allocator.free_ranges();
+            stats.largest_free = std::max(stats.largest_free, block.allocator.largest_free());
+        }
+        return stats;
+    }
+
+    void report() const
+    {
+        const auto s = stats();
+        std::cout << std::format("gpu arena {}: {} blocks, {:.2f} of {:.2f} MiB used by {} allocations, "
+                                 "{} free ranges, largest {:.2f} MiB\n",
+                                 name_, s.blocks, s.used / 1048576.0, s.capacity / 1048576.0, s.allocations,
+                                 s.free_ranges, s.largest_free / 1048576.0);
+    }
+
+private:
+    friend class gpu_allocation;
+
+    struct block
+    {
+        gl_buffer buffer;
+        offset_allocator allocator;
+    };
+
+    void add_block(std::size_t size)
+    {
+        // blocks are shared by everyone allocating from them, whoever triggered the block does not own it, only the
+        // ranges it is given
+        const gpu_memory::owner_scope owner{ "gpu arena " + name_ };
+        auto buffer = gl_buffer::create();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STATIC_DRAW);
+        blocks_.push_back({ std::move(buffer), offset_allocator{ size } });
+    }
+
+    auto allocated(std::size_t block, std::size_t offset, std::size_t size) -> gpu_allocation
+    {
+        ++allocations_;
+        gpu_memory::shared().allocate_range(blocks_[block].buffer, offset, size);
+        return { this, block, blocks_[block].buffer, offset, size };
+    }
+
+    void free(std::size_t block, std::size_t offset, std::size_t size)
+    {
+        blocks_[block].allocator.free(offset, size);
+        gpu_memory::shared().free_range(blocks_[block].buffer, offset);
+        --allocations_;
+    }
+
+    std::string name_;
+    std::size_t block_size_;
+    std::vector<block> blocks_;
+    std::size_t allocations_{ 0 };
+};
+
+inline void gpu_allocation::reset()
+{
+    if (arena_)
+        std::exchange(arena_, nullptr)->free(block_, offset_, size_);
+}
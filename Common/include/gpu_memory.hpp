@@ -0,0 +1,661 @@
+#pragma once
+#include <bit>
+#include <map>
+#include <array>
+#include <tuple>
+#include <format>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <utility>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+// GPU memory held by buffers, textures and renderbuffers, with the size, format and owner of each one.
+// install() swaps the glad entry points that give objects storage (glBufferData, glBufferStorage, glTexImage*,
+// glTexStorage*, glGenerateMipmap, glRenderbufferStorage*) and the ones that delete them for versions that record
+// what the bound object got, the same way gl_state filters state. So plain GL code is accounted for without
+// rewriting it. Objects given storage before install() are unknown.
+// Sizes are what the formats need, texel formats the driver pads (RGB8, RGB32F) at their padded size. The driver
+// adds alignment and metadata on top, so the totals are a lower bound that moves with the code, not with the driver.
+// The owner of an allocation is the innermost owner_scope open when it is made, e.g. the path of a Model or a pass
+// of a demo. Buffers carved up by a sub-allocator (gpu_arena) report the ranges it hands out as objects of their
+// own, through allocate_range() and free_range(), so a range belongs to whoever asked for it and the buffer keeps
+// only the bytes no range claims. report() prints the live objects, write_json() snapshots them to compare between
+// builds.
+// Installed together with gl_state, install it after gl_state and uninstall it first, both hook glDeleteTextures.
+// Like the rest of the GL side it is only used from the context thread.
+class gpu_memory
+{
+public:
+    enum class kind : std::uint8_t
+    {
+        buffer,
+        texture,
+        renderbuffer,
+        range,
+    };
+    static constexpr std::array<std::string_view, 4> kind_names{ "buffer", "texture", "renderbuffer", "range" };
+
+    struct resource
+    {
+        kind type;
+        // the buffer a range is part of
+        GLuint name;
+        // byte offset of a range in its buffer, 0 for whole objects
+        std::size_t offset;
+        GLenum target;
+        // internal format, 0 for buffers
+        GLenum format;
+        // of level 0, width is the size in bytes for buffers. depth counts array layers and cube faces too
+        GLsizei width;
+        GLsizei height;
+        GLsizei depth;
+        GLsizei levels;
+        GLsizei samples;
+        std::size_t bytes;
+        std::string owner;
+    };
+
+    // allocations made while it is open belong to owner, until an inner scope closes over it
+    class owner_scope
+    {
+    public:
+        explicit owner_scope(std::string owner) { shared().owners_.push_back(std::move(owner)); }
+        owner_scope(const owner_scope&) = delete;
+        owner_scope& operator=(const owner_scope&) = delete;
+        ~owner_scope() { shared().owners_.pop_back(); }
+    };
+
+    [[nodiscard]] static auto shared() -> gpu_memory&
+    {
+        static gpu_memory memory;
+        return memory;
+    }
+
+    gpu_memory(const gpu_memory&) = delete;
+    gpu_memory& operator=(const gpu_memory&) = delete;
+
+    // call once after gladLoadGLLoader, with the context current
+    void install()
+    {
+        if (installed_)
+            return;
+        installed_ = true;
+        entry_points([](auto& entry, auto& original, auto replacement) {
+            original = entry;
+            if (entry)
+                entry = replacement;
+        });
+    }
+
+    // gives the entry points back, what was recorded stays
+    void uninstall()
+    {
+        if (!installed_)
+            return;
+        installed_ = false;
+        entry_points([](auto& entry, auto& original, auto) {
+            if (original)
+                entry = original;
+        });
+    }
+
+    [[nodiscard]] bool installed() const { return installed_; }
+
+    // names the owner of an object that got its storage outside of any owner_scope, e.g. a render target of a demo
+    void set_owner(kind type, GLuint name, std::string owner)
+    {
+        if (const auto it = records_.find(key(type, name)); it != records_.end())
+            it->second.owner = std::move(owner);
+    }
+
+    // size bytes at offset of buffer handed out by a sub-allocator, owned by the innermost owner_scope instead of
+    // the owner of the buffer. Ignored for buffers given storage before install()
+    void allocate_range(GLuint buffer, std::size_t offset, std::size_t size)
+    {
+        if (records_.contains(key(kind::buffer, buffer)))
+            ranges_[{ buffer, offset }] = range_record{ size, owners_.empty() ? std::string{ "-" } : owners_.back() };
+    }
+
+    // gives back a range allocate_range() recorded, deleting the buffer gives back all of them
+    void free_range(GLuint buffer, std::size_t offset) { ranges_.erase({ buffer, offset }); }
+
+    // the live objects, largest first
+    [[nodiscard]] auto resources() const -> std::vector<resource>
+    {
+        std::vector<resource> result;
+        result.reserve(records_.size() + ranges_.size());
+        for (const auto& [key, record] : records_)
+        {
+            result.push_back(describe(record));
+            if (record.type == kind::buffer)
+                result.back().bytes -= claimed(record.name);
+        }
+        for (const auto& [at, range] : ranges_)
+        {
+            const auto& buffer = records_.at(key(kind::buffer, at.first));
+            result.push_back({ kind::range, at.first, at.second, buffer.target, 0, static_cast<GLsizei>(range.bytes), 1, 1, 1,
+                               0, range.bytes, range.owner });
+        }
+        std::ranges::sort(result, [](const resource& a, const resource& b) {
+            return a.bytes != b.bytes ? a.bytes > b.bytes : std::tie(a.type, a.name) < std::tie(b.type, b.name);
+        });
+        return result;
+    }
+
+    // buffers without the bytes of the ranges in them
+    [[nodiscard]] auto total(kind type) const -> std::size_t
+    {
+        std::size_t bytes = 0;
+        if (type == kind::range)
+        {
+            for (const auto& [at, range] : ranges_)
+                bytes += range.bytes;
+            return bytes;
+        }
+        for (const auto& [key, record] : records_)
+        {
+            if (record.type == type)
+                bytes += record.bytes() - (type == kind::buffer ? claimed(record.name) : 0);
+        }
+        return bytes;
+    }
+
+    [[nodiscard]] auto total() const -> std::size_t
+    {
+        std::size_t bytes = 0;
+        for (const auto& [key, record] : records_)
+            bytes += record.bytes();
+        return bytes;
+    }
+
+    // totals per kind and per owner, then the rows largest objects
+    void report(std::size_t rows = 20, std::ostream& os = std::cout) const
+    {
+        const auto all = resources();
+        os << std::format("gpu memory: {:.2f} MiB in {} objects", mib(total()), all.size());
+        for (std::size_t i = 0; i < kind_names.size(); i++)
+            os << std::format(", {} {:.2f} MiB", kind_names[i], mib(total(static_cast<kind>(i))));
+        os << '\n';
+        for (const auto& [owner, bytes] : by_owner(all))
+            os << std::format("  {:<48}{:>10.2f} MiB\n", owner, mib(bytes));
+        os << std::format("  {:<14}{:>6}  {:<22}{:>14}{:>7}{:>8}{:>10}  {}\n", "kind", "name", "format", "size", "levels",
+                          "samples", "KiB", "owner");
+        for (std::size_t i = 0; i < std::min(rows, all.size()); i++)
+        {
+            const auto& r = all[i];
+            const auto size = r.type == kind::buffer ? std::format("{}", r.width)
+                              : r.type == kind::range ? std::format("{}@{}", r.width, r.offset)
+                                                      : std::format("{}x{}x{}", r.width, r.height, r.depth);
+            os << std::format("  {:<14}{:>6}  {:<22}{:>14}{:>7}{:>8}{:>10.1f}  {}\n", kind_names[static_cast<std::size_t>(r.type)],
+                              r.name, format_name(r.format), size, r.levels, r.samples, r.bytes / 1024.0, r.owner);
+        }
+        if (all.size() > rows)
+            os << std::format("  ... {} more\n", all.size() - rows);
+    }
+
+    void write_json(std::ostream& os) const
+    {
+        const auto all = resources();
+        os << std::format("{{\n  \"total_bytes\": {},\n  \"kinds\": {{", total());
+        for (std::size_t i = 0; i < kind_names.size(); i++)
+            os << std::format("{} \"{}\": {}", i ? "," : "", kind_names[i], total(static_cast<kind>(i)));
+        os << " },\n  \"owners\": {";
+        const auto owners = by_owner(all);
+        for (std::size_t i = 0; i < owners.size(); i++)
+            os << std::format("{}\n    \"{}\": {}", i ? "," : "", escape(owners[i].first), owners[i].second);
+        os << "\n  },\n  \"resources\": [";
+        for (std::size_t i = 0; i < all.size(); i++)
+        {
+            const auto& r = all[i];
+            os << std::format("{}\n    {{ \"kind\": \"{}\", \"name\": {}, \"offset\": {}, \"target\": {}, \"format\": \"{}\", "
+                              "\"width\": {}, \"height\": {}, \"depth\": {}, \"levels\": {}, \"samples\": {}, \"bytes\": {}, "
+                              "\"owner\": \"{}\" }}",
+                              i ? "," : "", kind_names[static_cast<std::size_t>(r.type)], r.name, r.offset, r.target,
+                              format_name(r.format), r.width, r.height, r.depth, r.levels, r.samples, r.bytes, escape(r.owner));
+        }
+        os << "\n  ]\n}\n";
+    }
+
+    void save_json(const std::filesystem::path& path) const
+    {
+        std::ofstream file{ path };
+        write_json(file);
+        std::cout << std::format("gpu memory snapshot written to {}\n", path.generic_string());
+    }
+
+    // name of an internal format, hexadecimal for the ones without a table entry
+    [[nodiscard]] static auto format_name(GLenum format) -> std::string
+    {
+        if (format == 0)
+            return "-";
+        if (const auto* info = find_format(format))
+            return std::string{ info->name };
+        return std::format("0x{:04X}", format);
+    }
+
+    // bytes per texel of an internal format as stored, 4 for formats the table does not know
+    [[nodiscard]] static auto texel_size(GLenum format) -> std::size_t
+    {
+        const auto* info = find_format(format);
+        return info ? info->bytes : 4;
+    }
+
+private:
+    struct format_info
+    {
+        GLenum format;
+        std::string_view name;
+        std::size_t bytes;
+    };
+
+    // sized and unsized formats the demos use, RGB formats padded like drivers store them
+    static constexpr format_info formats[]{
+        { GL_RED, "RED", 1 },
+        { GL_R8, "R8", 1 },
+        { GL_RG, "RG", 2 },
+        { GL_RG8, "RG8", 2 },
+        { GL_RGB, "RGB", 4 },
+        { GL_RGB8, "RGB8", 4 },
+        { GL_RGBA, "RGBA", 4 },
+        { GL_RGBA8, "RGBA8", 4 },
+        { GL_SRGB, "SRGB", 4 },
+        { GL_SRGB8, "SRGB8", 4 },
+        { GL_SRGB_ALPHA, "SRGB_ALPHA", 4 },
+        { GL_SRGB8_ALPHA8, "SRGB8_ALPHA8", 4 },
+        { GL_RGB10_A2, "RGB10_A2", 4 },
+        { GL_R11F_G11F_B10F, "R11F_G11F_B10F", 4 },
+        { GL_R16F, "R16F", 2 },
+        { GL_RG16F, "RG16F", 4 },
+        { GL_RGB16F, "RGB16F", 8 },
+        { GL_RGBA16F, "RGBA16F", 8 },
+        { GL_R32F, "R32F", 4 },
+        { GL_RG32F, "RG32F", 8 },
+        { GL_RGB32F, "RGB32F", 16 },
+        { GL_RGBA32F, "RGBA32F", 16 },
+        { GL_DEPTH_COMPONENT, "DEPTH_COMPONENT", 4 },
+        { GL_DEPTH_COMPONENT16, "DEPTH_COMPONENT16", 2 },
+        { GL_DEPTH_COMPONENT24, "DEPTH_COMPONENT24", 4 },
+        { GL_DEPTH_COMPONENT32F, "DEPTH_COMPONENT32F", 4 },
+        { GL_DEPTH_STENCIL, "DEPTH_STENCIL", 4 },
+        { GL_DEPTH24_STENCIL8, "DEPTH24_STENCIL8", 4 },
+        { GL_DEPTH32F_STENCIL8, "DEPTH32F_STENCIL8", 8 },
+        { GL_STENCIL_INDEX8, "STENCIL_INDEX8", 1 },
+    };
+
+    static auto find_format(GLenum format) -> const format_info*
+    {
+        const auto it = std::ranges::find(formats, format, &format_info::format);
+        return it == std::end(formats) ? nullptr : &*it;
+    }
+
+    // one face of one level, or the whole storage of a buffer or renderbuffer
+    struct image
+    {
+        GLsizei width;
+        GLsizei height;
+        GLsizei depth;
+        std::size_t bytes;
+    };
+
+    struct record
+    {
+        kind type;
+        GLuint name;
+        GLenum target;
+        GLenum format;
+        GLsizei samples;
+        std::string owner;
+        // face << 16 | level -> image
+        std::unordered_map<std::uint32_t, image> images;
+
+        [[nodiscard]] auto bytes() const -> std::size_t
+        {
+            std::size_t total = 0;
+            for (const auto& [key, img] : images)
+                total += img.bytes;
+            return total;
+        }
+    };
+
+    struct range_record
+    {
+        std::size_t bytes;
+        std::string owner;
+    };
+
+    // the entry points glad loaded, the hooks forward to these
+    struct driver
+    {
+        PFNGLBUFFERDATAPROC buffer_data;
+        PFNGLBUFFERSTORAGEPROC buffer_storage;
+        PFNGLTEXIMAGE2DPROC tex_image_2d;
+        PFNGLTEXIMAGE3DPROC tex_image_3d;
+        PFNGLTEXIMAGE2DMULTISAMPLEPROC tex_image_2d_multisample;
+        PFNGLTEXSTORAGE2DPROC tex_storage_2d;
+        PFNGLTEXSTORAGE3DPROC tex_storage_3d;
+        PFNGLGENERATEMIPMAPPROC generate_mipmap;
+        PFNGLRENDERBUFFERSTORAGEPROC renderbuffer_storage;
+        PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC renderbuffer_storage_multisample;
+        PFNGLDELETEBUFFERSPROC delete_buffers;
+        PFNGLDELETETEXTURESPROC delete_textures;
+        PFNGLDELETERENDERBUFFERSPROC delete_renderbuffers;
+    };
+
+    gpu_memory() = default;
+
+    // visit(glad entry point, driver entry point, hook) for every hooked function
+    template <typename Visit>
+    void entry_points(Visit visit)
+    {
+        visit(glad_glBufferData, driver_.buffer_data, &hooks::buffer_data);
+        visit(glad_glBufferStorage, driver_.buffer_storage, &hooks::buffer_storage);
+        visit(glad_glTexImage2D, driver_.tex_image_2d, &hooks::tex_image_2d);
+        visit(glad_glTexImage3D, driver_.tex_image_3d, &hooks::tex_image_3d);
+        visit(glad_glTexImage2DMultisample, driver_.tex_image_2d_multisample, &hooks::tex_image_2d_multisample);
+        visit(glad_glTexStorage2D, driver_.tex_storage_2d, &hooks::tex_storage_2d);
+        visit(glad_glTexStorage3D, driver_.tex_storage_3d, &hooks::tex_storage_3d);
+        visit(glad_glGenerateMipmap, driver_.generate_mipmap, &hooks::generate_mipmap);
+        visit(glad_glRenderbufferStorage, driver_.renderbuffer_storage, &hooks::renderbuffer_storage);
+        visit(glad_glRenderbufferStorageMultisample, driver_.renderbuffer_storage_multisample, &hooks::renderbuffer_storage_multisample);
+        visit(glad_glDeleteBuffers, driver_.delete_buffers, &hooks::delete_buffers);
+        visit(glad_glDeleteTextures, driver_.delete_textures, &hooks::delete_textures);
+        visit(glad_glDeleteRenderbuffers, driver_.delete_renderbuffers, &hooks::delete_renderbuffers);
+    }
+
+    static auto key(kind type, GLuint name) -> std::uint64_t
+    {
+        return std::uint64_t{ static_cast<std::uint8_t>(type) } << 32 | name;
+    }
+
+    // bytes of buffer the ranges in it claim
+    auto claimed(GLuint buffer) const -> std::size_t
+    {
+        std::size_t bytes = 0;
+        for (auto it = ranges_.lower_bound({ buffer, 0 }); it != ranges_.end() && it->first.first == buffer; ++it)
+            bytes += it->second.bytes;
+        return bytes;
+    }
+
+    static auto mib(std::size_t bytes) -> double { return bytes / 1048576.0; }
+
+    // the object bound to target, through the binding query of the target. 0 for targets not tracked
+    static auto bound(GLenum target) -> GLuint
+    {
+        GLenum binding = 0;
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER: binding = GL_ARRAY_BUFFER_BINDING; break;
+        case GL_ELEMENT_ARRAY_BUFFER: binding = GL_ELEMENT_ARRAY_BUFFER_BINDING; break;
+        case GL_UNIFORM_BUFFER: binding = GL_UNIFORM_BUFFER_BINDING; break;
+        case GL_COPY_READ_BUFFER: binding = GL_COPY_READ_BUFFER_BINDING; break;
+        case GL_COPY_WRITE_BUFFER: binding = GL_COPY_WRITE_BUFFER_BINDING; break;
+        case GL_TEXTURE_BUFFER: binding = GL_TEXTURE_BUFFER_BINDING; break;
+        case GL_DRAW_INDIRECT_BUFFER: binding = GL_DRAW_INDIRECT_BUFFER_BINDING; break;
+        case GL_PIXEL_PACK_BUFFER: binding = GL_PIXEL_PACK_BUFFER_BINDING; break;
+        case GL_PIXEL_UNPACK_BUFFER: binding = GL_PIXEL_UNPACK_BUFFER_BINDING; break;
+        case GL_SHADER_STORAGE_BUFFER: binding = GL_SHADER_STORAGE_BUFFER_BINDING; break;
+        case GL_TRANSFORM_FEEDBACK_BUFFER: binding = GL_TRANSFORM_FEEDBACK_BUFFER_BINDING; break;
+        case GL_TEXTURE_1D: binding = GL_TEXTURE_BINDING_1D; break;
+        case GL_TEXTURE_2D: binding = GL_TEXTURE_BINDING_2D; break;
+        case GL_TEXTURE_3D: binding = GL_TEXTURE_BINDING_3D; break;
+        case GL_TEXTURE_RECTANGLE: binding = GL_TEXTURE_BINDING_RECTANGLE; break;
+        case GL_TEXTURE_1D_ARRAY: binding = GL_TEXTURE_BINDING_1D_ARRAY; break;
+        case GL_TEXTURE_2D_ARRAY: binding = GL_TEXTURE_BINDING_2D_ARRAY; break;
+        case GL_TEXTURE_CUBE_MAP: binding = GL_TEXTURE_BINDING_CUBE_MAP; break;
+        case GL_TEXTURE_2D_MULTISAMPLE: binding = GL_TEXTURE_BINDING_2D_MULTISAMPLE; break;
+        case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: binding = GL_TEXTURE_BINDING_2D_MULTISAMPLE_ARRAY; break;
+        case GL_RENDERBUFFER: binding = GL_RENDERBUFFER_BINDING; break;
+        default: return 0;
+        }
+        GLint name = 0;
+        glGetIntegerv(binding, &name);
+        return static_cast<GLuint>(name);
+    }
+
+    // the texture target of a target images are specified for, and the cube face it names
+    static auto texture_target(GLenum target) -> std::pair<GLenum, std::uint32_t>
+    {
+        if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)
+            return { GL_TEXTURE_CUBE_MAP, target - GL_TEXTURE_CUBE_MAP_POSITIVE_X };
+        return { target, 0 };
+    }
+
+    // the record of the object bound to target, restarted if it changes format or kind. null if nothing is bound
+    auto bound_record(kind type, GLenum target, GLenum format, GLsizei samples, bool respecify) -> record*
+    {
+        const auto name = bound(target);
+        if (name == 0)
+            return nullptr;
+        auto& r = records_[key(type, name)];
+        if (respecify || r.images.empty() || r.format != format || r.samples != samples)
+            r = record{ type, name, target, format, samples, owners_.empty() ? std::string{ "-" } : owners_.back(), {} };
+        return &r;
+    }
+
+    void specify(GLenum target, GLint level, GLenum format, GLsizei width, GLsizei height, GLsizei depth, GLsizei samples)
+    {
+        const auto [texture, face] = texture_target(target);
+        // the first image of level 0 starts the texture over, other images add to it
+        auto* r = bound_record(kind::texture, texture, format, samples, level == 0 && face == 0);
+        if (!r)
+            return;
+        r->images[face << 16 | static_cast<std::uint32_t>(level)] =
+            image{ width, height, depth, static_cast<std::size_t>(width) * height * depth * texel_size(format) * std::max(samples, 1) };
+    }
+
+    // levels of immutable storage, or of a mip chain, halving every dimension but the layers of arrays and cube faces
+    void specify_levels(GLenum target, GLsizei levels, GLenum format, GLsizei width, GLsizei height, GLsizei depth)
+    {
+        const bool layered = target != GL_TEXTURE_3D;
+        const GLsizei faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+        for (GLsizei level = 0; level < levels; level++)
+        {
+            for (GLsizei face = 0; face < faces; face++)
+                specify(faces > 1 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target, level, format, std::max(width >> level, 1),
+                        std::max(height >> level, 1), layered ? depth : std::max(depth >> level, 1), 0);
+        }
+    }
+
+    void specify_storage(kind type, GLenum target, GLenum format, GLsizei width, GLsizei height, GLsizei samples)
+    {
+        if (auto* r = bound_record(type, target, format, samples, true))
+            r->images[0] = image{ width, height, 1, static_cast<std::size_t>(width) * height * texel_size(format) * std::max(samples, 1) };
+    }
+
+    void specify_buffer(GLenum target, GLsizeiptr size)
+    {
+        if (auto* r = bound_record(kind::buffer, target, 0, 0, true))
+            r->images[0] = image{ static_cast<GLsizei>(size), 1, 1, static_cast<std::size_t>(size) };
+    }
+
+    void forget(kind type, GLsizei n, const GLuint* names)
+    {
+        for (GLsizei i = 0; i < n; i++)
+        {
+            records_.erase(key(type, names[i]));
+            if (type == kind::buffer)
+                std::erase_if(ranges_, [&](const auto& range) { return range.first.first == names[i]; });
+        }
+    }
+
+    auto describe(const record& r) const -> resource
+    {
+        resource result{ r.type, r.name, 0, r.target, r.format, 0, 0, 0, 0, r.samples, r.bytes(), r.owner };
+        std::uint32_t levels = 0;
+        GLsizei faces = 0;
+        for (const auto& [key, img] : r.images)
+        {
+            levels = std::max(levels, (key & 0xffff) + 1);
+            faces = std::max(faces, static_cast<GLsizei>(key >> 16) + 1);
+            if (key == 0)
+            {
+                result.width = img.width;
+                result.height = img.height;
+                result.depth = img.depth;
+            }
+        }
+        result.levels = static_cast<GLsizei>(levels);
+        if (r.target == GL_TEXTURE_CUBE_MAP)
+            result.depth = faces;
+        return result;
+    }
+
+    static auto by_owner(const std::vector<resource>& all) -> std::vector<std::pair<std::string, std::size_t>>
+    {
+        std::vector<std::pair<std::string, std::size_t>> owners;
+        for (const auto& r : all)
+        {
+            auto it = std::ranges::find(owners, r.owner, &std::pair<std::string, std::size_t>::first);
+            if (it == owners.end())
+                owners.emplace_back(r.owner, r.bytes);
+            else
+                it->second += r.bytes;
+        }
+        std::ranges::sort(owners, [](const auto& a, const auto& b) { return a.second > b.second; });
+        return owners;
+    }
+
+    static auto escape(std::string_view text) -> std::string
+    {
+        std::string result;
+        result.reserve(text.size());
+        for (const auto c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            if (static_cast<unsigned char>(c) < 0x20)
+                result += std::format("\\u{:04x}", static_cast<unsigned>(c));
+            else
+                result += c;
+        }
+        return result;
+    }
+
+    struct hooks
+    {
+        static void APIENTRY buffer_data(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+        {
+            auto& s = shared();
+            s.specify_buffer(target, size);
+            s.driver_.buffer_data(target, size, data, usage);
+        }
+
+        static void APIENTRY buffer_storage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+        {
+            auto& s = shared();
+            s.specify_buffer(target, size);
+            s.driver_.buffer_storage(target, size, data, flags);
+        }
+
+        static void APIENTRY tex_image_2d(GLenum target, GLint level, GLint format, GLsizei width, GLsizei height, GLint border,
+                                          GLenum pixel_format, GLenum type, const void* pixels)
+        {
+            auto& s = shared();
+            if (target != GL_PROXY_TEXTURE_2D && target != GL_PROXY_TEXTURE_CUBE_MAP)
+                s.specify(target, level, static_cast<GLenum>(format), width, height, 1, 0);
+            s.driver_.tex_image_2d(target, level, format, width, height, border, pixel_format, type, pixels);
+        }
+
+        static void APIENTRY tex_image_3d(GLenum target, GLint level, GLint format, GLsizei width, GLsizei height, GLsizei depth,
+                                          GLint border, GLenum pixel_format, GLenum type, const void* pixels)
+        {
+            auto& s = shared();
+            if (target != GL_PROXY_TEXTURE_3D && target != GL_PROXY_TEXTURE_2D_ARRAY)
+                s.specify(target, level, static_cast<GLenum>(format), width, height, depth, 0);
+            s.driver_.tex_image_3d(target, level, format, width, height, depth, border, pixel_format, type, pixels);
+        }
+
+        static void APIENTRY tex_image_2d_multisample(GLenum target, GLsizei samples, GLenum format, GLsizei width, GLsizei height,
+                                                      GLboolean fixed_locations)
+        {
+            auto& s = shared();
+            s.specify(target, 0, format, width, height, 1, samples);
+            s.driver_.tex_image_2d_multisample(target, samples, format, width, height, fixed_locations);
+        }
+
+        static void APIENTRY tex_storage_2d(GLenum target, GLsizei levels, GLenum format, GLsizei width, GLsizei height)
+        {
+            auto& s = shared();
+            s.specify_levels(target, levels, format, width, height, 1);
+            s.driver_.tex_storage_2d(target, levels, format, width, height);
+        }
+
+        static void APIENTRY tex_storage_3d(GLenum target, GLsizei levels, GLenum format, GLsizei width, GLsizei height, GLsizei depth)
+        {
+            auto& s = shared();
+            s.specify_levels(target, levels, format, width, height, depth);
+            s.driver_.tex_storage_3d(target, levels, format, width, height, depth);
+        }
+
+        // fills the levels below the base one, the record gets the full chain of the base image
+        static void APIENTRY generate_mipmap(GLenum target)
+        {
+            auto& s = shared();
+            if (const auto name = bound(target))
+            {
+                if (const auto it = s.records_.find(key(kind::texture, name)); it != s.records_.end())
+                {
+                    const auto base = it->second.images.find(0);
+                    if (base != it->second.images.end())
+                    {
+                        const auto [width, height, depth, bytes] = base->second;
+                        const auto levels = static_cast<GLsizei>(std::bit_width(static_cast<unsigned>(std::max(width, height))));
+                        s.specify_levels(target, levels, it->second.format, width, height, depth);
+                    }
+                }
+            }
+            s.driver_.generate_mipmap(target);
+        }
+
+        static void APIENTRY renderbuffer_storage(GLenum target, GLenum format, GLsizei width, GLsizei height)
+        {
+            auto& s = shared();
+            s.specify_storage(kind::renderbuffer, target, format, width, height, 0);
+            s.driver_.renderbuffer_storage(target, format, width, height);
+        }
+
+        static void APIENTRY renderbuffer_storage_multisample(GLenum target, GLsizei samples, GLenum format, GLsizei width,
+                                                              GLsizei height)
+        {
+            auto& s = shared();
+            s.specify_storage(kind::renderbuffer, target, format, width, height, samples);
+            s.driver_.renderbuffer_storage_multisample(target, samples, format, width, height);
+        }
+
+        static void APIENTRY delete_buffers(GLsizei n, const GLuint* buffers)
+        {
+            auto& s = shared();
+            s.forget(kind::buffer, n, buffers);
+            s.driver_.delete_buffers(n, buffers);
+        }
+
+        static void APIENTRY delete_textures(GLsizei n, const GLuint* textures)
+        {
+            auto& s = shared();
+            s.forget(kind::texture, n, textures);
+            s.driver_.delete_textures(n, textures);
+        }
+
+        static void APIENTRY delete_renderbuffers(GLsizei n, const GLuint* renderbuffers)
+        {
+            auto& s = shared();
+            s.forget(kind::renderbuffer, n, renderbuffers);
+            s.driver_.delete_renderbuffers(n, renderbuffers);
+        }
+    };
+
+    bool installed_{ false };
+    driver driver_{};
+    std::unordered_map<std::uint64_t, record> records_;
+    // (buffer, offset) -> range
+    std::map<std::pair<GLuint, std::size_t>, range_record> ranges_;
+    std::vector<std::string> owners_;
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <span>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <string_view>
+
+// 64 bit FNV-1a, used for cache keys and content hashing.
+inline constexpr std::uint64_t fnv_offset_basis = 14695981039346656037ull;
+inline constexpr std::uint64_t fnv_prime = 1099511628211ull;
+
+[[nodiscard]] inline auto fnv1a(std::span<const std::byte> bytes, std::uint64_t hash = fnv_offset_basis)
+    -> std::uint64_t
+{
+    for (auto b : bytes)
+    {
+        hash ^= static_cast<std::uint64_t>(b);
+        hash *= fnv_prime;
+    }
+    return hash;
+}
+
+// same hash as of the bytes of text, usable in constant expressions
+[[nodiscard]] constexpr auto fnv1a(std::string_view text, std::uint64_t hash = fnv_offset_basis)
+    -> std::uint64_t
+{
+    for (auto c : text)
+    {
+        hash ^= static_cast<std::uint64_t>(static_cast<unsigned char>(c));
+        hash *= fnv_prime;
+    }
+    return hash;
+}
+
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+[[nodiscard]] auto fnv1a(const T& value, std::uint64_t hash) -> std::uint64_t
+{
+    return fnv1a(std::as_bytes(std::span{ &value, 1 }), hash);
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <utility>
+
+#include <glad/glad.h>
+
+#include "hash.hpp"
+#include "stb_image.h"
+#include "mapped_file.hpp"
+
+// decoded 8 bit image, owns the stb_image pixel buffer.
+// decoding is thread safe, uploading must happen on the GL thread.
+// the file is hashed while it is mapped for decoding, texture_registry::resolve() shares images by that hash
+class decoded_image
+{
+public:
+    decoded_image() = default;
+
+    explicit decoded_image(const std::string& filename)
+    {
+        const mapped_file file{ filename };
+        if (!file)
+            return;
+        const auto bytes = file.bytes();
+        content_ = fnv1a(bytes);
+        data_ = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(bytes.data()), static_cast<int>(bytes.size()), &width_, &height_,
+                                      &components_, 0);
+    }
+
+    decoded_image(const decoded_image&) = delete;
+    decoded_image& operator=(const decoded_image&) = delete;
+
+    decoded_image(decoded_image&& other) noexcept
+        : data_{ std::exchange(other.data_, nullptr) },
+          width_{ other.width_ }, height_{ other.height_ }, components_{ other.components_ }, content_{ other.content_ }
+    {
+    }
+
+    decoded_image& operator=(decoded_image&& other) noexcept
+    {
+        if (this != &other)
+        {
+            stbi_image_free(data_);
+            data_ = std::exchange(other.data_, nullptr);
+            width_ = other.width_;
+            height_ = other.height_;
+            components_ = other.components_;
+            content_ = other.content_;
+        }
+        return *this;
+    }
+
+    ~decoded_image()
+    {
+        stbi_image_free(data_);
+    }
+
+    [[nodiscard]] const unsigned char* data() const { return data_; }
+    [[nodiscard]] int width() const { return width_; }
+    [[nodiscard]] int height() const { return height_; }
+    [[nodiscard]] int components() const { return components_; }
+    // FNV-1a of the file bytes, 0 if the file could not be read
+    [[nodiscard]] std::uint64_t content() const { return content_; }
+
+    [[nodiscard]] GLenum format() const
+    {
+        switch (components_)
+        {
+        case 1: return GL_RED;
+        case 3: return GL_RGB;
+        case 4: return GL_RGBA;
+        default: return GL_NONE;
+        }
+    }
+
+    explicit operator bool() const { return data_ != nullptr && format() != GL_NONE; }
+
+private:
+    unsigned char* data_{ nullptr };
+    int width_{ 0 };
+    int height_{ 0 };
+    int components_{ 0 };
+    std::uint64_t content_{ 0 };
+};
+
+// uploads a decoded image into an existing texture name with mipmaps and repeat wrapping.
+inline void upload_image(GLuint texture_id, const decoded_image& image)
+{
+    const auto format = image.format();
+
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width(), image.height(), 0, format, GL_UNSIGNED_BYTE, image.data());
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
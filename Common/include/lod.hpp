@@ -0,0 +1,47 @@
+#pragma once
+#include <span>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "camera.hpp"
+#include "mesh.hpp"
+
+// Level of detail selection by screen space error.
+// a level is good enough when its simplification error, projected at the distance of the mesh,
+// covers at most max_pixel_error pixels of the viewport height.
+
+// pixels covered by one world unit at distance one, for the vertical field of view of the camera
+[[nodiscard]] inline auto lod_pixel_scale(const Camera& camera, float viewport_height) -> float
+{
+    return viewport_height / (2.0f * std::tan(glm::radians(camera.Zoom) * 0.5f));
+}
+
+// coarsest level whose error, scaled to world units, stays within max_pixel_error at distance
+[[nodiscard]] inline auto select_lod(std::span<const MeshLod> lods, float distance, float world_scale, float pixel_scale,
+                                     float max_pixel_error = 1.0f)
+    -> std::size_t
+{
+    distance = std::max(distance, 1e-4f);
+    for (auto i = lods.size(); i-- > 1;)
+    {
+        if (lods[i].error * world_scale * pixel_scale / distance <= max_pixel_error)
+            return i;
+    }
+    return 0;
+}
+
+// level of mesh placed with model, the distance is measured from the camera to its bounding sphere
+[[nodiscard]] inline auto select_lod(const Mesh& mesh, const glm::mat4& model, const Camera& camera, float viewport_height,
+                                     float max_pixel_error = 1.0f)
+    -> std::size_t
+{
+    if (mesh.lods.size() < 2)
+        return 0;
+
+    const auto scale = std::max({ glm::length(glm::vec3{ model[0] }), glm::length(glm::vec3{ model[1] }), glm::length(glm::vec3{ model[2] }) });
+    const auto center = glm::vec3{ model * glm::vec4{ mesh.boundsCenter, 1.0f } };
+    const auto distance = glm::length(center - camera.Position) - mesh.boundsRadius * scale;
+    return select_lod(mesh.lods, distance, scale, lod_pixel_scale(camera, viewport_height), max_pixel_error);
+}
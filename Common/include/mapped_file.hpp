@@ -0,0 +1,115 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// read-only memory mapping of a whole file, move-only.
+// an empty or missing file yields an invalid mapping (operator bool() == false).
+class mapped_file
+{
+public:
+    mapped_file() = default;
+
+    explicit mapped_file(const std::filesystem::path& path)
+    {
+#ifdef _WIN32
+        file_ = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER size{};
+        if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+            return;
+        mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_ == nullptr)
+            return;
+        data_ = static_cast<const std::byte*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (data_)
+            size_ = static_cast<std::size_t>(size.QuadPart);
+#else
+        fd_ = ::open(path.c_str(), O_RDONLY);
+        if (fd_ < 0)
+            return;
+        struct stat st{};
+        if (::fstat(fd_, &st) != 0 || st.st_size == 0)
+            return;
+        auto* addr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (addr == MAP_FAILED)
+            return;
+        data_ = static_cast<const std::byte*>(addr);
+        size_ = static_cast<std::size_t>(st.st_size);
+#endif
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    mapped_file(mapped_file&& other) noexcept
+    {
+        swap(other);
+    }
+
+    mapped_file& operator=(mapped_file&& other) noexcept
+    {
+        if (this != &other)
+        {
+            mapped_file{ std::move(other) }.swap(*this);
+        }
+        return *this;
+    }
+
+    ~mapped_file()
+    {
+#ifdef _WIN32
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+        if (data_) ::munmap(const_cast<std::byte*>(data_), size_);
+        if (fd_ >= 0) ::close(fd_);
+#endif
+    }
+
+    [[nodiscard]] const std::byte* data() const { return data_; }
+    [[nodiscard]] std::size_t size() const { return size_; }
+    [[nodiscard]] std::span<const std::byte> bytes() const { return { data_, size_ }; }
+
+    explicit operator bool() const { return data_ != nullptr; }
+
+    void swap(mapped_file& other) noexcept
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+#ifdef _WIN32
+        std::swap(file_, other.file_);
+        std::swap(mapping_, other.mapping_);
+#else
+        std::swap(fd_, other.fd_);
+#endif
+    }
+
+private:
+    const std::byte* data_{ nullptr };
+    std::size_t size_{ 0 };
+#ifdef _WIN32
+    HANDLE file_{ INVALID_HANDLE_VALUE };
+    HANDLE mapping_{ nullptr };
+#else
+    int fd_{ -1 };
+#endif
+};
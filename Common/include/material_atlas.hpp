@@ -0,0 +1,228 @@
+#pragma once
+#include <span>
+#include <array>
+#include <format>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "gl_handle.hpp"
+
+// The material textures of a set of meshes packed into one GL_TEXTURE_2D_ARRAY per texture type, so the meshes
+// share one binding set and can be drawn together (mesh_batch). Each array takes the size most of its textures
+// have, the others are resampled to it; every layer is RGBA8. The textures are read back from GL once, the 2D
+// textures stay as they are for the per mesh paths.
+// layers() has one texel per mesh, the layer of its first diffuse, specular, normal and height texture, -1 where
+// it has none. It is meant as the draw data of a mesh_batch of the same meshes:
+//   uniform samplerBuffer drawData;
+//   flat out vec4 Layers;  Layers = texelFetch(drawData, int(aDrawID));          // vertex shader
+//   struct MaterialArray { sampler2DArray diffuse; ... };                          // fragment shader
+//   uniform MaterialArray materialArray;
+//   texture(materialArray.diffuse, vec3(TexCoords, Layers.x));
+class material_atlas
+{
+public:
+    static constexpr std::array<std::string_view, 4> types{ "diffuse", "specular", "normal", "height" };
+
+    struct statistics
+    {
+        std::size_t meshes;
+        std::size_t textures;
+        std::size_t arrays;
+        std::size_t resampled;
+        // texture binds and draws of one frame drawn mesh by mesh, and with the atlas and a mesh_batch
+        std::size_t per_mesh_binds;
+        std::size_t per_mesh_draws;
+        std::size_t atlas_binds;
+        std::size_t atlas_draws;
+    };
+
+    material_atlas() = default;
+
+    explicit material_atlas(std::span<const Mesh> meshes)
+    {
+        GLint max_layers = 256;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+
+        layers_.assign(meshes.size(), glm::vec4{ -1.0f });
+        stats_.meshes = meshes.size();
+        stats_.per_mesh_draws = meshes.size();
+        for (std::size_t type = 0; type < types.size(); type++)
+        {
+            // distinct textures of this type in first use order, and the layer each one gets
+            std::vector<GLuint> textures;
+            std::unordered_map<GLuint, std::size_t> layer_of;
+            for (std::size_t i = 0; i < meshes.size(); i++)
+            {
+                const auto& mesh_textures = meshes[i].textures;
+                const auto it = std::find_if(mesh_textures.begin(), mesh_textures.end(),
+                                             [&](const Texture& t) { return t.type == types[type]; });
+                if (it == mesh_textures.end() || !size_of(it->id).x)
+                    continue;
+                const auto [entry, added] = layer_of.try_emplace(it->id, textures.size());
+                if (added)
+                    textures.push_back(it->id);
+                layers_[i][static_cast<glm::length_t>(type)] = static_cast<float>(entry->second);
+            }
+            if (textures.empty())
+                continue;
+            if (textures.size() > static_cast<std::size_t>(max_layers))
+            {
+                std::cout << std::format("material atlas: {} {} textures exceed {} layers, not packed\n", textures.size(),
+                                         types[type], max_layers);
+                for (auto& layers : layers_)
+                    layers[static_cast<glm::length_t>(type)] = -1.0f;
+                continue;
+            }
+            arrays_[type] = pack(textures);
+            stats_.textures += textures.size();
+            ++stats_.arrays;
+        }
+        for (const auto& mesh : meshes)
+            stats_.per_mesh_binds += mesh.textures.size();
+        // the arrays and the draw data buffer with the layers
+        stats_.atlas_binds = stats_.arrays + 1;
+        stats_.atlas_draws = meshes.empty() ? 0 : 1;
+    }
+
+    material_atlas(const material_atlas&) = delete;
+    material_atlas& operator=(const material_atlas&) = delete;
+    material_atlas(material_atlas&&) noexcept = default;
+    material_atlas& operator=(material_atlas&&) noexcept = default;
+
+    // also true for an atlas moved from, its arrays go with the move
+    [[nodiscard]] auto empty() const -> bool
+    {
+        return std::ranges::none_of(arrays_, [](const gl_texture& array) { return array.id() != 0; });
+    }
+    [[nodiscard]] auto layers() const -> std::span<const glm::vec4> { return layers_; }
+    [[nodiscard]] auto array(std::size_t type) const -> GLuint { return arrays_[type]; }
+    [[nodiscard]] auto stats() const -> const statistics& { return stats_; }
+
+    // binds the arrays to first_unit and up and points the samplers materialArray.<type> of shader at them,
+    // returns the first unit left free
+    auto bind(const Shader& shader, GLuint first_unit = 0) const -> GLuint
+    {
+        static constexpr uniform_name samplers[]{ "materialArray.diffuse", "materialArray.specular", "materialArray.normal",
+                                                  "materialArray.height" };
+        auto unit = first_unit;
+        for (std::size_t type = 0; type < types.size(); type++)
+        {
+            if (!arrays_[type])
+                continue;
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, arrays_[type]);
+            shader.set(samplers[type], unit);
+            ++unit;
+        }
+        return unit;
+    }
+
+    void report(std::string_view name) const
+    {
+        std::cout << std::format("material atlas {}: {} meshes, {} textures in {} arrays, {} resampled\n", name,
+                                 stats_.meshes, stats_.textures, stats_.arrays, stats_.resampled);
+        std::cout << std::format("  per frame, mesh by mesh {} binds {} draws, atlas {} binds {} draw\n", stats_.per_mesh_binds,
+                                 stats_.per_mesh_draws, stats_.atlas_binds, stats_.atlas_draws);
+    }
+
+private:
+    static auto size_of(GLuint texture) -> glm::ivec2
+    {
+        glm::ivec2 size{ 0 };
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &size.x);
+        glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &size.y);
+        return size;
+    }
+
+    // bilinear, texel centers mapped onto each other
+    static auto resample(const std::vector<std::uint8_t>& source, glm::ivec2 from, glm::ivec2 to) -> std::vector<std::uint8_t>
+    {
+        std::vector<std::uint8_t> result(static_cast<std::size_t>(to.x) * to.y * 4);
+        const auto scale = glm::vec2{ from } / glm::vec2{ to };
+        for (int y = 0; y < to.y; y++)
+        {
+            const auto sy = std::clamp((y + 0.5f) * scale.y - 0.5f, 0.0f, static_cast<float>(from.y - 1));
+            const auto y0 = static_cast<int>(sy);
+            const auto y1 = std::min(y0 + 1, from.y - 1);
+            const auto fy = sy - y0;
+            for (int x = 0; x < to.x; x++)
+            {
+                const auto sx = std::clamp((x + 0.5f) * scale.x - 0.5f, 0.0f, static_cast<float>(from.x - 1));
+                const auto x0 = static_cast<int>(sx);
+                const auto x1 = std::min(x0 + 1, from.x - 1);
+                const auto fx = sx - x0;
+                auto texel = [&](int tx, int ty, int c) {
+                    return static_cast<float>(source[(static_cast<std::size_t>(ty) * from.x + tx) * 4 + c]);
+                };
+                for (int c = 0; c < 4; c++)
+                {
+                    const auto top = texel(x0, y0, c) + (texel(x1, y0, c) - texel(x0, y0, c)) * fx;
+                    const auto bottom = texel(x0, y1, c) + (texel(x1, y1, c) - texel(x0, y1, c)) * fx;
+                    result[(static_cast<std::size_t>(y) * to.x + x) * 4 + c] = static_cast<std::uint8_t>(top + (bottom - top) * fy + 0.5f);
+                }
+            }
+        }
+        return result;
+    }
+
+    // one array with a layer per texture, at the size most of them have
+    auto pack(const std::vector<GLuint>& textures) -> gl_texture
+    {
+        std::vector<glm::ivec2> sizes;
+        sizes.reserve(textures.size());
+        for (const auto texture : textures)
+            sizes.push_back(size_of(texture));
+        auto layer_size = sizes[0];
+        std::size_t most = 0;
+        for (const auto& size : sizes)
+        {
+            const auto count = static_cast<std::size_t>(std::count(sizes.begin(), sizes.end(), size));
+            if (count > most)
+            {
+                most = count;
+                layer_size = size;
+            }
+        }
+
+        auto array = gl_texture::create();
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, layer_size.x, layer_size.y, static_cast<GLsizei>(textures.size()), 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+        std::vector<std::uint8_t> pixels;
+        for (std::size_t layer = 0; layer < textures.size(); layer++)
+        {
+            const auto size = sizes[layer];
+            pixels.resize(static_cast<std::size_t>(size.x) * size.y * 4);
+            glBindTexture(GL_TEXTURE_2D, textures[layer]);
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            if (size != layer_size)
+            {
+                pixels = resample(pixels, size, layer_size);
+                ++stats_.resampled;
+            }
+            glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(layer), layer_size.x, layer_size.y, 1, GL_RGBA,
+                            GL_UNSIGNED_BYTE, pixels.data());
+        }
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return array;
+    }
+
+    std::array<gl_texture, types.size()> arrays_;
+    std::vector<glm::vec4> layers_;
+    statistics stats_{};
+};
@@ -1,8 +1,17 @@
 #pragma once
 
+#include <span>
 #include <vector>
 #include <string>
+#include <memory>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <glm/packing.hpp>
+#include <glm/gtc/packing.hpp>
 #include "shader.hpp"
+#include "gl_handle.hpp"
+#include "gpu_arena.hpp"
 
 constexpr auto MAX_BONE_INFLUENCE = 4;
 
@@ -22,40 +31,242 @@ struct Vertex {
     //weights from each bone
     float m_Weights[MAX_BONE_INFLUENCE];
 };
+// vertex buffer layout a Mesh uploads, the CPU side copy is always Vertex
+enum class VertexLayout {
+    // Vertex as is, 88 bytes
+    Full,
+    // CompactVertex, 24 bytes, plus a SkinVertex stream for skinned meshes
+    Compact,
+};
+// quantized vertex, decoded by the vertex fetch so shaders keep their float inputs:
+// normal and tangent are normalized GL_INT_2_10_10_10_REV, texture coordinates GL_HALF_FLOAT.
+// the bitangent is not stored, the tangent carries its handedness in the sign of w instead. GL 3.3 may decode the
+// 2 bit w of -1 as -1/3 ((2c + 1) / (2^b - 1)), so shaders take the sign:
+//   layout (location = 3) in vec4 aTangent;
+//   vec3 bitangent = cross(aNormal, aTangent.xyz) * sign(aTangent.w);
+struct CompactVertex {
+    glm::vec3 Position;
+    std::uint32_t Normal;
+    std::uint32_t TexCoords;
+    std::uint32_t Tangent;
+};
+// bone stream of the compact layout, ids as GL_SHORT (ivec4 in the shader), weights as normalized GL_UNSIGNED_SHORT
+struct SkinVertex {
+    std::int16_t BoneIDs[MAX_BONE_INFLUENCE];
+    std::uint16_t Weights[MAX_BONE_INFLUENCE];
+};
+
+inline CompactVertex packVertex(const Vertex& v)
+{
+    auto unit = [](const glm::vec3& d) {
+        const auto length = glm::length(d);
+        return length > 0.0f ? d / length : d; // absent attributes stay zero
+    };
+    const auto normal = unit(v.Normal);
+    const auto tangent = unit(v.Tangent);
+    const float handedness = glm::dot(glm::cross(normal, tangent), v.Bitangent) < 0.0f ? -1.0f : 1.0f;
+
+    CompactVertex packed;
+    packed.Position = v.Position;
+    packed.Normal = glm::packSnorm3x10_1x2(glm::vec4{ normal, 0.0f });
+    packed.TexCoords = glm::packHalf2x16(v.TexCoords);
+    packed.Tangent = glm::packSnorm3x10_1x2(glm::vec4{ tangent, handedness });
+    return packed;
+}
+
+inline SkinVertex packSkin(const Vertex& v)
+{
+    SkinVertex packed;
+    for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+    {
+        packed.BoneIDs[i] = static_cast<std::int16_t>(v.m_BoneIDs[i]);
+        packed.Weights[i] = static_cast<std::uint16_t>(std::clamp(v.m_Weights[i], 0.0f, 1.0f) * 65535.0f + 0.5f);
+    }
+    return packed;
+}
+
+inline bool isSkinned(const Vertex& v)
+{
+    return std::any_of(std::begin(v.m_Weights), std::end(v.m_Weights), [](float w) { return w != 0.0f; });
+}
+
 struct Texture {
     unsigned int id;
     std::string type;
     std::string path;
 };
+// where a source mesh ended up after being merged into a bigger one
+struct MeshRange {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    unsigned int firstVertex;
+    unsigned int vertexCount;
+};
+// one level of detail, a triangle list in the element buffer of the mesh
+struct MeshLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    // distance between this level and the full surface, in model units
+    float error;
+};
 
 class Mesh {
 public:
     /*    */
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
+    // the CPU copy views arrays the mesh owns, or the mapping of the mesh cache it was read from
+    std::span<const Vertex> vertices;
+    std::span<const unsigned int> indices;
     std::vector<Texture> textures;
-    unsigned int VAO;
+    std::vector<MeshRange> ranges; // empty unless several source meshes were merged into this one
+    std::span<const unsigned int> lodIndices; // triangles of the reduced levels, they follow indices in the element buffer
+    std::vector<MeshLod> lods; // lods[0] is indices, coarser levels follow
+    VertexLayout layout;
+    bool skinned;
+    // owned, so a Mesh moves but does not copy
+    gl_vertex_array VAO;
+    // GL_UNSIGNED_SHORT when every vertex fits, GL_UNSIGNED_INT otherwise
+    unsigned int indexType;
+    // bounding sphere and box in model space
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
     /*    */
-    Mesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Texture>& textures)
+    // takes the arrays by value, callers passing temporaries move them in without a copy
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, std::vector<MeshRange> ranges = {},
+         VertexLayout layout = VertexLayout::Full, std::vector<unsigned int> lodIndices = {}, std::vector<MeshLod> lods = {})
+        : textures(std::move(textures)), ranges(std::move(ranges)), lods(std::move(lods)), layout(layout),
+          ownedVertices(std::move(vertices)), ownedIndices(std::move(indices)), ownedLodIndices(std::move(lodIndices))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
-
-        setupMesh();
+        this->vertices = ownedVertices;
+        this->indices = ownedIndices;
+        this->lodIndices = ownedLodIndices;
+        setup();
+    }
+    // arrays kept by storage, e.g. the mapping of a mesh cache: uploaded straight from there and viewed for as long as
+    // the mesh lives, nothing is copied
+    Mesh(std::span<const Vertex> vertices, std::span<const unsigned int> indices, std::vector<Texture> textures, std::vector<MeshRange> ranges,
+         VertexLayout layout, std::span<const unsigned int> lodIndices, std::vector<MeshLod> lods, std::shared_ptr<const void> storage)
+        : vertices(vertices), indices(indices), textures(std::move(textures)), ranges(std::move(ranges)), lodIndices(lodIndices),
+          lods(std::move(lods)), layout(layout), storage(std::move(storage))
+    {
+        setup();
+    }
+    // bytes per vertex in the vertex buffers, all streams
+    std::size_t vertexStride() const
+    {
+        if (layout == VertexLayout::Full)
+            return sizeof(Vertex);
+        return sizeof(CompactVertex) + (skinned ? sizeof(SkinVertex) : 0);
+    }
+    // vertex buffer memory of this mesh
+    std::size_t vertexBufferSize() const
+    {
+        return vertices.size() * vertexStride();
+    }
+    // index buffer memory of this mesh
+    std::size_t indexBufferSize() const
+    {
+        return (indices.size() + lodIndices.size()) * indexSize();
+    }
+    std::size_t indexSize() const
+    {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(unsigned int);
+    }
+    // byte offset of the first index of a level in the element buffer, the indices are a range of a shared buffer
+    std::size_t indexByteOffset(std::size_t lod) const
+    {
+        return indexMemory.offset() + lods[std::min(lod, lods.size() - 1)].firstIndex * indexSize();
     }
     void Draw(const Shader& shader) const
     {
-        // bind appropriate textures
+        Draw(shader, 0);
+    }
+    // draws one level of detail, levels past the coarsest one draw the coarsest.
+    // the sampler locations come from the binding table of the shader, drawing allocates nothing
+    void Draw(const Shader& shader, std::size_t lod) const
+    {
+        BindTextures(shader);
+
+        // 
+        glBindVertexArray(VAO);
+        DrawElements(lod);
+        // unbound so element buffer binds of the caller cannot land in this VAO, gl_state drops the call where it is
+        // redundant. unit 0 is restored because callers bind their own textures (skybox, shadow maps) right after drawing
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+    // binds the textures to units 0..n-1 and points the samplers of shader at them, making shader current if it samples any.
+    // the units go through the parameter table of shader, which uploads them when they changed
+    void BindTextures(const Shader& shader) const
+    {
+        const auto& table = bindingTable(shader);
+        for (const auto& binding : table.textures)
+        {
+            glActiveTexture(GL_TEXTURE0 + binding.unit); // active proper texture unit before binding
+            glBindTexture(GL_TEXTURE_2D, binding.texture);
+            shader.write(binding.sampler, binding.unit);
+        }
+        if (!table.textures.empty())
+            shader.use();
+    }
+    // draws one level with the VAO of the mesh already bound
+    void DrawElements(std::size_t lod) const
+    {
+        const auto& level = lods[std::min(lod, lods.size() - 1)];
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(level.indexCount), indexType, (void*)indexByteOffset(lod));
+    }
+private:
+    /*  Ⱦ  */
+    // ranges of gpu_arena::vertices() and indices(), given back with the mesh
+    gpu_allocation vertexMemory, skinMemory, indexMemory;
+    // sampler uniform of one texture in one program
+    struct TextureBinding {
+        shader_parameter<int> sampler;
+        int unit;
+        GLuint texture;
+    };
+    // textures resolved against one shader program, built on the first draw with it.
+    // textures do not change after construction, so a table stays valid as long as its program
+    struct BindingTable {
+        GLuint program;
+        std::vector<TextureBinding> textures;
+    };
+    // a mesh meets few programs (depth pass, lit pass...), a linear search beats hashing
+    mutable std::vector<BindingTable> bindingTables;
+    // what vertices, indices and lodIndices view: the arrays moved in, or whatever keeps mapped ones open.
+    // moving a vector keeps its elements where they are, so the views survive moving the mesh
+    std::vector<Vertex> ownedVertices;
+    std::vector<unsigned int> ownedIndices;
+    std::vector<unsigned int> ownedLodIndices;
+    std::shared_ptr<const void> storage;
+    /*    */
+    const BindingTable& bindingTable(const Shader& shader) const
+    {
+        const auto program = shader.prog_id();
+        for (const auto& table : bindingTables)
+        {
+            if (table.program == program)
+                return table;
+        }
+        bindingTables.push_back({ program, resolveTextureBindings(shader) });
+        return bindingTables.back();
+    }
+    // texture i goes to unit i and to the uniform materialN.type, N counting textures of the same type from 1.
+    // textures the program does not sample are left out
+    std::vector<TextureBinding> resolveTextureBindings(const Shader& shader) const
+    {
         unsigned int diffuseNr = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr = 1;
         unsigned int heightNr = 1;
+        unsigned int reflectionNr = 1;
+        std::vector<TextureBinding> bindings;
         for (unsigned int i = 0; i < textures.size(); i++)
         {
             // retrieve texture number (the N in diffuse_textureN)
             std::string number;
-            std::string name = textures[i].type;
+            const std::string& name = textures[i].type;
             if (name == "diffuse")
                 number = std::to_string(diffuseNr++);
             else if (name == "specular")
@@ -64,64 +275,181 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to string
             else if (name == "height")
                 number = std::to_string(heightNr++); // transfer unsigned int to string
+            else if (name == "reflection")
+                number = std::to_string(reflectionNr++);
 
-            auto uniform_name = "material" + number + '.' + name;
-
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            shader.set(uniform_name, i);
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            const auto sampler = shader.optionalParameter<int>("material" + number + '.' + name);
+            if (sampler.valid())
+                bindings.push_back({ sampler, static_cast<int>(i), textures[i].id });
         }
-
-        // 
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, nullptr);
-        glBindVertexArray(0);
-
-        glActiveTexture(GL_TEXTURE0);
+        return bindings;
+    }
+    void setup()
+    {
+        skinned = std::any_of(vertices.begin(), vertices.end(), isSkinned);
+        if (lods.empty())
+            lods.push_back({ 0, static_cast<unsigned int>(indices.size()), 0.0f });
+        computeBounds();
+        setupMesh();
+    }
+    void computeBounds()
+    {
+        if (vertices.empty())
+        {
+            boundsCenter = boundsMin = boundsMax = glm::vec3{ 0.0f };
+            boundsRadius = 0.0f;
+            return;
+        }
+        glm::vec3 lower = vertices[0].Position, upper = vertices[0].Position;
+        for (const auto& v : vertices)
+        {
+            lower = glm::min(lower, v.Position);
+            upper = glm::max(upper, v.Position);
+        }
+        boundsMin = lower;
+        boundsMax = upper;
+        boundsCenter = (lower + upper) * 0.5f;
+        boundsRadius = 0.0f;
+        for (const auto& v : vertices)
+            boundsRadius = std::max(boundsRadius, glm::length(v.Position - boundsCenter));
     }
-private:
-    /*  Ⱦ  */
-    unsigned int VBO, EBO;
-    /*    */
     void setupMesh()
     {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
+        VAO = gl_vertex_array::create();
         glBindVertexArray(VAO);
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        // every level of detail in one element range, full detail first.
+        // 16 bit indices halve the index buffer and its fetch, the CPU copy stays 32 bit
+        indexType = vertices.size() < 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        indexMemory = gpu_arena::indices().allocate(indexBufferSize(), sizeof(unsigned int));
+        auto uploadIndices = [this](std::size_t first, std::span<const unsigned int> source) {
+            if (indexType == GL_UNSIGNED_SHORT)
+            {
+                const std::vector<std::uint16_t> shortIndices(source.begin(), source.end());
+                indexMemory.upload(std::span{ shortIndices }, first * sizeof(std::uint16_t));
+            }
+            else
+            {
+                indexMemory.upload(source, first * sizeof(unsigned int));
+            }
+        };
+        uploadIndices(0, indices);
+        uploadIndices(indices.size(), lodIndices);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexMemory.buffer());
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        if (layout == VertexLayout::Compact)
+        {
+            const auto packed = packVertices(vertices);
+            vertexMemory = gpu_arena::vertices().allocate(packed.size() * sizeof(CompactVertex));
+            vertexMemory.upload(std::span{ packed });
+            glBindBuffer(GL_ARRAY_BUFFER, vertexMemory.buffer());
+            compactAttributePointers(vertexMemory.offset());
+            if (skinned)
+            {
+                const auto skin = packSkins(vertices);
+                skinMemory = gpu_arena::vertices().allocate(skin.size() * sizeof(SkinVertex));
+                skinMemory.upload(std::span{ skin });
+                glBindBuffer(GL_ARRAY_BUFFER, skinMemory.buffer());
+                skinAttributePointers(skinMemory.offset());
+            }
+        }
+        else
+        {
+            vertexMemory = gpu_arena::vertices().allocate(vertices.size() * sizeof(Vertex));
+            vertexMemory.upload(vertices);
+            glBindBuffer(GL_ARRAY_BUFFER, vertexMemory.buffer());
+            fullAttributePointers(skinned, vertexMemory.offset());
+        }
+
+        glBindVertexArray(0);
+    }
+public:
+    // upload vertices to the GL_ARRAY_BUFFER and point the attributes of the bound VAO at it, the same way for
+    // every buffer of a layout. mesh_batch uses them for its shared buffers
+    static void setupFullAttributes(const std::vector<Vertex>& vertices, bool skinned)
+    {
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        fullAttributePointers(skinned, 0);
+    }
+    // skinned meshes get a second buffer for the bone stream, created into skinVBO
+    static void setupCompactAttributes(const std::vector<Vertex>& vertices, bool skinned, gl_buffer& skinVBO)
+    {
+        const auto packed = packVertices(vertices);
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(CompactVertex), packed.data(), GL_STATIC_DRAW);
+        compactAttributePointers(0);
+        if (!skinned)
+            return;
 
+        const auto skin = packSkins(vertices);
+        skinVBO = gl_buffer::create();
+        glBindBuffer(GL_ARRAY_BUFFER, skinVBO);
+        glBufferData(GL_ARRAY_BUFFER, skin.size() * sizeof(SkinVertex), skin.data(), GL_STATIC_DRAW);
+        skinAttributePointers(0);
+    }
+    static std::vector<CompactVertex> packVertices(std::span<const Vertex> vertices)
+    {
+        std::vector<CompactVertex> packed(vertices.size());
+        std::transform(vertices.begin(), vertices.end(), packed.begin(), packVertex);
+        return packed;
+    }
+    static std::vector<SkinVertex> packSkins(std::span<const Vertex> vertices)
+    {
+        std::vector<SkinVertex> skin(vertices.size());
+        std::transform(vertices.begin(), vertices.end(), skin.begin(), packSkin);
+        return skin;
+    }
+    // point the attributes of the bound VAO at vertices of a layout starting base bytes into the bound GL_ARRAY_BUFFER
+    static void fullAttributePointers(bool skinned, std::size_t base)
+    {
         // set the vertex attribute pointers
         // vertex Positions
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)base);
         // vertex normals
         glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(base + offsetof(Vertex, Normal)));
         // vertex texture coords
         glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(base + offsetof(Vertex, TexCoords)));
         // vertex tangent
         glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(base + offsetof(Vertex, Tangent)));
         // vertex bitangent
         glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-        glBindVertexArray(0);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(base + offsetof(Vertex, Bitangent)));
+        if (skinned)
+        {
+            // ids
+            glEnableVertexAttribArray(5);
+            glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)(base + offsetof(Vertex, m_BoneIDs)));
+            // weights
+            glEnableVertexAttribArray(6);
+            glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(base + offsetof(Vertex, m_Weights)));
+        }
+    }
+    static void compactAttributePointers(std::size_t base)
+    {
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)base);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactVertex), (void*)(base + offsetof(CompactVertex, Normal)));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(CompactVertex), (void*)(base + offsetof(CompactVertex, TexCoords)));
+        // vertex tangent and bitangent sign
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(CompactVertex), (void*)(base + offsetof(CompactVertex, Tangent)));
+    }
+    // the bone stream of the compact layout
+    static void skinAttributePointers(std::size_t base)
+    {
         // ids
         glEnableVertexAttribArray(5);
-        glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
+        glVertexAttribIPointer(5, 4, GL_SHORT, sizeof(SkinVertex), (void*)(base + offsetof(SkinVertex, BoneIDs)));
         // weights
         glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-
-        glBindVertexArray(0);
-
+        glVertexAttribPointer(6, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(SkinVertex), (void*)(base + offsetof(SkinVertex, Weights)));
     }
 };
\ No newline at end of file
@@ -0,0 +1,254 @@
+#pragma once
+#include <span>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <algorithm>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+#include "gl_handle.hpp"
+
+// Meshes packed into one vertex and one element buffer under a single vertex array, drawn with one multi draw.
+// every vertex carries the index of its mesh as integer attribute 7, the draw id, so per draw data is a fetch away:
+//   layout (location = 7) in uint aDrawID;
+//   uniform samplerBuffer drawData;                              // set_draw_data() / bind_draw_data()
+//   vec4 tint = texelFetch(drawData, int(aDrawID) * stride + n);
+// with GL 4.3 loaded the ranges are drawn by glMultiDrawElementsIndirect from a command buffer, the 3.3 core contexts
+// of the demos use glMultiDrawElementsBaseVertex with the same ranges. gl_DrawID needs 4.6 and is not there in the
+// fallback, hence the attribute, two bytes per vertex.
+// no textures are bound: it is meant for depth passes and for shaders that find their material by draw id.
+// the meshes keep their own buffers for the per mesh paths, the batch is a second copy of the geometry.
+class mesh_batch
+{
+public:
+    mesh_batch() = default;
+
+    // the layout of the first mesh is used for all of them, bone streams are added if any mesh is skinned
+    explicit mesh_batch(std::span<const Mesh> meshes)
+    {
+        if (meshes.empty())
+            return;
+        assert(meshes.size() <= 0x10000 && "draw ids are 16 bit");
+
+        std::size_t vertex_count = 0;
+        std::size_t index_count = 0;
+        bool skinned = false;
+        bool short_indices = true;
+        for (const auto& mesh : meshes)
+        {
+            vertex_count += mesh.vertices.size();
+            index_count += mesh.indices.size() + mesh.lodIndices.size();
+            skinned = skinned || mesh.skinned;
+            // base vertices are added by the draw, indices only have to address their own mesh
+            short_indices = short_indices && mesh.vertices.size() < 0x10000;
+        }
+        index_type_ = short_indices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        std::vector<std::uint16_t> draw_ids;
+        vertices.reserve(vertex_count);
+        indices.reserve(index_count);
+        draw_ids.reserve(vertex_count);
+        glm::vec3 lower{ meshes[0].boundsCenter }, upper{ meshes[0].boundsCenter };
+        for (std::size_t i = 0; i < meshes.size(); i++)
+        {
+            const auto& mesh = meshes[i];
+            const auto first_index = static_cast<GLuint>(indices.size());
+            ranges_.push_back({ static_cast<GLint>(vertices.size()), static_cast<std::uint32_t>(levels_.size()),
+                                static_cast<std::uint32_t>(mesh.lods.size()) });
+            for (const auto& lod : mesh.lods)
+                levels_.push_back({ first_index + lod.firstIndex, lod.indexCount });
+            vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+            indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+            indices.insert(indices.end(), mesh.lodIndices.begin(), mesh.lodIndices.end());
+            draw_ids.insert(draw_ids.end(), mesh.vertices.size(), static_cast<std::uint16_t>(i));
+            lower = glm::min(lower, mesh.boundsCenter - mesh.boundsRadius);
+            upper = glm::max(upper, mesh.boundsCenter + mesh.boundsRadius);
+        }
+        bounds_center_ = (lower + upper) * 0.5f;
+        for (const auto& mesh : meshes)
+            bounds_radius_ = std::max(bounds_radius_, glm::length(mesh.boundsCenter - bounds_center_) + mesh.boundsRadius);
+
+        vao_ = gl_vertex_array::create();
+        vbo_ = gl_buffer::create();
+        ebo_ = gl_buffer::create();
+        draw_id_vbo_ = gl_buffer::create();
+        glBindVertexArray(vao_);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+        if (index_type_ == GL_UNSIGNED_SHORT)
+        {
+            const std::vector<std::uint16_t> short_indices_data(indices.begin(), indices.end());
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, short_indices_data.size() * sizeof(std::uint16_t), short_indices_data.data(), GL_STATIC_DRAW);
+        }
+        else
+        {
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        if (meshes[0].layout == VertexLayout::Compact)
+            Mesh::setupCompactAttributes(vertices, skinned, skin_vbo_);
+        else
+            Mesh::setupFullAttributes(vertices, skinned);
+
+        glBindBuffer(GL_ARRAY_BUFFER, draw_id_vbo_);
+        glBufferData(GL_ARRAY_BUFFER, draw_ids.size() * sizeof(std::uint16_t), draw_ids.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(7);
+        glVertexAttribIPointer(7, 1, GL_UNSIGNED_SHORT, sizeof(std::uint16_t), (void*)0);
+        glBindVertexArray(0);
+
+        if (indirect_supported())
+        {
+            indirect_buffer_ = gl_buffer::create();
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, meshes.size() * sizeof(command), nullptr, GL_DYNAMIC_DRAW);
+        }
+        // the scratch arrays never grow while drawing
+        commands_.reserve(meshes.size());
+        uploaded_.reserve(meshes.size());
+        counts_.reserve(meshes.size());
+        offsets_.reserve(meshes.size());
+        base_vertices_.reserve(meshes.size());
+    }
+
+    mesh_batch(const mesh_batch&) = delete;
+    mesh_batch& operator=(const mesh_batch&) = delete;
+    mesh_batch(mesh_batch&&) noexcept = default;
+    mesh_batch& operator=(mesh_batch&&) noexcept = default;
+
+    // true where the GL 4.3 indirect path is loaded, every batch of the context takes the same path
+    [[nodiscard]] static auto indirect_supported() -> bool { return GLAD_GL_VERSION_4_3 != 0; }
+
+    [[nodiscard]] auto empty() const -> bool { return ranges_.empty(); }
+    // number of meshes, also the number of draws a multi draw stands for
+    [[nodiscard]] auto size() const -> std::size_t { return ranges_.size(); }
+    [[nodiscard]] auto vertex_array() const -> GLuint { return vao_; }
+    [[nodiscard]] auto index_type() const -> GLenum { return index_type_; }
+    // bounding sphere of all meshes in model space
+    [[nodiscard]] auto bounds_center() const -> glm::vec3 { return bounds_center_; }
+    [[nodiscard]] auto bounds_radius() const -> float { return bounds_radius_; }
+
+    // level lods[i] of mesh i, clamped to its coarsest level, or level 0 of every mesh when lods is empty
+    void draw(std::span<const std::size_t> lods = {}) const
+    {
+        glBindVertexArray(vao_);
+        draw_elements(lods);
+    }
+
+    // the same with the vertex array of the batch already bound
+    void draw_elements(std::span<const std::size_t> lods = {}) const
+    {
+        if (ranges_.empty())
+            return;
+        assert(lods.empty() || lods.size() == ranges_.size());
+        commands_.clear();
+        for (std::size_t i = 0; i < ranges_.size(); i++)
+        {
+            const auto& range = ranges_[i];
+            const auto lod = lods.empty() ? 0 : std::min<std::size_t>(lods[i], range.level_count - 1);
+            const auto& level = levels_[range.first_level + lod];
+            commands_.push_back({ level.count, 1, level.first_index, range.base_vertex, static_cast<GLuint>(i) });
+        }
+
+        if (indirect_buffer_)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect_buffer_);
+            // the commands only change with the levels, a static model uploads them once
+            if (commands_ != uploaded_)
+            {
+                glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands_.size() * sizeof(command), commands_.data());
+                uploaded_ = commands_;
+            }
+            glMultiDrawElementsIndirect(GL_TRIANGLES, index_type_, nullptr, static_cast<GLsizei>(commands_.size()), 0);
+            return;
+        }
+
+        const auto index_size = index_type_ == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(unsigned int);
+        counts_.clear();
+        offsets_.clear();
+        base_vertices_.clear();
+        for (const auto& c : commands_)
+        {
+            counts_.push_back(static_cast<GLsizei>(c.count));
+            offsets_.push_back(reinterpret_cast<const void*>(std::uintptr_t{ c.first_index } * index_size));
+            base_vertices_.push_back(c.base_vertex);
+        }
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts_.data(), index_type_, offsets_.data(), static_cast<GLsizei>(counts_.size()),
+                                      base_vertices_.data());
+    }
+
+    // per draw data of the shaders, an RGBA32F texture buffer: texel i * stride + n belongs to mesh i.
+    // the texture buffer binding of the active unit changes
+    void set_draw_data(std::span<const glm::vec4> texels)
+    {
+        if (!data_texture_)
+        {
+            data_buffer_ = gl_buffer::create();
+            data_texture_ = gl_texture::create();
+            glBindBuffer(GL_TEXTURE_BUFFER, data_buffer_);
+            glBindTexture(GL_TEXTURE_BUFFER, data_texture_);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, data_buffer_);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, data_buffer_);
+        glBufferData(GL_TEXTURE_BUFFER, texels.size_bytes(), texels.data(), GL_DYNAMIC_DRAW);
+    }
+
+    // the samplerBuffer uniform of the shader has to point at unit
+    void bind_draw_data(GLuint unit) const
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_BUFFER, data_texture_);
+    }
+
+private:
+    // DrawElementsIndirectCommand of the GL spec
+    struct command
+    {
+        GLuint count;
+        GLuint instance_count;
+        GLuint first_index;
+        GLint base_vertex;
+        GLuint base_instance;
+
+        bool operator==(const command&) const = default;
+    };
+
+    // one mesh, its levels are levels_[first_level, first_level + level_count)
+    struct range
+    {
+        GLint base_vertex;
+        std::uint32_t first_level;
+        std::uint32_t level_count;
+    };
+
+    struct level
+    {
+        GLuint first_index;
+        GLuint count;
+    };
+
+    gl_vertex_array vao_;
+    gl_buffer vbo_;
+    gl_buffer skin_vbo_;
+    gl_buffer ebo_;
+    gl_buffer draw_id_vbo_;
+    gl_buffer indirect_buffer_;
+    gl_buffer data_buffer_;
+    gl_texture data_texture_;
+    GLenum index_type_{ GL_UNSIGNED_INT };
+    glm::vec3 bounds_center_{ 0.0f };
+    float bounds_radius_{ 0.0f };
+    std::vector<range> ranges_;
+    std::vector<level> levels_;
+    // per draw scratch, and the commands last written to the indirect buffer
+    mutable std::vector<command> commands_;
+    mutable std::vector<command> uploaded_;
+    mutable std::vector<GLsizei> counts_;
+    mutable std::vector<const void*> offsets_;
+    mutable std::vector<GLint> base_vertices_;
+};
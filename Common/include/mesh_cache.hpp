@@ -0,0 +1,359 @@
+#pragma once
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+
+#include "hash.hpp"
+#include "mesh.hpp"
+#include "mapped_file.hpp"
+
+// Baked mesh cache.
+// Stores the final Vertex/index arrays of a Model together with the material texture references,
+// so a warm start can map the file and upload it to GL without running the importer again.
+//
+// layout (all little endian, offsets from the start of the file):
+//   file_header
+//   mesh_record[mesh_count]
+//   texture_record[texture_count]
+//   MeshRange[range_count]
+//   MeshLod[lod_count]
+//   vertex data    (16 bytes aligned)
+//   index data     (4 bytes aligned, full detail followed by the reduced levels)
+//   string blob    (texture types and paths, not null terminated)
+namespace mesh_cache
+{
+    inline constexpr char          magic[4]{ 'L', 'O', 'M', 'C' };
+    inline constexpr std::uint32_t version = 5;
+
+    struct file_header
+    {
+        char          magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint32_t vertex_size;
+        std::uint32_t mesh_count;
+        std::uint32_t texture_count;
+        std::uint32_t range_count;
+        std::uint32_t lod_count;
+        std::uint32_t reserved;
+        std::uint64_t string_offset;
+        std::uint64_t string_size;
+    };
+
+    struct mesh_record
+    {
+        std::uint64_t vertex_offset;
+        std::uint64_t index_offset;
+        std::uint32_t vertex_count;
+        std::uint32_t index_count;
+        std::uint32_t first_texture;
+        std::uint32_t texture_count;
+        std::uint32_t first_range;
+        std::uint32_t range_count;
+        std::uint32_t lod_index_count;
+        std::uint32_t first_lod;
+        std::uint32_t lod_count;
+        std::uint32_t reserved;
+    };
+
+    struct texture_record
+    {
+        std::uint32_t type_offset;
+        std::uint32_t type_size;
+        std::uint32_t path_offset;
+        std::uint32_t path_size;
+    };
+
+    struct texture_ref
+    {
+        std::string_view type;
+        std::string_view path;
+    };
+
+    struct mesh_view
+    {
+        std::span<const Vertex>       vertices;
+        std::span<const unsigned int> indices;
+        std::span<const texture_record> textures;
+        std::span<const MeshRange>      ranges;
+        std::span<const unsigned int>   lod_indices;
+        std::span<const MeshLod>        lods;
+    };
+
+    // material libraries an OBJ names on its mtllib lines, relative to the OBJ. other formats the demos load keep
+    // their materials in the model file
+    [[nodiscard]] inline auto material_libraries(const std::filesystem::path& source, std::span<const std::byte> bytes)
+        -> std::vector<std::filesystem::path>
+    {
+        std::vector<std::filesystem::path> libraries;
+        auto extension = source.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (extension != ".obj")
+            return libraries;
+
+        const std::string_view text{ reinterpret_cast<const char*>(bytes.data()), bytes.size() };
+        constexpr std::string_view keyword = "mtllib";
+        for (std::size_t line = 0; line < text.size();)
+        {
+            auto end = text.find('\n', line);
+            if (end == std::string_view::npos)
+                end = text.size();
+            auto statement = text.substr(line, end - line);
+            line = end + 1;
+            if (!statement.starts_with(keyword) || statement.size() == keyword.size() || !std::isspace(static_cast<unsigned char>(statement[keyword.size()])))
+                continue;
+            statement.remove_prefix(keyword.size());
+            const auto first = statement.find_first_not_of(" \t");
+            const auto last = statement.find_last_not_of(" \t\r");
+            if (first != std::string_view::npos)
+                libraries.push_back(source.parent_path() / statement.substr(first, last - first + 1));
+        }
+        return libraries;
+    }
+
+    // key = hash(source bytes, material library bytes, import flags, load variant, cache version, vertex layout).
+    // the material libraries decide the textures of the baked meshes, editing one invalidates the cache like editing
+    // the source. variant covers loader options that change the baked meshes (e.g. material merging).
+    // returns 0 when the source file cannot be read, 0 is never a valid key.
+    [[nodiscard]] inline auto make_key(const std::filesystem::path& source, unsigned int import_flags, std::uint32_t variant = 0)
+        -> std::uint64_t
+    {
+        const mapped_file file{ source };
+        if (!file)
+            return 0;
+
+        auto hash = fnv1a(file.bytes());
+        for (const auto& library : material_libraries(source, file.bytes()))
+        {
+            // a missing library hashes as empty, creating it later changes the key too
+            const mapped_file sidecar{ library };
+            hash = fnv1a(library.filename().generic_string(), hash);
+            hash = fnv1a(static_cast<std::uint64_t>(sidecar ? sidecar.size() : 0), hash);
+            if (sidecar)
+                hash = fnv1a(sidecar.bytes(), hash);
+        }
+        hash = fnv1a(import_flags, hash);
+        hash = fnv1a(variant, hash);
+        hash = fnv1a(version, hash);
+        hash = fnv1a(static_cast<std::uint32_t>(sizeof(Vertex)), hash);
+        return hash == 0 ? 1 : hash;
+    }
+
+    [[nodiscard]] inline auto cache_path_for(const std::filesystem::path& source)
+        -> std::filesystem::path
+    {
+        auto cache = source;
+        cache += ".meshcache";
+        return cache;
+    }
+
+    class reader
+    {
+    public:
+        reader(const std::filesystem::path& cache, std::uint64_t key)
+            : file_{ cache }
+        {
+            if (!file_ || file_.size() < sizeof(file_header))
+                return;
+
+            std::memcpy(&header_, file_.data(), sizeof(file_header));
+            if (std::memcmp(header_.magic, magic, sizeof(magic)) != 0
+                || header_.version != version
+                || header_.key != key
+                || header_.vertex_size != sizeof(Vertex))
+                return;
+
+            const auto records_end = sizeof(file_header)
+                + header_.mesh_count * sizeof(mesh_record)
+                + header_.texture_count * sizeof(texture_record)
+                + header_.range_count * sizeof(MeshRange)
+                + header_.lod_count * sizeof(MeshLod);
+            if (records_end > file_.size()
+                || header_.string_offset + header_.string_size > file_.size())
+                return;
+
+            meshes_ = { reinterpret_cast<const mesh_record*>(file_.data() + sizeof(file_header)), header_.mesh_count };
+            textures_ = { reinterpret_cast<const texture_record*>(meshes_.data() + meshes_.size()), header_.texture_count };
+            ranges_ = { reinterpret_cast<const MeshRange*>(textures_.data() + textures_.size()), header_.range_count };
+            lods_ = { reinterpret_cast<const MeshLod*>(ranges_.data() + ranges_.size()), header_.lod_count };
+
+            for (const auto& m : meshes_)
+            {
+                if (m.vertex_offset + std::uint64_t{ m.vertex_count } * sizeof(Vertex) > file_.size()
+                    || m.index_offset + (std::uint64_t{ m.index_count } + m.lod_index_count) * sizeof(unsigned int) > file_.size()
+                    || m.first_texture + m.texture_count > header_.texture_count
+                    || m.first_range + m.range_count > header_.range_count
+                    || m.first_lod + m.lod_count > header_.lod_count)
+                    return;
+            }
+            for (const auto& t : textures_)
+            {
+                if (std::uint64_t{ t.type_offset } + t.type_size > header_.string_size
+                    || std::uint64_t{ t.path_offset } + t.path_size > header_.string_size)
+                    return;
+            }
+            valid_ = true;
+        }
+
+        explicit operator bool() const { return valid_; }
+
+        [[nodiscard]] std::size_t mesh_count() const { return meshes_.size(); }
+
+        [[nodiscard]] auto mesh(std::size_t i) const -> mesh_view
+        {
+            const auto& m = meshes_[i];
+            const auto* indices = reinterpret_cast<const unsigned int*>(file_.data() + m.index_offset);
+            return {
+                { reinterpret_cast<const Vertex*>(file_.data() + m.vertex_offset), m.vertex_count },
+                { indices, m.index_count },
+                textures_.subspan(m.first_texture, m.texture_count),
+                ranges_.subspan(m.first_range, m.range_count),
+                { indices + m.index_count, m.lod_index_count },
+                lods_.subspan(m.first_lod, m.lod_count)
+            };
+        }
+
+        [[nodiscard]] auto texture(const texture_record& t) const -> texture_ref
+        {
+            const auto* strings = reinterpret_cast<const char*>(file_.data() + header_.string_offset);
+            return { { strings + t.type_offset, t.type_size }, { strings + t.path_offset, t.path_size } };
+        }
+
+    private:
+        mapped_file file_;
+        file_header header_{};
+        std::span<const mesh_record> meshes_;
+        std::span<const texture_record> textures_;
+        std::span<const MeshRange> ranges_;
+        std::span<const MeshLod> lods_;
+        bool valid_{ false };
+    };
+
+    // writes to a temporary file first and renames it, so a crash never leaves a torn cache behind.
+    inline bool write(const std::filesystem::path& cache, std::uint64_t key, std::span<const Mesh> meshes)
+    {
+        auto align = [](std::uint64_t offset, std::uint64_t alignment) {
+            return (offset + alignment - 1) & ~(alignment - 1);
+        };
+
+        file_header header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.key = key;
+        header.vertex_size = sizeof(Vertex);
+        header.mesh_count = static_cast<std::uint32_t>(meshes.size());
+
+        std::vector<mesh_record> mesh_records;
+        std::vector<texture_record> texture_records;
+        std::vector<MeshRange> ranges;
+        std::vector<MeshLod> lods;
+        std::string strings;
+        mesh_records.reserve(meshes.size());
+        for (const auto& mesh : meshes)
+        {
+            mesh_record record{};
+            record.vertex_count = static_cast<std::uint32_t>(mesh.vertices.size());
+            record.index_count = static_cast<std::uint32_t>(mesh.indices.size());
+            record.first_texture = static_cast<std::uint32_t>(texture_records.size());
+            record.texture_count = static_cast<std::uint32_t>(mesh.textures.size());
+            record.first_range = static_cast<std::uint32_t>(ranges.size());
+            record.range_count = static_cast<std::uint32_t>(mesh.ranges.size());
+            record.lod_index_count = static_cast<std::uint32_t>(mesh.lodIndices.size());
+            record.first_lod = static_cast<std::uint32_t>(lods.size());
+            record.lod_count = static_cast<std::uint32_t>(mesh.lods.size());
+            ranges.insert(ranges.end(), mesh.ranges.begin(), mesh.ranges.end());
+            lods.insert(lods.end(), mesh.lods.begin(), mesh.lods.end());
+            for (const auto& texture : mesh.textures)
+            {
+                texture_record t{};
+                t.type_offset = static_cast<std::uint32_t>(strings.size());
+                t.type_size = static_cast<std::uint32_t>(texture.type.size());
+                strings += texture.type;
+                t.path_offset = static_cast<std::uint32_t>(strings.size());
+                t.path_size = static_cast<std::uint32_t>(texture.path.size());
+                strings += texture.path;
+                texture_records.push_back(t);
+            }
+            mesh_records.push_back(record);
+        }
+        header.texture_count = static_cast<std::uint32_t>(texture_records.size());
+        header.range_count = static_cast<std::uint32_t>(ranges.size());
+        header.lod_count = static_cast<std::uint32_t>(lods.size());
+
+        // assign data offsets
+        std::uint64_t offset = sizeof(file_header)
+            + mesh_records.size() * sizeof(mesh_record)
+            + texture_records.size() * sizeof(texture_record)
+            + ranges.size() * sizeof(MeshRange)
+            + lods.size() * sizeof(MeshLod);
+        for (std::size_t i = 0; i < meshes.size(); ++i)
+        {
+            offset = align(offset, 16);
+            mesh_records[i].vertex_offset = offset;
+            offset += meshes[i].vertices.size() * sizeof(Vertex);
+        }
+        for (std::size_t i = 0; i < meshes.size(); ++i)
+        {
+            offset = align(offset, 4);
+            mesh_records[i].index_offset = offset;
+            offset += (meshes[i].indices.size() + meshes[i].lodIndices.size()) * sizeof(unsigned int);
+        }
+        header.string_offset = offset;
+        header.string_size = strings.size();
+
+        auto tmp = cache;
+        tmp += ".tmp";
+        {
+            std::ofstream out{ tmp, std::ios::binary | std::ios::trunc };
+            if (!out)
+                return false;
+
+            std::uint64_t written = 0;
+            auto put = [&](const void* data, std::uint64_t size) {
+                out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+                written += size;
+            };
+            auto pad_to = [&](std::uint64_t target) {
+                static constexpr char zeros[16]{};
+                put(zeros, target - written);
+            };
+
+            put(&header, sizeof(header));
+            put(mesh_records.data(), mesh_records.size() * sizeof(mesh_record));
+            put(texture_records.data(), texture_records.size() * sizeof(texture_record));
+            put(ranges.data(), ranges.size() * sizeof(MeshRange));
+            put(lods.data(), lods.size() * sizeof(MeshLod));
+            for (std::size_t i = 0; i < meshes.size(); ++i)
+            {
+                pad_to(mesh_records[i].vertex_offset);
+                put(meshes[i].vertices.data(), meshes[i].vertices.size() * sizeof(Vertex));
+            }
+            for (std::size_t i = 0; i < meshes.size(); ++i)
+            {
+                pad_to(mesh_records[i].index_offset);
+                put(meshes[i].indices.data(), meshes[i].indices.size() * sizeof(unsigned int));
+                put(meshes[i].lodIndices.data(), meshes[i].lodIndices.size() * sizeof(unsigned int));
+            }
+            put(strings.data(), strings.size());
+            if (!out)
+                return false;
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(tmp, cache, ec);
+        if (ec)
+        {
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,288 @@
+#pragma once
+#include <span>
+#include <cmath>
+#include <vector>
+#include <numeric>
+#include <cstdint>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+#include "mesh.hpp"
+
+// Load time reordering of indexed triangle lists.
+// All functions work on local indices (0 .. vertices.size() - 1) of one triangle list.
+//
+//   optimize_vertex_cache   triangle order for the post-transform cache (Forsyth, linear speed)
+//   optimize_overdraw       reorders cache friendly clusters of triangles outside in, so the
+//                           outward facing parts are drawn first from most view points
+//   optimize_vertex_fetch   vertex order of first use, so fetches walk the buffer forward
+//   analyze_vertex_cache    ACMR/ATVR of an index order under a FIFO cache
+
+struct vertex_cache_statistics
+{
+    // transformed vertices per triangle, 0.5 is the optimum for large regular meshes, 3 the worst case
+    double acmr;
+    // transformed vertices per unique vertex, 1 is the optimum
+    double atvr;
+};
+
+// simulates a FIFO post-transform cache of cache_size entries
+[[nodiscard]] inline auto analyze_vertex_cache(std::span<const unsigned int> indices, std::size_t vertex_count, std::size_t cache_size = 16)
+    -> vertex_cache_statistics
+{
+    // a vertex is in the cache while fewer than cache_size misses happened since it was loaded
+    std::vector<std::size_t> loaded_at(vertex_count, 0);
+    std::vector<bool> used(vertex_count, false);
+    std::size_t misses = 0;
+    for (auto index : indices)
+    {
+        if (!used[index] || misses - loaded_at[index] >= cache_size)
+        {
+            loaded_at[index] = misses++;
+            used[index] = true;
+        }
+    }
+
+    const auto unique = static_cast<std::size_t>(std::count(used.begin(), used.end(), true));
+    const auto triangles = indices.size() / 3;
+    return {
+        triangles ? static_cast<double>(misses) / triangles : 0.0,
+        unique ? static_cast<double>(misses) / unique : 0.0
+    };
+}
+
+namespace detail
+{
+    inline constexpr int forsyth_cache_size = 32;
+
+    // Forsyth's scoring: recently used vertices and vertices with few triangles left score high
+    inline auto forsyth_vertex_score(int cache_position, unsigned int remaining) -> float
+    {
+        constexpr float cache_decay_power = 1.5f;
+        constexpr float last_triangle_score = 0.75f;
+        constexpr float valence_boost_scale = 2.0f;
+        constexpr float valence_boost_power = 0.5f;
+
+        if (remaining == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cache_position >= 0)
+        {
+            if (cache_position < 3)
+                score = last_triangle_score; // the triangle just drawn, any order of its corners is fine
+            else
+                score = std::pow(1.0f - static_cast<float>(cache_position - 3) / (forsyth_cache_size - 3), cache_decay_power);
+        }
+        return score + valence_boost_scale * std::pow(static_cast<float>(remaining), -valence_boost_power);
+    }
+}
+
+// reorders the triangles of indices in place
+inline void optimize_vertex_cache(std::span<unsigned int> indices, std::size_t vertex_count)
+{
+    using detail::forsyth_cache_size;
+
+    const auto triangle_count = indices.size() / 3;
+    if (triangle_count < 2)
+        return;
+
+    // vertex -> triangles adjacency
+    std::vector<unsigned int> remaining(vertex_count, 0);
+    for (auto index : indices)
+        ++remaining[index];
+    std::vector<unsigned int> offsets(vertex_count + 1, 0);
+    std::partial_sum(remaining.begin(), remaining.end(), offsets.begin() + 1);
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        auto fill = offsets;
+        for (std::size_t t = 0; t < triangle_count; ++t)
+            for (int c = 0; c < 3; ++c)
+                adjacency[fill[indices[t * 3 + c]]++] = static_cast<unsigned int>(t);
+    }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> vertex_score(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; ++v)
+        vertex_score[v] = detail::forsyth_vertex_score(-1, remaining[v]);
+
+    std::vector<float> triangle_score(triangle_count);
+    std::vector<bool> emitted(triangle_count, false);
+    for (std::size_t t = 0; t < triangle_count; ++t)
+        triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+
+    auto best = static_cast<std::size_t>(std::max_element(triangle_score.begin(), triangle_score.end()) - triangle_score.begin());
+    std::size_t scan = 0; // fallback cursor when nothing in the cache has triangles left
+
+    std::vector<unsigned int> order;
+    order.reserve(indices.size());
+    std::vector<unsigned int> cache, next_cache;
+    cache.reserve(forsyth_cache_size + 3);
+    next_cache.reserve(forsyth_cache_size + 3);
+
+    for (std::size_t n = 0; n < triangle_count; ++n)
+    {
+        if (best == triangle_count)
+        {
+            while (emitted[scan])
+                ++scan;
+            best = scan;
+        }
+
+        // emit the triangle and push its corners to the front of the cache
+        emitted[best] = true;
+        next_cache.clear();
+        for (int c = 0; c < 3; ++c)
+        {
+            const auto v = indices[best * 3 + c];
+            order.push_back(v);
+            next_cache.push_back(v);
+
+            // drop the triangle from the vertex's remaining list
+            --remaining[v];
+            auto* first = adjacency.data() + offsets[v];
+            auto* last = first + remaining[v] + 1;
+            *std::find(first, last, static_cast<unsigned int>(best)) = last[-1];
+        }
+        for (auto v : cache)
+        {
+            if (std::find(next_cache.begin(), next_cache.end(), v) == next_cache.end())
+                next_cache.push_back(v);
+        }
+        // vertices pushed out of the cache lose their cache score
+        for (std::size_t i = forsyth_cache_size; i < next_cache.size(); ++i)
+        {
+            cache_position[next_cache[i]] = -1;
+            vertex_score[next_cache[i]] = detail::forsyth_vertex_score(-1, remaining[next_cache[i]]);
+        }
+        if (next_cache.size() > forsyth_cache_size)
+            next_cache.resize(forsyth_cache_size);
+        std::swap(cache, next_cache);
+
+        // rescore the cached vertices and their triangles, the best of them is drawn next
+        for (std::size_t i = 0; i < cache.size(); ++i)
+        {
+            cache_position[cache[i]] = static_cast<int>(i);
+            vertex_score[cache[i]] = detail::forsyth_vertex_score(static_cast<int>(i), remaining[cache[i]]);
+        }
+        best = triangle_count;
+        float best_score = -1.0f;
+        for (auto v : cache)
+        {
+            for (auto i = offsets[v]; i < offsets[v] + remaining[v]; ++i)
+            {
+                const auto t = adjacency[i];
+                const auto score = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+                if (score > best_score)
+                {
+                    best_score = score;
+                    best = t;
+                }
+            }
+        }
+    }
+
+    std::copy(order.begin(), order.end(), indices.begin());
+}
+
+// reorders cache optimized triangles by cluster, clusters start where the FIFO cache is flushed
+// (all three corners miss), so the cache efficiency inside a cluster is kept.
+// clusters facing away from the mesh center are moved to the front.
+inline void optimize_overdraw(std::span<unsigned int> indices, std::span<const Vertex> vertices, std::size_t cache_size = 16)
+{
+    const auto triangle_count = indices.size() / 3;
+    if (triangle_count < 2)
+        return;
+
+    // cluster boundaries
+    std::vector<std::size_t> cluster_start;
+    {
+        std::vector<std::size_t> loaded_at(vertices.size(), 0);
+        std::vector<bool> used(vertices.size(), false);
+        std::size_t misses = 0;
+        for (std::size_t t = 0; t < triangle_count; ++t)
+        {
+            int triangle_misses = 0;
+            for (int c = 0; c < 3; ++c)
+            {
+                const auto index = indices[t * 3 + c];
+                if (!used[index] || misses - loaded_at[index] >= cache_size)
+                {
+                    loaded_at[index] = misses++;
+                    used[index] = true;
+                    ++triangle_misses;
+                }
+            }
+            if (t == 0 || triangle_misses == 3)
+                cluster_start.push_back(t);
+        }
+    }
+    if (cluster_start.size() < 2)
+        return;
+    cluster_start.push_back(triangle_count);
+
+    glm::vec3 mesh_center{ 0.0f };
+    for (const auto& v : vertices)
+        mesh_center += v.Position;
+    mesh_center /= static_cast<float>(vertices.size());
+
+    // sort key: how far the area weighted cluster normal points away from the center
+    struct cluster
+    {
+        std::size_t first;
+        std::size_t last;
+        float key;
+    };
+    std::vector<cluster> clusters;
+    clusters.reserve(cluster_start.size() - 1);
+    for (std::size_t c = 0; c + 1 < cluster_start.size(); ++c)
+    {
+        glm::vec3 center{ 0.0f }, normal{ 0.0f };
+        float area = 0.0f;
+        for (auto t = cluster_start[c]; t < cluster_start[c + 1]; ++t)
+        {
+            const auto& p0 = vertices[indices[t * 3]].Position;
+            const auto& p1 = vertices[indices[t * 3 + 1]].Position;
+            const auto& p2 = vertices[indices[t * 3 + 2]].Position;
+            const auto n = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+            const auto a = glm::length(n);
+            center += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+        const auto key = area > 0.0f ? glm::dot(center / area - mesh_center, normal / area) : 0.0f;
+        clusters.push_back({ cluster_start[c], cluster_start[c + 1], key });
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const cluster& a, const cluster& b) { return a.key > b.key; });
+
+    std::vector<unsigned int> order;
+    order.reserve(indices.size());
+    for (const auto& c : clusters)
+        order.insert(order.end(), indices.begin() + c.first * 3, indices.begin() + c.last * 3);
+    std::copy(order.begin(), order.end(), indices.begin());
+}
+
+// reorders vertices by first use and rewrites indices, unreferenced vertices move to the end
+inline void optimize_vertex_fetch(std::span<Vertex> vertices, std::span<unsigned int> indices)
+{
+    constexpr auto unassigned = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unassigned);
+    unsigned int next = 0;
+    for (auto& index : indices)
+    {
+        if (remap[index] == unassigned)
+            remap[index] = next++;
+        index = remap[index];
+    }
+    for (auto& r : remap)
+    {
+        if (r == unassigned)
+            r = next++;
+    }
+
+    std::vector<Vertex> reordered(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+        reordered[remap[i]] = vertices[i];
+    std::copy(reordered.begin(), reordered.end(), vertices.begin());
+}
@@ -0,0 +1,269 @@
+#pragma once
+#include <span>
+#include <cmath>
+#include <vector>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+#include "hash.hpp"
+#include "mesh.hpp"
+
+// Quadric error mesh simplification (Garland & Heckbert) by edge collapse onto existing vertices.
+// Only the index buffer changes, so every level of detail keeps drawing from the vertex buffer of the full mesh.
+// Vertices on an open border or on an attribute seam (several vertices at one position) are never moved,
+// that keeps silhouettes and uv/normal seams closed at the cost of less reduction around them.
+
+struct simplify_result
+{
+    std::vector<unsigned int> indices;
+    // largest distance a collapse moved the surface, in model units: the area weighted root mean square distance of
+    // the kept vertex to the original planes around both ends of the edge
+    float error;
+};
+
+namespace detail
+{
+    // symmetric 4x4 matrix, the weighted sum of squared distances to a set of planes, and the sum of the weights
+    struct quadric
+    {
+        double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+        double weight;
+
+        quadric& operator+=(const quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+            a11 += q.a11; a12 += q.a12; a13 += q.a13;
+            a22 += q.a22; a23 += q.a23;
+            a33 += q.a33;
+            weight += q.weight;
+            return *this;
+        }
+
+        static auto plane(const glm::dvec3& n, double d, double weight) -> quadric
+        {
+            return {
+                weight * n.x * n.x, weight * n.x * n.y, weight * n.x * n.z, weight * n.x * d,
+                weight * n.y * n.y, weight * n.y * n.z, weight * n.y * d,
+                weight * n.z * n.z, weight * n.z * d,
+                weight * d * d,
+                weight
+            };
+        }
+
+        // mean squared distance of p to the planes, the weights only decide how much each plane counts
+        [[nodiscard]] auto distance2(const glm::vec3& p) const -> double
+        {
+            return weight > 0.0 ? error(p) / weight : 0.0;
+        }
+
+        [[nodiscard]] auto error(const glm::vec3& p) const -> double
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            const auto e = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x
+                         + a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y
+                         + a22 * z * z + 2.0 * a23 * z
+                         + a33;
+            return std::max(e, 0.0);
+        }
+    };
+
+    struct position_hash
+    {
+        std::size_t operator()(const glm::vec3& p) const
+        {
+            return static_cast<std::size_t>(fnv1a(p, fnv_offset_basis));
+        }
+    };
+}
+
+// simplifies indices until at most target_index_count are left or the next collapse would move the
+// surface further than max_error (model units). returns the reduced triangle list.
+[[nodiscard]] inline auto simplify(std::span<const Vertex> vertices, std::span<const unsigned int> indices,
+                                   std::size_t target_index_count, float max_error)
+    -> simplify_result
+{
+    using detail::quadric;
+
+    const auto vertex_count = vertices.size();
+    simplify_result result{ { indices.begin(), indices.end() }, 0.0f };
+    if (indices.size() <= target_index_count || vertex_count == 0)
+        return result;
+
+    // vertices sharing a position are attribute seams
+    std::vector<unsigned int> position_id(vertex_count);
+    std::vector<unsigned int> position_users;
+    {
+        std::unordered_map<glm::vec3, unsigned int, detail::position_hash> ids;
+        ids.reserve(vertex_count);
+        for (std::size_t v = 0; v < vertex_count; ++v)
+        {
+            const auto [it, inserted] = ids.emplace(vertices[v].Position, static_cast<unsigned int>(ids.size()));
+            position_id[v] = it->second;
+            if (inserted)
+                position_users.push_back(0);
+            ++position_users[it->second];
+        }
+    }
+    std::vector<bool> locked(vertex_count, false);
+    for (std::size_t v = 0; v < vertex_count; ++v)
+        locked[v] = position_users[position_id[v]] > 1;
+
+    // edges used by a single triangle are open borders
+    {
+        std::unordered_map<std::uint64_t, unsigned int> edge_use;
+        edge_use.reserve(indices.size());
+        auto edge_key = [&](unsigned int a, unsigned int b) {
+            auto pa = position_id[a], pb = position_id[b];
+            if (pa > pb)
+                std::swap(pa, pb);
+            return (std::uint64_t{ pa } << 32) | pb;
+        };
+        for (std::size_t i = 0; i < indices.size(); i += 3)
+            for (int e = 0; e < 3; ++e)
+                ++edge_use[edge_key(indices[i + e], indices[i + (e + 1) % 3])];
+        for (std::size_t i = 0; i < indices.size(); i += 3)
+        {
+            for (int e = 0; e < 3; ++e)
+            {
+                const auto a = indices[i + e], b = indices[i + (e + 1) % 3];
+                if (edge_use[edge_key(a, b)] == 1)
+                    locked[a] = locked[b] = true;
+            }
+        }
+    }
+
+    // area weighted plane quadrics of the original triangles, costs are normalized by the summed area
+    std::vector<quadric> quadrics(vertex_count, quadric{});
+    for (std::size_t i = 0; i < indices.size(); i += 3)
+    {
+        const glm::dvec3 p0{ vertices[indices[i]].Position };
+        const glm::dvec3 p1{ vertices[indices[i + 1]].Position };
+        const glm::dvec3 p2{ vertices[indices[i + 2]].Position };
+        auto n = glm::cross(p1 - p0, p2 - p0);
+        const auto length = glm::length(n);
+        if (length == 0.0)
+            continue;
+        n /= length;
+        const auto q = quadric::plane(n, -glm::dot(n, p0), length * 0.5);
+        for (int c = 0; c < 3; ++c)
+            quadrics[indices[i + c]] += q;
+    }
+
+    const double max_cost = static_cast<double>(max_error) * max_error;
+    double largest_cost = 0.0;
+
+    struct collapse
+    {
+        unsigned int from;
+        unsigned int to;
+        double cost;
+    };
+    std::vector<collapse> candidates;
+    std::vector<unsigned int> remap(vertex_count);
+    std::vector<bool> touched(vertex_count);
+    std::vector<unsigned int> offsets(vertex_count + 1), adjacency;
+
+    auto& current = result.indices;
+    while (current.size() > target_index_count)
+    {
+        // vertex -> triangle adjacency of the current triangles
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (auto index : current)
+            ++offsets[index + 1];
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        adjacency.resize(current.size());
+        {
+            auto fill = offsets;
+            for (std::size_t i = 0; i < current.size(); ++i)
+                adjacency[fill[current[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        candidates.clear();
+        for (std::size_t i = 0; i < current.size(); i += 3)
+        {
+            for (int e = 0; e < 3; ++e)
+            {
+                const auto a = current[i + e], b = current[i + (e + 1) % 3];
+                for (const auto& [from, to] : { std::pair{ a, b }, std::pair{ b, a } })
+                {
+                    if (locked[from])
+                        continue;
+                    auto q = quadrics[from];
+                    q += quadrics[to];
+                    candidates.push_back({ from, to, q.distance2(vertices[to].Position) });
+                }
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const collapse& x, const collapse& y) { return x.cost < y.cost; });
+
+        // moving from onto to must not turn any of its other triangles over
+        auto flips = [&](unsigned int from, unsigned int to) {
+            for (auto i = offsets[from]; i < offsets[from + 1]; ++i)
+            {
+                const auto* t = &current[adjacency[i] * 3];
+                if (t[0] == to || t[1] == to || t[2] == to)
+                    continue; // collapses away
+                glm::vec3 before[3], after[3];
+                for (int c = 0; c < 3; ++c)
+                {
+                    before[c] = vertices[t[c]].Position;
+                    after[c] = t[c] == from ? vertices[to].Position : before[c];
+                }
+                const auto n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+                const auto n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if (glm::dot(n0, n1) <= 0.0f)
+                    return true;
+            }
+            return false;
+        };
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(touched.begin(), touched.end(), false);
+        const auto wanted = (current.size() - target_index_count) / 3;
+        std::size_t removed = 0, collapses = 0;
+        for (const auto& c : candidates)
+        {
+            if (c.cost > max_cost || removed >= wanted)
+                break;
+            if (touched[c.from] || touched[c.to] || flips(c.from, c.to))
+                continue;
+
+            remap[c.from] = c.to;
+            quadrics[c.to] += quadrics[c.from];
+            largest_cost = std::max(largest_cost, c.cost);
+            ++collapses;
+
+            // every vertex around from sees changed triangles, leave them to the next pass
+            for (auto i = offsets[c.from]; i < offsets[c.from + 1]; ++i)
+            {
+                const auto* t = &current[adjacency[i] * 3];
+                const bool shared = t[0] == c.to || t[1] == c.to || t[2] == c.to;
+                removed += shared ? 1 : 0;
+                for (int k = 0; k < 3; ++k)
+                    touched[t[k]] = true;
+            }
+        }
+        if (collapses == 0)
+            break;
+
+        // apply the collapses and drop the triangles that degenerated
+        std::size_t write = 0;
+        for (std::size_t i = 0; i < current.size(); i += 3)
+        {
+            const auto a = remap[current[i]], b = remap[current[i + 1]], c = remap[current[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            current[write++] = a;
+            current[write++] = b;
+            current[write++] = c;
+        }
+        current.resize(write);
+    }
+
+    result.error = static_cast<float>(std::sqrt(largest_cost));
+    return result;
+}
@@ -0,0 +1,871 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <future>
+#include <memory>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_set>
+#include <unordered_map>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "lod.hpp"
+#include "frustum.hpp"
+#include "image.hpp"
+#include "mesh.hpp"
+#include "mesh_batch.hpp"
+#include "material_atlas.hpp"
+#include "mesh_cache.hpp"
+#include "gpu_memory.hpp"
+#include "async_assets.hpp"
+#include "shader.hpp"
+#include "render_queue.hpp"
+#include "thread_pool.hpp"
+#include "vertex_weld.hpp"
+#include "mesh_optimize.hpp"
+#include "mesh_simplify.hpp"
+#include "texture_registry.hpp"
+
+inline unsigned int TextureFromFile(const std::string& path, const std::string& directory, bool gamma = false);
+
+// load time switches of Model
+struct ModelOptions
+{
+    // decode material textures on the shared thread pool, only the GL upload stays on this thread
+    bool parallelTextureDecode = true;
+    // merge every static sub-mesh sharing a material into one Mesh with node transforms baked in,
+    // Draw then issues one draw per material instead of one per aiMesh
+    bool mergeByMaterial = false;
+    // upload CompactVertex instead of Vertex (24 instead of 88 bytes per vertex),
+    // the meshes keep their Vertex copy so the mesh cache is shared by both layouts
+    bool compactVertices = false;
+    // merge identical vertices of each imported mesh before upload, on the shared thread pool
+    bool weldVertices = true;
+    // reorder triangles for the post-transform vertex cache and vertices for fetch locality
+    bool optimizeVertexCache = true;
+    // additionally draw outward facing triangle clusters first, trading a little cache efficiency for less overdraw
+    bool optimizeOverdraw = false;
+    // build reduced levels of detail of every mesh, see Draw(shader, camera, ...)
+    bool generateLods = true;
+    // also pack every mesh into one mesh_batch, DrawPacked and SubmitPacked then draw the whole model with one call
+    bool packMeshes = false;
+    // pack the material textures into texture arrays as well, for DrawAtlased. implies packMeshes
+    bool atlasMaterials = false;
+};
+
+class Model
+{
+public:
+    // model data 
+    std::vector<Texture> textures_loaded;	// stores all the textures this model references, each one holds a texture_registry reference.
+    std::vector<Mesh>    meshes;
+    mesh_batch batch; // empty unless ModelOptions::packMeshes
+    material_atlas atlas; // empty unless ModelOptions::atlasMaterials
+    std::string directory;
+    bool gammaCorrection;
+    ModelOptions options;
+
+    // constructor, expects a filepath to a 3D model.
+    Model(const std::filesystem::path& path, bool gamma = false, ModelOptions opts = {}) : gammaCorrection(gamma), options(opts)
+    {
+        const gpu_memory::owner_scope owner{ path.generic_string() };
+        loadModel(path.generic_string());
+        uploadPendingMeshes();
+        writeCache();
+        uploadPendingTextures();
+        buildAtlas();
+    }
+
+    // same as the constructor without blocking the calling thread: importing, mesh preparation, the cache write
+    // and texture decoding run on the thread pool, only GL uploads resume on the main thread.
+    // completes once the render loop polled main_thread_queue::shared() for the last upload.
+    static auto loadAsync(std::filesystem::path path, bool gamma = false, ModelOptions opts = {}) -> task<std::unique_ptr<Model>>
+    {
+        std::unique_ptr<Model> model{ new Model{ gamma, opts } };
+
+        co_await schedule_on(thread_pool::shared());
+        model->loadModel(path.generic_string());
+        std::vector<task<void>> preparing;
+        preparing.reserve(model->pendingMeshes.size());
+        for (auto& data : model->pendingMeshes)
+        {
+            if (!data.prepared)
+                preparing.push_back(prepareMeshAsync(data, opts));
+        }
+        co_await when_all(std::move(preparing));
+
+        co_await resume_on_main_thread();
+        {
+            // not held across a co_await, the scope would outlive the upload
+            const gpu_memory::owner_scope owner{ path.generic_string() };
+            model->uploadPendingMeshes();
+        }
+
+        co_await schedule_on(thread_pool::shared());
+        model->writeCache();
+        std::vector<task<decoded_image>> decoding;
+        decoding.reserve(model->pendingTextures.size());
+        for (const auto& pending : model->pendingTextures)
+            decoding.push_back(decode_image_async(pending.filename));
+        const auto images = co_await when_all(std::move(decoding));
+
+        co_await resume_on_main_thread();
+        {
+            const gpu_memory::owner_scope owner{ path.generic_string() };
+            for (std::size_t i = 0; i < images.size(); i++)
+                model->uploadTexture(model->pendingTextures[i], images[i]);
+            model->pendingTextures.clear();
+            model->buildAtlas();
+        }
+        co_return model;
+    }
+
+    // textures are shared through the registry, a copy would release them twice
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+    Model(Model&&) = default;
+    Model& operator=(Model&&) = delete;
+
+    ~Model()
+    {
+        for (const auto& texture : textures_loaded)
+            texture_registry::shared().release(texture.id);
+    }
+
+    // draws the model, and thus all its meshes
+    void Draw(Shader& shader)
+    {
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader);
+    }
+
+    // draws every mesh at the coarsest level of detail whose error stays within maxPixelError on screen,
+    // model is the matrix the shader places the model with.
+    void Draw(Shader& shader, const Camera& camera, const glm::mat4& model, float viewportHeight, float maxPixelError = 1.0f)
+    {
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader, select_lod(meshes[i], model, camera, viewportHeight, maxPixelError));
+    }
+
+    // Draw leaving out the meshes whose bounding box is outside view, the meshes drawn and left out add to
+    // cull_counters. The planes are moved into model space once, so the boxes are tested as they are
+    void Draw(Shader& shader, const frustum& view, const Camera& camera, const glm::mat4& model, float viewportHeight, float maxPixelError = 1.0f)
+    {
+        const auto local = view.transformed(model);
+        std::size_t visible = 0;
+        for (auto& mesh : meshes)
+        {
+            if (!local.intersects_box(mesh.boundsMin, mesh.boundsMax))
+                continue;
+            mesh.Draw(shader, select_lod(mesh, model, camera, viewportHeight, maxPixelError));
+            ++visible;
+        }
+        cull_counters::shared().add(visible, meshes.size() - visible);
+    }
+
+    // queues every mesh at the level Draw would pick instead of drawing it right away
+    void Submit(render_queue& queue, const Shader& shader, const Camera& camera, const glm::mat4& model, float viewportHeight,
+                render_queue::options options = {}, float maxPixelError = 1.0f) const
+    {
+        for (const auto& mesh : meshes)
+            queue.submit(shader, mesh, select_lod(mesh, model, camera, viewportHeight, maxPixelError), model, options);
+    }
+
+    // Submit with the meshes outside view left out, counted like Draw counts them
+    void Submit(render_queue& queue, const Shader& shader, const frustum& view, const Camera& camera, const glm::mat4& model,
+                float viewportHeight, render_queue::options options = {}, float maxPixelError = 1.0f) const
+    {
+        const auto local = view.transformed(model);
+        std::size_t visible = 0;
+        for (const auto& mesh : meshes)
+        {
+            if (!local.intersects_box(mesh.boundsMin, mesh.boundsMax))
+                continue;
+            queue.submit(shader, mesh, select_lod(mesh, model, camera, viewportHeight, maxPixelError), model, options);
+            ++visible;
+        }
+        cull_counters::shared().add(visible, meshes.size() - visible);
+    }
+
+    // draws all meshes from the packed buffers without their textures, for depth passes and shaders reading their data
+    // by draw id (see mesh_batch). the levels are picked like Draw picks them. unpacked models issue one draw per mesh
+    void DrawPacked(const Shader& shader, const Camera& camera, const glm::mat4& model, float viewportHeight, float maxPixelError = 1.0f) const
+    {
+        shader.use();
+        selectLods(camera, model, viewportHeight, maxPixelError);
+        if (!batch.empty())
+        {
+            batch.draw(lodScratch);
+            return;
+        }
+        for (std::size_t i = 0; i < meshes.size(); i++)
+        {
+            glBindVertexArray(meshes[i].VAO);
+            meshes[i].DrawElements(lodScratch[i]);
+        }
+    }
+
+    // draws all meshes with one multi draw and one binding set (ModelOptions::atlasMaterials): the material arrays
+    // from unit 0 on, the layers of every mesh on the next unit as drawData. shader samples materialArray.<type>
+    // at the layers it reads by draw id, see material_atlas. models without an atlas draw mesh by mesh like Draw
+    void DrawAtlased(Shader& shader, const Camera& camera, const glm::mat4& model, float viewportHeight, float maxPixelError = 1.0f)
+    {
+        if (atlas.empty())
+            return Draw(shader, camera, model, viewportHeight, maxPixelError);
+        shader.use();
+        const auto unit = atlas.bind(shader);
+        batch.bind_draw_data(unit);
+        shader.set("drawData", unit);
+        selectLods(camera, model, viewportHeight, maxPixelError);
+        batch.draw(lodScratch);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // queues the packed draw, unpacked models queue their meshes as Submit does
+    void SubmitPacked(render_queue& queue, const Shader& shader, const Camera& camera, const glm::mat4& model, float viewportHeight,
+                      render_queue::options options = {}, float maxPixelError = 1.0f) const
+    {
+        if (batch.empty())
+            return Submit(queue, shader, camera, model, viewportHeight, options, maxPixelError);
+        selectLods(camera, model, viewportHeight, maxPixelError);
+        queue.submit(shader, batch, lodScratch, model, options);
+    }
+
+    // SubmitPacked leaving out the whole model when the sphere around all its meshes is outside view, the packed
+    // draw stays one draw. unpacked models are culled mesh by mesh as Submit does
+    void SubmitPacked(render_queue& queue, const Shader& shader, const frustum& view, const Camera& camera, const glm::mat4& model,
+                      float viewportHeight, render_queue::options options = {}, float maxPixelError = 1.0f) const
+    {
+        if (batch.empty())
+            return Submit(queue, shader, view, camera, model, viewportHeight, options, maxPixelError);
+        const bool visible = view.intersects_sphere(world_sphere(batch.bounds_center(), batch.bounds_radius(), model));
+        cull_counters::shared().add(visible ? batch.size() : 0, visible ? 0 : batch.size());
+        if (visible)
+            SubmitPacked(queue, shader, camera, model, viewportHeight, options, maxPixelError);
+    }
+
+    // post-processing steps applied on import, part of the mesh cache key.
+    static constexpr unsigned int importFlags = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
+    // interleaves assimp's per attribute arrays into Vertex, sized once, one branch free loop per attribute.
+    static std::vector<Vertex> convertVertices(const aiMesh* mesh)
+    {
+        std::vector<Vertex> vertices(mesh->mNumVertices); // value initialized, attributes assimp does not provide stay zero
+        convertVertices(mesh, vertices.data());
+        return vertices;
+    }
+
+    // same as above into mNumVertices zero initialized vertices
+    static void convertVertices(const aiMesh* mesh, Vertex* vertices)
+    {
+        static_assert(sizeof(aiVector3D) == sizeof(glm::vec3), "assimp must be built with single precision ai_real");
+
+        const auto count = mesh->mNumVertices;
+        auto copyVec3 = [&](glm::vec3 Vertex::* attribute, const aiVector3D* src) {
+            for (unsigned int i = 0; i < count; i++)
+                std::memcpy(&(vertices[i].*attribute), &src[i], sizeof(glm::vec3));
+        };
+
+        // positions
+        copyVec3(&Vertex::Position, mesh->mVertices);
+        // normals
+        if (mesh->mNormals)
+            copyVec3(&Vertex::Normal, mesh->mNormals);
+        // texture coordinates
+        // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
+        // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
+        if (const auto* uv = mesh->mTextureCoords[0])
+        {
+            for (unsigned int i = 0; i < count; i++)
+                std::memcpy(&vertices[i].TexCoords, &uv[i], sizeof(glm::vec2));
+            // tangent space is only generated when there are texture coordinates
+            if (mesh->mTangents && mesh->mBitangents)
+            {
+                copyVec3(&Vertex::Tangent, mesh->mTangents);
+                copyVec3(&Vertex::Bitangent, mesh->mBitangents);
+            }
+        }
+    }
+
+    // flattens the faces into an index array, faces are read in place.
+    static std::vector<unsigned int> convertIndices(const aiMesh* mesh)
+    {
+        std::vector<unsigned int> indices(countIndices(mesh));
+        convertIndices(mesh, indices.data());
+        return indices;
+    }
+
+    static std::size_t countIndices(const aiMesh* mesh)
+    {
+        std::size_t count = 0;
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+            count += mesh->mFaces[i].mNumIndices;
+        return count;
+    }
+
+    // same as above into countIndices(mesh) indices, baseVertex is added to every index
+    static void convertIndices(const aiMesh* mesh, unsigned int* out, unsigned int baseVertex = 0)
+    {
+        const bool triangles = countIndices(mesh) == std::size_t{ mesh->mNumFaces } * 3;
+        if (triangles && baseVertex == 0)
+        {
+            for (unsigned int i = 0; i < mesh->mNumFaces; i++, out += 3)
+                std::memcpy(out, mesh->mFaces[i].mIndices, 3 * sizeof(unsigned int));
+        }
+        else
+        {
+            // points and lines survive aiProcess_Triangulate
+            for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+            {
+                const aiFace& face = mesh->mFaces[i];
+                for (unsigned int j = 0; j < face.mNumIndices; j++)
+                    *out++ = face.mIndices[j] + baseVertex;
+            }
+        }
+    }
+
+    // moves vertices from node space into model space
+    static void bakeTransform(std::span<Vertex> vertices, const glm::mat4& transform)
+    {
+        if (transform == glm::mat4{ 1.0f })
+            return;
+
+        const glm::mat3 linear{ transform };
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+        auto direction = [](const glm::mat3& m, const glm::vec3& v) {
+            const auto t = m * v;
+            const auto length = glm::length(t);
+            return length > 0.0f ? t / length : t; // absent attributes stay zero
+        };
+        for (auto& v : vertices)
+        {
+            v.Position = glm::vec3{ transform * glm::vec4{ v.Position, 1.0f } };
+            v.Normal = direction(normalMatrix, v.Normal);
+            v.Tangent = direction(linear, v.Tangent);
+            v.Bitangent = direction(linear, v.Bitangent);
+        }
+    }
+
+private:
+    // arrays of a mesh that is built but not uploaded yet, its textures only carry type and path until the upload
+    struct MeshData
+    {
+        std::vector<Vertex> vertices{};
+        std::vector<unsigned int> indices{};
+        std::vector<Texture> textures{};
+        std::vector<MeshRange> ranges{};
+        std::vector<unsigned int> lodIndices{};
+        std::vector<MeshLod> lods{};
+        // welded, optimized and simplified already (by prepareMesh or the mesh cache)
+        bool prepared = false;
+        // arrays of a cached mesh, inside cacheMapping. they take the place of vertices, indices and lodIndices
+        bool mapped = false;
+        std::span<const Vertex> mappedVertices{};
+        std::span<const unsigned int> mappedIndices{};
+        std::span<const unsigned int> mappedLodIndices{};
+    };
+    std::vector<MeshData> pendingMeshes;
+
+    // texture name handed out to a mesh whose pixels are not uploaded yet
+    struct PendingTexture
+    {
+        unsigned int id;
+        std::string filename;
+    };
+    std::vector<PendingTexture> pendingTextures;
+    // material texture path -> index in textures_loaded
+    std::unordered_map<std::string, std::size_t> loadedIndex;
+
+    // mesh cache of the model file, written once the imported meshes are uploaded
+    std::uint64_t cacheKey = 0;
+    std::filesystem::path cachePath;
+    bool cacheOutdated = false;
+    // the cache file a warm load maps, shared with the meshes uploaded from it, which view it instead of copying
+    std::shared_ptr<const mesh_cache::reader> cacheMapping;
+    // levels of the packed draws, one per mesh
+    mutable std::vector<std::size_t> lodScratch;
+
+    Model(bool gamma, ModelOptions opts) : gammaCorrection(gamma), options(opts)
+    {
+    }
+
+    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in pendingMeshes.
+    // touches no GL state, so it can run on any thread.
+    void loadModel(const std::string& path)
+    {
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // a baked cache next to the source skips ASSIMP entirely on warm starts
+        cacheKey = mesh_cache::make_key(path, importFlags, cacheVariant());
+        cachePath = mesh_cache::cache_path_for(path);
+        if (cacheKey != 0 && loadCachedModel(cachePath, cacheKey))
+            return;
+
+        // read file via ASSIMP
+        Assimp::Importer importer;
+        const aiScene* scene = importer.ReadFile(path, importFlags);
+        // check for errors
+        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+        {
+            std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+            return;
+        }
+
+        // process ASSIMP's root node recursively
+        pendingMeshes.reserve(scene->mNumMeshes);
+        if (options.mergeByMaterial)
+            processSceneMerged(scene);
+        else
+            processNode(scene->mRootNode, scene);
+        cacheOutdated = cacheKey != 0;
+    }
+
+    // bakes the uploaded meshes into the cache if they were imported
+    void writeCache()
+    {
+        if (cacheOutdated && !mesh_cache::write(cachePath, cacheKey, meshes))
+            std::cout << "WARNING::MESH_CACHE:: failed to write " << cachePath << std::endl;
+        cacheOutdated = false;
+    }
+
+    // reads the meshes from a mapped cache file, returns false if the cache is missing or stale.
+    // vertices and indices stay in the mapping, the meshes are uploaded from it and keep it open
+    bool loadCachedModel(const std::filesystem::path& cachePath, std::uint64_t key)
+    {
+        auto cache = std::make_shared<const mesh_cache::reader>(cachePath, key);
+        if (!*cache)
+            return false;
+
+        pendingMeshes.reserve(cache->mesh_count());
+        for (std::size_t i = 0; i < cache->mesh_count(); i++)
+        {
+            const auto view = cache->mesh(i);
+            MeshData data;
+            data.textures.reserve(view.textures.size());
+            for (const auto& record : view.textures)
+            {
+                const auto ref = cache->texture(record);
+                data.textures.push_back({ 0, std::string{ ref.type }, std::string{ ref.path } });
+            }
+            data.ranges.assign(view.ranges.begin(), view.ranges.end());
+            data.lods.assign(view.lods.begin(), view.lods.end());
+            data.prepared = true;
+            data.mapped = true;
+            data.mappedVertices = view.vertices;
+            data.mappedIndices = view.indices;
+            data.mappedLodIndices = view.lod_indices;
+            pendingMeshes.push_back(std::move(data));
+        }
+        cacheMapping = std::move(cache);
+        return true;
+    }
+
+    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
+    void processNode(aiNode* node, const aiScene* scene)
+    {
+        // process each mesh located at the current node
+        for (unsigned int i = 0; i < node->mNumMeshes; i++)
+        {
+            // the node object only contains indices to index the actual objects in the scene. 
+            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
+            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+            pendingMeshes.push_back(processMesh(mesh, scene));
+        }
+        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+        for (unsigned int i = 0; i < node->mNumChildren; i++)
+        {
+            processNode(node->mChildren[i], scene);
+        }
+
+    }
+
+    // builds one Mesh per material out of every mesh instance of static nodes, in material order.
+    // meshes under animated nodes cannot be baked and keep their own Mesh.
+    void processSceneMerged(const aiScene* scene)
+    {
+        struct Instance
+        {
+            const aiMesh* mesh;
+            glm::mat4 transform;
+        };
+        std::vector<std::vector<Instance>> byMaterial(scene->mNumMaterials);
+        std::vector<const aiMesh*> animated;
+
+        std::unordered_set<std::string> animatedNodes;
+        for (unsigned int a = 0; a < scene->mNumAnimations; a++)
+            for (unsigned int c = 0; c < scene->mAnimations[a]->mNumChannels; c++)
+                animatedNodes.emplace(scene->mAnimations[a]->mChannels[c]->mNodeName.C_Str());
+
+        auto collect = [&](auto&& self, const aiNode* node, const glm::mat4& parent, bool isStatic) -> void {
+            // assimp matrices are row major
+            const auto transform = parent * glm::transpose(glm::make_mat4(&node->mTransformation.a1));
+            isStatic = isStatic && !animatedNodes.contains(node->mName.C_Str());
+            for (unsigned int i = 0; i < node->mNumMeshes; i++)
+            {
+                const aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+                if (isStatic)
+                    byMaterial[mesh->mMaterialIndex].push_back({ mesh, transform });
+                else
+                    animated.push_back(mesh);
+            }
+            for (unsigned int i = 0; i < node->mNumChildren; i++)
+                self(self, node->mChildren[i], transform, isStatic);
+        };
+        collect(collect, scene->mRootNode, glm::mat4{ 1.0f }, true);
+
+        for (unsigned int m = 0; m < scene->mNumMaterials; m++)
+        {
+            const auto& instances = byMaterial[m];
+            if (instances.empty())
+                continue;
+
+            std::size_t vertexCount = 0, indexCount = 0;
+            for (const auto& instance : instances)
+            {
+                vertexCount += instance.mesh->mNumVertices;
+                indexCount += countIndices(instance.mesh);
+            }
+
+            std::vector<Vertex> vertices(vertexCount);
+            std::vector<unsigned int> indices(indexCount);
+            std::vector<MeshRange> ranges;
+            ranges.reserve(instances.size());
+            unsigned int firstVertex = 0, firstIndex = 0;
+            for (const auto& instance : instances)
+            {
+                const MeshRange range{ firstIndex, static_cast<unsigned int>(countIndices(instance.mesh)), firstVertex, instance.mesh->mNumVertices };
+                convertVertices(instance.mesh, vertices.data() + firstVertex);
+                bakeTransform({ vertices.data() + firstVertex, range.vertexCount }, instance.transform);
+                convertIndices(instance.mesh, indices.data() + firstIndex, firstVertex);
+                firstVertex += range.vertexCount;
+                firstIndex += range.indexCount;
+                ranges.push_back(range);
+            }
+            pendingMeshes.push_back({ std::move(vertices), std::move(indices), processMaterial(scene->mMaterials[m]), std::move(ranges) });
+        }
+
+        for (const aiMesh* mesh : animated)
+            pendingMeshes.push_back(processMesh(mesh, scene));
+    }
+
+    MeshData processMesh(const aiMesh* mesh, const aiScene* scene)
+    {
+        // return the extracted mesh data, the arrays are moved all the way into the Mesh
+        return { convertVertices(mesh), convertIndices(mesh), processMaterial(scene->mMaterials[mesh->mMaterialIndex]) };
+    }
+
+    // reads the uploaded textures back into the arrays of the atlas, whose layers become the draw data of the batch
+    void buildAtlas()
+    {
+        if (!options.atlasMaterials)
+            return;
+        atlas = material_atlas{ meshes };
+        batch.set_draw_data(atlas.layers());
+    }
+
+    // level of every mesh into lodScratch, resized only when meshes were added
+    void selectLods(const Camera& camera, const glm::mat4& model, float viewportHeight, float maxPixelError) const
+    {
+        lodScratch.resize(meshes.size());
+        for (std::size_t i = 0; i < meshes.size(); i++)
+            lodScratch[i] = select_lod(meshes[i], model, camera, viewportHeight, maxPixelError);
+    }
+
+    // welds, optimizes and simplifies every pending mesh on the thread pool when enabled and uploads it.
+    // uploads are issued here in order so the upload of one mesh overlaps the preparation of the next.
+    void uploadPendingMeshes()
+    {
+        auto upload = [this](MeshData& data) {
+            for (auto& texture : data.textures)
+                texture = loadMaterialTexture(texture.path, texture.type);
+            if (data.mapped)
+                meshes.emplace_back(data.mappedVertices, data.mappedIndices, std::move(data.textures), std::move(data.ranges), vertexLayout(),
+                                    data.mappedLodIndices, std::move(data.lods), cacheMapping);
+            else
+                meshes.emplace_back(std::move(data.vertices), std::move(data.indices), std::move(data.textures), std::move(data.ranges), vertexLayout(),
+                                    std::move(data.lodIndices), std::move(data.lods));
+        };
+
+        meshes.reserve(meshes.size() + pendingMeshes.size());
+        const bool prepare = options.weldVertices || options.optimizeVertexCache || options.generateLods;
+        std::vector<std::future<void>> prepared(pendingMeshes.size());
+        for (std::size_t i = 0; i < pendingMeshes.size(); i++)
+        {
+            if (prepare && !pendingMeshes[i].prepared)
+                prepared[i] = thread_pool::shared().submit([&data = pendingMeshes[i], opts = options] { prepareMesh(data, opts); });
+        }
+        for (std::size_t i = 0; i < pendingMeshes.size(); i++)
+        {
+            if (prepared[i].valid())
+                prepared[i].get();
+            upload(pendingMeshes[i]);
+        }
+        pendingMeshes.clear();
+        if (options.packMeshes || options.atlasMaterials)
+            batch = mesh_batch{ meshes };
+        // the meshes hold on to the mapping as long as they view it
+        cacheMapping.reset();
+    }
+
+    static void prepareMesh(MeshData& data, const ModelOptions& opts)
+    {
+        if (opts.weldVertices)
+            weldMesh(data);
+        if (opts.optimizeVertexCache)
+            optimizeMesh(data, opts.optimizeOverdraw);
+        if (opts.generateLods)
+            buildLods(data, opts.optimizeVertexCache);
+        data.prepared = true;
+    }
+
+    static auto prepareMeshAsync(MeshData& data, ModelOptions opts) -> task<void>
+    {
+        co_await schedule_on(thread_pool::shared());
+        prepareMesh(data, opts);
+    }
+
+    // reduced levels with 1/2, 1/4... of the triangles. each one is simplified from the full mesh so its error
+    // is measured against the original surface, the chain ends when the simplifier cannot reduce any further.
+    static void buildLods(MeshData& data, bool optimize)
+    {
+        constexpr int maxLevels = 4;
+        constexpr float maxRelativeError = 0.05f; // of the bounding box diagonal
+        if (data.vertices.empty())
+            return;
+
+        glm::vec3 lower = data.vertices[0].Position, upper = lower;
+        for (const auto& v : data.vertices)
+        {
+            lower = glm::min(lower, v.Position);
+            upper = glm::max(upper, v.Position);
+        }
+        const auto maxError = maxRelativeError * glm::length(upper - lower);
+
+        data.lods.push_back({ 0, static_cast<unsigned int>(data.indices.size()), 0.0f });
+        auto target = data.indices.size();
+        for (int level = 1; level <= maxLevels; level++)
+        {
+            target /= 2;
+            auto simplified = simplify(data.vertices, data.indices, target, maxError);
+            const auto previous = data.lods.back();
+            if (simplified.indices.empty() || simplified.indices.size() > previous.indexCount * 3 / 4)
+                break;
+
+            if (optimize)
+                optimize_vertex_cache(simplified.indices, data.vertices.size());
+            // coarser levels never report a smaller error, select_lod relies on it
+            const MeshLod lod{ static_cast<unsigned int>(data.indices.size() + data.lodIndices.size()),
+                               static_cast<unsigned int>(simplified.indices.size()),
+                               std::max(simplified.error, previous.error) };
+            data.lodIndices.insert(data.lodIndices.end(), simplified.indices.begin(), simplified.indices.end());
+            data.lods.push_back(lod);
+        }
+    }
+
+    // reorders triangles and vertices of each range of a merged mesh on its own, nothing crosses a range boundary.
+    static void optimizeMesh(MeshData& data, bool overdraw)
+    {
+        auto optimize = [overdraw](std::span<Vertex> vertices, std::span<unsigned int> indices, unsigned int baseVertex) {
+            for (auto& index : indices)
+                index -= baseVertex;
+            optimize_vertex_cache(indices, vertices.size());
+            if (overdraw)
+                optimize_overdraw(indices, vertices);
+            optimize_vertex_fetch(vertices, indices);
+            for (auto& index : indices)
+                index += baseVertex;
+        };
+
+        if (data.ranges.empty())
+        {
+            optimize(data.vertices, data.indices, 0);
+            return;
+        }
+        for (const auto& range : data.ranges)
+            optimize({ data.vertices.data() + range.firstVertex, range.vertexCount },
+                     { data.indices.data() + range.firstIndex, range.indexCount }, range.firstVertex);
+    }
+
+    // welds each range of a merged mesh on its own so the ranges stay contiguous, then closes the gaps.
+    static void weldMesh(MeshData& data)
+    {
+        if (data.ranges.empty())
+        {
+            data.vertices.resize(weld_vertices(data.vertices, data.indices));
+            data.vertices.shrink_to_fit(); // the Mesh keeps this copy for its lifetime
+            return;
+        }
+
+        unsigned int firstVertex = 0;
+        for (auto& range : data.ranges)
+        {
+            const std::span<Vertex> vertices{ data.vertices.data() + range.firstVertex, range.vertexCount };
+            const std::span<unsigned int> indices{ data.indices.data() + range.firstIndex, range.indexCount };
+            const auto count = static_cast<unsigned int>(weld_vertices(vertices, indices, range.firstVertex));
+
+            // firstVertex never passes range.firstVertex, copying forward is safe
+            std::copy_n(vertices.begin(), count, data.vertices.begin() + firstVertex);
+            for (auto& index : indices)
+                index -= range.firstVertex - firstVertex;
+            range.firstVertex = firstVertex;
+            range.vertexCount = count;
+            firstVertex += count;
+        }
+        data.vertices.resize(firstVertex);
+        data.vertices.shrink_to_fit();
+    }
+
+    // load options that change the baked meshes
+    std::uint32_t cacheVariant() const
+    {
+        return (options.mergeByMaterial ? 1u : 0u) | (options.weldVertices ? 2u : 0u)
+             | (options.optimizeVertexCache ? 4u : 0u) | (options.optimizeVertexCache && options.optimizeOverdraw ? 8u : 0u)
+             | (options.generateLods ? 16u : 0u);
+    }
+
+    VertexLayout vertexLayout() const
+    {
+        return options.compactVertices ? VertexLayout::Compact : VertexLayout::Full;
+    }
+
+    static std::vector<Texture> processMaterial(aiMaterial* material)
+    {
+        // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
+        // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
+        // Same applies to other texture as the following list summarizes:
+        // diffuse: texture_diffuseN
+        // specular: texture_specularN
+        // normal: texture_normalN
+        // reflection: texture_reflectionN, the ambient maps of the nanosuit_reflection materials
+        std::vector<Texture> textures;
+        textures.reserve(material->GetTextureCount(aiTextureType_DIFFUSE) + material->GetTextureCount(aiTextureType_SPECULAR)
+                         + material->GetTextureCount(aiTextureType_NORMALS) + material->GetTextureCount(aiTextureType_HEIGHT)
+                         + material->GetTextureCount(aiTextureType_AMBIENT));
+        // 1. diffuse maps
+        loadMaterialTextures(material, aiTextureType_DIFFUSE, "diffuse", textures);
+        // 2. specular maps
+        loadMaterialTextures(material, aiTextureType_SPECULAR, "specular", textures);
+        // 3. normal maps
+        loadMaterialTextures(material, aiTextureType_NORMALS, "normal", textures);
+        // 4. height maps
+        loadMaterialTextures(material, aiTextureType_HEIGHT, "height", textures);
+        // 5. reflection maps
+        loadMaterialTextures(material, aiTextureType_AMBIENT, "reflection", textures);
+        return textures;
+    }
+
+    // appends all material textures of a given type, they are loaded by uploadPendingMeshes.
+    static void loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName, std::vector<Texture>& textures)
+    {
+        for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        {
+            aiString str;
+            mat->GetTexture(type, i, &str);
+            textures.push_back({ 0, typeName, str.C_Str() });
+        }
+    }
+
+    // loads a single material texture, reusing it if the same filepath was loaded before by this or any other model.
+    Texture loadMaterialTexture(const std::string& path, const std::string& typeName)
+    {
+        // check if this model already references the texture
+        if (const auto it = loadedIndex.find(path); it != loadedIndex.end())
+            return textures_loaded[it->second];
+
+        // otherwise ask the registry, only the first user of a file reserves a new name
+        // and uploads the pixels once all meshes are processed
+        auto filename = this->directory + '/' + path;
+        const auto [id, created] = texture_registry::shared().acquire(filename);
+        if (created)
+            pendingTextures.push_back({ id, std::move(filename) });
+
+        Texture texture;
+        texture.id = id;
+        texture.type = typeName;
+        texture.path = path;
+        loadedIndex.emplace(path, textures_loaded.size());
+        textures_loaded.push_back(texture);
+        return texture;
+    }
+
+    // decodes every pending texture and uploads it. decoding runs on the thread pool when enabled,
+    // uploads are issued here in request order so the upload of one texture overlaps the decode of the next.
+    void uploadPendingTextures()
+    {
+        if (options.parallelTextureDecode)
+        {
+            std::vector<std::future<decoded_image>> decoded;
+            decoded.reserve(pendingTextures.size());
+            for (const auto& pending : pendingTextures)
+                decoded.push_back(thread_pool::shared().submit([filename = pending.filename] { return decoded_image{ filename }; }));
+            for (std::size_t i = 0; i < pendingTextures.size(); i++)
+                uploadTexture(pendingTextures[i], decoded[i].get());
+        }
+        else
+        {
+            for (const auto& pending : pendingTextures)
+                uploadTexture(pending, decoded_image{ pending.filename });
+        }
+        pendingTextures.clear();
+    }
+
+    // the registry learns the content hash taken by the decode first, a copy of an image some model already
+    // loaded takes over that texture instead of being uploaded again
+    void uploadTexture(const PendingTexture& pending, const decoded_image& image)
+    {
+        const GLuint id = texture_registry::shared().resolve(pending.id, image.content());
+        if (id != pending.id)
+            renameTexture(pending.id, id);
+        else if (image)
+            upload_image(pending.id, image);
+        else
+            std::cout << "Texture failed to load at path: " << pending.filename << std::endl;
+    }
+
+    // points every use of texture from at to, before the meshes have been drawn
+    void renameTexture(unsigned int from, unsigned int to)
+    {
+        for (auto& texture : textures_loaded)
+        {
+            if (texture.id == from)
+                texture.id = to;
+        }
+        for (auto& mesh : meshes)
+        {
+            for (auto& texture : mesh.textures)
+            {
+                if (texture.id == from)
+                    texture.id = to;
+            }
+        }
+    }
+};
+
+
+inline unsigned int TextureFromFile(const std::string& path, const std::string& directory, bool gamma)
+{
+    std::string filename = directory + '/' + path;
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    if (const decoded_image image{ filename })
+        upload_image(textureID, image);
+    else
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+
+    return textureID;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <format>
+#include <cstddef>
+#include <iostream>
+#include <string_view>
+
+#include <glad/glad.h>
+
+// GL_KHR_parallel_shader_compile and GL_ARB_parallel_shader_compile share their tokens, glad is generated without them
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Deferred program builds. Once enable()d, Shader submits the compile and link of its stages and returns without
+// asking GL how they went, the status queries are what make the driver finish a compile before the next one
+// is submitted. The checks run when the Shader is first used (use(), set(), prog_id()), by then the driver had
+// the time of every other submission and of the loading in between.
+// With GL_KHR_parallel_shader_compile (or the ARB version) the driver compiles on threads of its own and
+// Shader::ready() asks whether a program is done without waiting for it. Without it the work may still overlap
+// with the application, but ready() cannot tell and is always true.
+//   parallel_compile::shared().enable(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));   // after gladLoadGL
+//   Shader a{ ... }; Shader b{ ... };   // both submitted
+//   a.use();                            // waits for a only
+// Like the rest of the GL side it is only used from the context thread.
+class parallel_compile
+{
+public:
+    struct statistics
+    {
+        std::size_t submitted;
+        // programs done before their first use, and the ones it waited for
+        std::size_t ready;
+        std::size_t waited;
+        double wait_ms;
+    };
+
+    [[nodiscard]] static auto shared() -> parallel_compile&
+    {
+        static parallel_compile compile;
+        return compile;
+    }
+
+    parallel_compile(const parallel_compile&) = delete;
+    parallel_compile& operator=(const parallel_compile&) = delete;
+
+    // defers the checks of the programs built from now on. load resolves glMaxShaderCompilerThreads, without it the
+    // driver picks the number of threads
+    void enable(GLADloadproc load = nullptr)
+    {
+        enabled_ = true;
+        extension_ = has_extension("GL_KHR_parallel_shader_compile") || has_extension("GL_ARB_parallel_shader_compile");
+        if (!extension_ || !load)
+            return;
+        using max_threads_proc = void(APIENTRYP)(GLuint);
+        auto max_threads = reinterpret_cast<max_threads_proc>(load("glMaxShaderCompilerThreadsKHR"));
+        if (!max_threads)
+            max_threads = reinterpret_cast<max_threads_proc>(load("glMaxShaderCompilerThreadsARB"));
+        // 0xFFFFFFFF, as many as the implementation likes
+        if (max_threads)
+            max_threads(~GLuint{ 0 });
+    }
+
+    // builds checked right away again
+    void disable() { enabled_ = false; }
+
+    [[nodiscard]] bool enabled() const { return enabled_; }
+    // whether the driver says when a program is done
+    [[nodiscard]] bool extension() const { return extension_; }
+
+    // whether the link of program is done, true when the driver cannot say
+    [[nodiscard]] bool done(GLuint program) const
+    {
+        if (!extension_)
+            return true;
+        GLint done = GL_TRUE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+
+    void submitted() { ++stats_.submitted; }
+
+    // a program checked at its first use, after waiting ms for it
+    void finished(bool was_ready, double ms)
+    {
+        if (was_ready)
+            ++stats_.ready;
+        else
+            ++stats_.waited;
+        stats_.wait_ms += ms;
+    }
+
+    [[nodiscard]] auto stats() const -> const statistics& { return stats_; }
+    void reset_stats() { stats_ = {}; }
+
+    void report() const
+    {
+        std::cout << std::format("parallel compile: {}, {} programs submitted, {} done at first use, {} waited for, "
+                                 "{:.1f} ms in checks\n",
+                                 extension_ ? "driver threads" : "no completion query", stats_.submitted, stats_.ready,
+                                 stats_.waited, stats_.wait_ms);
+    }
+
+private:
+    parallel_compile() = default;
+
+    static auto has_extension(std::string_view name) -> bool
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const auto* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+            if (extension && name == extension)
+                return true;
+        }
+        return false;
+    }
+
+    bool enabled_{ false };
+    bool extension_{ false };
+    statistics stats_{};
+};
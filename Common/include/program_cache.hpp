@@ -0,0 +1,273 @@
+#pragma once
+#include <span>
+#include <chrono>
+#include <format>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <string_view>
+#include <system_error>
+
+#include <glad/glad.h>
+
+#include "hash.hpp"
+#include "mapped_file.hpp"
+
+// one stage of a program, its type (GL_VERTEX_SHADER, ...) and full source text
+struct shader_stage
+{
+    GLenum type;
+    std::string source;
+};
+
+// Linked programs kept on disk as driver binaries (glGetProgramBinary), so a warm start loads them with
+// glProgramBinary instead of compiling and linking every stage again.
+// A program is keyed by the hash of its stage types and sources and of the driver (vendor, renderer and version
+// strings). Defines are part of the source text, so each variant gets its own entry. A driver may still refuse a
+// binary it wrote (after an update that keeps the version string), the entry is then dropped and the program built
+// from source and cached again. Shader goes through build(), demos need not do anything.
+//
+// file layout, <directory>/<key>.progbin:
+//   file_header
+//   binary bytes  (header.size, in header.format)
+// Like the rest of the GL side it is only used from the context thread.
+class program_cache
+{
+public:
+    static constexpr char          magic[4]{ 'L', 'O', 'P', 'B' };
+    static constexpr std::uint32_t version = 1;
+
+    struct file_header
+    {
+        char          magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint32_t format;
+        std::uint32_t size;
+    };
+
+    struct statistics
+    {
+        std::size_t loaded;
+        std::size_t compiled;
+        // binaries the driver refused, compiled again
+        std::size_t rejected;
+        std::size_t stored;
+        double load_ms;
+        double compile_ms;
+    };
+
+    [[nodiscard]] static auto shared() -> program_cache&
+    {
+        static program_cache cache;
+        return cache;
+    }
+
+    program_cache(const program_cache&) = delete;
+    program_cache& operator=(const program_cache&) = delete;
+
+    // where the binaries go, program_cache/ in the working directory by default
+    void set_directory(std::filesystem::path directory) { directory_ = std::move(directory); }
+    [[nodiscard]] auto directory() const -> const std::filesystem::path& { return directory_; }
+
+    // off, every program compiles from source and nothing is written
+    void set_enabled(bool enabled) { enabled_ = enabled; }
+
+    // whether binaries are used, false as well when the context supports no binary format
+    [[nodiscard]] bool enabled()
+    {
+        if (!enabled_)
+            return false;
+        if (!supported_)
+        {
+            GLint formats = 0;
+            if (glGetProgramBinary && glProgramBinary && glProgramParameteri)
+                glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            supported_ = formats > 0 ? 1 : -1;
+        }
+        return supported_ > 0;
+    }
+
+    // removes every cached binary, the next builds are cold
+    void clear()
+    {
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator{ directory_, error })
+        {
+            if (entry.path().extension() == ".progbin")
+                std::filesystem::remove(entry.path(), error);
+        }
+    }
+
+    [[nodiscard]] auto key(std::span<const shader_stage> stages) -> std::uint64_t
+    {
+        auto hash = fnv1a(driver());
+        hash = fnv1a(version, hash);
+        for (const auto& stage : stages)
+        {
+            hash = fnv1a(stage.type, hash);
+            hash = fnv1a(stage.source, hash);
+            // keeps "ab" + "c" apart from "a" + "bc"
+            hash = fnv1a(static_cast<std::uint64_t>(stage.source.size()), hash);
+        }
+        return hash == 0 ? 1 : hash;
+    }
+
+    // the program of stages, from its binary when there is one the driver takes, otherwise from link(), a callable
+    // returning a program linked from the stages. link() must set GL_PROGRAM_BINARY_RETRIEVABLE_HINT when enabled().
+    // a program that failed to link is returned as it is and not stored
+    template <typename Link>
+    auto build(std::span<const shader_stage> stages, Link&& link) -> GLuint
+    {
+        const auto use_binaries = enabled();
+        const auto program_key = use_binaries ? key(stages) : 0;
+        if (use_binaries)
+        {
+            if (const auto program = load(program_key))
+                return program;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const GLuint program = std::forward<Link>(link)();
+        compiled(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        if (use_binaries && linked(program))
+            store(program_key, program);
+        return program;
+    }
+
+    // the parts of build() for programs linked in the background (parallel_compile.hpp): load() up front, and
+    // compiled() and store() once the link is done
+
+    // the program of a valid binary of key, 0 when there is none
+    auto load(std::uint64_t key) -> GLuint
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const auto path = path_of(key);
+        GLuint program = 0;
+        {
+            const mapped_file file{ path };
+            if (!file || file.size() < sizeof(file_header))
+                return 0;
+            file_header header{};
+            std::memcpy(&header, file.data(), sizeof(header));
+            if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.key != key
+                || sizeof(file_header) + std::uint64_t{ header.size } > file.size())
+                return 0;
+
+            program = glCreateProgram();
+            glProgramBinary(program, header.format, file.data() + sizeof(file_header), static_cast<GLsizei>(header.size));
+        }
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked)
+        {
+            ++stats_.loaded;
+            stats_.load_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            return program;
+        }
+        glDeleteProgram(program);
+        ++stats_.rejected;
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return 0;
+    }
+
+    // counts a program built from source in ms
+    void compiled(double ms)
+    {
+        ++stats_.compiled;
+        stats_.compile_ms += ms;
+    }
+
+    [[nodiscard]] static auto linked(GLuint program) -> bool
+    {
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        return status == GL_TRUE;
+    }
+
+    // stores the binary of a linked program. writes to a temporary file first and renames it, so a crash never leaves
+    // a torn binary behind
+    void store(std::uint64_t key, GLuint program)
+    {
+        GLint size = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+        if (size <= 0)
+            return;
+
+        std::vector<char> binary(static_cast<std::size_t>(size));
+        GLenum format = 0;
+        GLsizei length = 0;
+        glGetProgramBinary(program, size, &length, &format, binary.data());
+        if (length <= 0)
+            return;
+
+        file_header header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.key = key;
+        header.format = format;
+        header.size = static_cast<std::uint32_t>(length);
+
+        std::error_code error;
+        std::filesystem::create_directories(directory_, error);
+        const auto path = path_of(key);
+        auto tmp = path;
+        tmp += ".tmp";
+        {
+            std::ofstream out{ tmp, std::ios::binary | std::ios::trunc };
+            if (!out)
+                return;
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(binary.data(), length);
+            if (!out)
+                return;
+        }
+        std::filesystem::rename(tmp, path, error);
+        if (!error)
+            ++stats_.stored;
+    }
+
+    [[nodiscard]] auto stats() const -> const statistics& { return stats_; }
+    void reset_stats() { stats_ = {}; }
+
+    void report() const
+    {
+        std::cout << std::format("program cache: {} loaded in {:.1f} ms, {} compiled in {:.1f} ms, {} rejected, {} stored\n",
+                                 stats_.loaded, stats_.load_ms, stats_.compiled, stats_.compile_ms, stats_.rejected,
+                                 stats_.stored);
+    }
+
+private:
+    program_cache() = default;
+
+    // the strings that change when a binary of the driver stops being valid
+    auto driver() -> const std::string&
+    {
+        if (driver_.empty())
+        {
+            for (const auto name : { GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION })
+            {
+                if (const auto* text = glGetString(name))
+                    driver_ += reinterpret_cast<const char*>(text);
+                driver_ += '\n';
+            }
+        }
+        return driver_;
+    }
+
+    [[nodiscard]] auto path_of(std::uint64_t key) const -> std::filesystem::path
+    {
+        return directory_ / std::format("{:016x}.progbin", key);
+    }
+
+    std::filesystem::path directory_{ std::filesystem::current_path() / "program_cache" };
+    bool enabled_{ true };
+    // 0 not asked yet, 1 binaries supported, -1 not
+    int supported_{ 0 };
+    std::string driver_;
+    statistics stats_{};
+};
@@ -0,0 +1,330 @@
+#pragma once
+#include <span>
+#include <array>
+#include <format>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+#include <string_view>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "hash.hpp"
+#include "mesh.hpp"
+#include "mesh_batch.hpp"
+#include "frame_uniforms.hpp"
+#include "shader.hpp"
+
+// textures bound to fixed units, the samplers of the programs have to point at these units already
+struct render_material
+{
+    struct texture
+    {
+        GLuint unit;
+        GLenum target;
+        GLuint id;
+    };
+    std::vector<texture> textures;
+};
+
+struct draw_options
+{
+    // sorted first, lower layers draw earlier
+    std::uint8_t layer = 0;
+    bool cull = false;
+    // per draw uniforms besides the transform, runs after the transform is set
+    void (*prepare)(const Shader&) = nullptr;
+};
+
+// Deferred draws, sorted to change as little GL state as possible.
+// Between begin() and flush() a pass submits its draws in any order, flush() sorts them by a 64 bit key and issues them:
+//
+//   bits 63-60  layer          explicit order, e.g. opaque before debug lines
+//   bits 59-48  program        draws of one program stay together
+//   bit  47     culling        back face culling on or off
+//   bits 46-31  material       hash of the bound textures
+//   bits 30-16  vertex array
+//   bits 15-0   depth          front to back from the eye given to begin()
+//
+// every draw gets the uniform "model" set to its transform, or the Object block for programs declaring it
+// (frame_uniforms::set_object). uniforms that are the same for all draws of a program (lights...) are set before
+// flush() as before, the camera comes from the Frame block or from uniforms of the program. texture units the materials do not use keep
+// whatever the caller bound to them, shadow maps for example.
+// Like the rest of the GL side it is only used from the context thread.
+class render_queue
+{
+public:
+    using material = render_material;
+    using options = draw_options;
+
+    // GL work of one flush, or what the same draws would have needed in submission order
+    struct statistics
+    {
+        std::size_t draws;
+        std::size_t program_changes;
+        std::size_t material_changes;
+        std::size_t vertex_array_changes;
+        std::size_t state_changes;
+
+        [[nodiscard]] auto changes() const -> std::size_t
+        {
+            return program_changes + material_changes + vertex_array_changes + state_changes;
+        }
+    };
+
+    // starts a pass, depth is measured from eye and quantized over [0, far_plane]
+    void begin(const glm::vec3& eye, float far_plane)
+    {
+        items_.clear();
+        lods_.clear();
+        eye_ = eye;
+        far_plane_ = far_plane;
+    }
+
+    // one level of detail of mesh, with its own textures
+    void submit(const Shader& shader, const Mesh& mesh, std::size_t lod, const glm::mat4& transform, options opts = {})
+    {
+        const auto& level = mesh.lods[std::min(lod, mesh.lods.size() - 1)];
+        auto material = fnv_offset_basis;
+        for (const auto& texture : mesh.textures)
+            material = fnv1a(texture.id, material);
+        push({ 0, &shader, &mesh, nullptr, nullptr, mesh.textures.empty() ? 0 : material, mesh.VAO, GL_TRIANGLES,
+               static_cast<GLenum>(mesh.indexType), mesh.indexByteOffset(lod), static_cast<GLsizei>(level.indexCount),
+               transform, opts },
+             glm::vec3{ transform * glm::vec4{ mesh.boundsCenter, 1.0f } });
+    }
+
+    // glDrawArrays(mode, first, count) with vertex_array, mat may be null. the depth is taken at the origin of transform
+    void submit(const Shader& shader, const material* mat, GLuint vertex_array, GLenum mode, GLint first, GLsizei count,
+                const glm::mat4& transform, options opts = {})
+    {
+        auto id = std::uint64_t{ 0 };
+        if (mat && !mat->textures.empty())
+        {
+            id = fnv_offset_basis;
+            for (const auto& texture : mat->textures)
+                id = fnv1a(texture, id);
+        }
+        push({ 0, &shader, nullptr, mat, nullptr, id, vertex_array, mode, 0, static_cast<std::size_t>(first), count, transform, opts },
+             glm::vec3{ transform[3] });
+    }
+
+    // every mesh of batch with one multi draw, at the levels lods (copied) or level 0 when empty. binds no textures
+    void submit(const Shader& shader, const mesh_batch& batch, std::span<const std::size_t> lods, const glm::mat4& transform,
+                options opts = {})
+    {
+        const auto first = lods_.size();
+        lods_.insert(lods_.end(), lods.begin(), lods.end());
+        push({ 0, &shader, nullptr, nullptr, &batch, 0, batch.vertex_array(), GL_TRIANGLES, batch.index_type(), first,
+               static_cast<GLsizei>(lods.size()), transform, opts },
+             glm::vec3{ transform * glm::vec4{ batch.bounds_center(), 1.0f } });
+    }
+
+    [[nodiscard]] auto size() const -> std::size_t { return items_.size(); }
+
+    // sorts and draws everything submitted since begin(). unit 0 is active afterwards, like after Mesh::Draw
+    void flush()
+    {
+        sort();
+        unsorted_ = replay(items_);
+
+        statistics stats{};
+        const item* last = nullptr;
+        for (const auto& entry : entries_)
+        {
+            const auto& current = items_[entry.index];
+            const auto changes = compare(last, current);
+            if (changes.program)
+                current.shader->use();
+            if (changes.material)
+                bind_material(current);
+            if (changes.vertex_array)
+                glBindVertexArray(current.vertex_array);
+            if (changes.state)
+                current.opts.cull ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
+            count(stats, changes);
+
+            if (current.shader->usesObjectBlock())
+                frame_uniforms::shared().set_object(current.transform);
+            else
+                current.shader->set("model", current.transform);
+            if (current.opts.prepare)
+                current.opts.prepare(*current.shader);
+            if (current.batch)
+                current.batch->draw_elements(std::span{ lods_ }.subspan(current.first, static_cast<std::size_t>(current.count)));
+            else if (current.index_type)
+                glDrawElements(current.mode, current.count, current.index_type, reinterpret_cast<const void*>(current.first));
+            else
+                glDrawArrays(current.mode, static_cast<GLint>(current.first), current.count);
+            last = &current;
+        }
+        glActiveTexture(GL_TEXTURE0);
+
+        sorted_ = stats;
+        add(total_sorted_, sorted_);
+        add(total_unsorted_, unsorted_);
+        ++flushes_;
+        items_.clear();
+        lods_.clear();
+    }
+
+    // the last flush, as issued and as it would have been in submission order
+    [[nodiscard]] auto last_sorted() const -> statistics { return sorted_; }
+    [[nodiscard]] auto last_unsorted() const -> statistics { return unsorted_; }
+
+    void report(std::string_view name) const
+    {
+        const auto flushes = static_cast<double>(std::max<std::size_t>(flushes_, 1));
+        auto line = [&](std::string_view order, const statistics& s) {
+            std::cout << std::format("  {:<18}{:>10.1f}{:>10.1f}{:>10.1f}{:>10.1f}{:>10.1f}\n", order, s.draws / flushes,
+                                     s.program_changes / flushes, s.material_changes / flushes,
+                                     s.vertex_array_changes / flushes, s.state_changes / flushes);
+        };
+        std::cout << std::format("render queue {}: {} flushes, per flush\n", name, flushes_);
+        std::cout << std::format("  {:<18}{:>10}{:>10}{:>10}{:>10}{:>10}\n", "order", "draws", "programs", "materials", "vaos", "states");
+        line("submission", total_unsorted_);
+        line("sorted", total_sorted_);
+    }
+
+private:
+    struct item
+    {
+        std::uint64_t key;
+        const Shader* shader;
+        const Mesh* mesh;
+        const material* mat;
+        const mesh_batch* batch;
+        std::uint64_t material_id;
+        GLuint vertex_array;
+        GLenum mode;
+        // 0 for glDrawArrays
+        GLenum index_type;
+        // first vertex, or byte offset of the first index, or for batches the levels lods_[first, first + count)
+        std::size_t first;
+        GLsizei count;
+        glm::mat4 transform;
+        options opts;
+    };
+
+    struct sort_entry
+    {
+        std::uint64_t key;
+        std::uint32_t index;
+    };
+
+    struct change_set
+    {
+        bool program, material, vertex_array, state;
+    };
+
+    void push(item it, const glm::vec3& center)
+    {
+        const auto depth = std::clamp(glm::length(center - eye_) / far_plane_, 0.0f, 1.0f);
+        it.key = (std::uint64_t{ it.opts.layer } & 0xf) << 60
+               | (std::uint64_t{ it.shader->prog_id() } & 0xfff) << 48
+               | std::uint64_t{ it.opts.cull } << 47
+               | (it.material_id & 0xffff) << 31
+               | (std::uint64_t{ it.vertex_array } & 0x7fff) << 16
+               | static_cast<std::uint64_t>(depth * 65535.0f);
+        items_.push_back(it);
+    }
+
+    // what has to be rebound going from last to current. samplers of mesh textures are set per program,
+    // so a program change rebinds the material too
+    static auto compare(const item* last, const item& current) -> change_set
+    {
+        if (!last)
+            return { true, current.material_id != 0, true, true };
+        const bool program = last->shader->prog_id() != current.shader->prog_id();
+        return { program, current.material_id != 0 && (program || last->material_id != current.material_id),
+                 last->vertex_array != current.vertex_array, last->opts.cull != current.opts.cull };
+    }
+
+    static void count(statistics& stats, const change_set& changes)
+    {
+        ++stats.draws;
+        stats.program_changes += changes.program;
+        stats.material_changes += changes.material;
+        stats.vertex_array_changes += changes.vertex_array;
+        stats.state_changes += changes.state;
+    }
+
+    static void add(statistics& total, const statistics& s)
+    {
+        total.draws += s.draws;
+        total.program_changes += s.program_changes;
+        total.material_changes += s.material_changes;
+        total.vertex_array_changes += s.vertex_array_changes;
+        total.state_changes += s.state_changes;
+    }
+
+    static auto replay(const std::vector<item>& items) -> statistics
+    {
+        statistics stats{};
+        const item* last = nullptr;
+        for (const auto& current : items)
+        {
+            count(stats, compare(last, current));
+            last = &current;
+        }
+        return stats;
+    }
+
+    static void bind_material(const item& it)
+    {
+        if (it.mesh)
+        {
+            it.mesh->BindTextures(*it.shader);
+            return;
+        }
+        for (const auto& texture : it.mat->textures)
+        {
+            glActiveTexture(GL_TEXTURE0 + texture.unit);
+            glBindTexture(texture.target, texture.id);
+        }
+    }
+
+    // least significant digit first radix sort of the keys, 8 bits per pass.
+    // passes whose digit is the same for every key are skipped, typically most of the high ones
+    void sort()
+    {
+        entries_.resize(items_.size());
+        scratch_.resize(items_.size());
+        std::array<std::array<std::uint32_t, 256>, 8> histograms{};
+        for (std::uint32_t i = 0; i < items_.size(); i++)
+        {
+            const auto key = items_[i].key;
+            entries_[i] = { key, i };
+            for (std::size_t pass = 0; pass < 8; pass++)
+                ++histograms[pass][(key >> (pass * 8)) & 0xff];
+        }
+        for (std::size_t pass = 0; pass < 8; pass++)
+        {
+            auto& histogram = histograms[pass];
+            const auto shift = pass * 8;
+            if (items_.empty() || histogram[(entries_[0].key >> shift) & 0xff] == items_.size())
+                continue;
+            std::uint32_t offset = 0;
+            for (auto& bucket : histogram)
+                offset += std::exchange(bucket, offset);
+            for (const auto& entry : entries_)
+                scratch_[histogram[(entry.key >> shift) & 0xff]++] = entry;
+            entries_.swap(scratch_);
+        }
+    }
+
+    std::vector<item> items_;
+    std::vector<std::size_t> lods_;
+    std::vector<sort_entry> entries_;
+    std::vector<sort_entry> scratch_;
+    glm::vec3 eye_{ 0.0f };
+    float far_plane_{ 100.0f };
+    statistics sorted_{};
+    statistics unsorted_{};
+    statistics total_sorted_{};
+    statistics total_unsorted_{};
+    std::size_t flushes_{ 0 };
+};
@@ -1,17 +1,31 @@
 #pragma once
 #include <cassert>
-#include <concepts>
+#include <span>
 #include <iostream>
 #include <format>
-#include <fstream>
-#include <sstream>
+#include <array>
+#include <chrono>
+#include <string>
+#include <optional>
+#include <utility>
+#include <vector>
 #include <filesystem>
+#include <string_view>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include <glm/gtc/type_ptr.hpp>
 
+#include "hash.hpp"
+#include "gl_state.hpp"
+#include "gl_handle.hpp"
+#include "program_cache.hpp"
+#include "parallel_compile.hpp"
+#include "shader_parameters.hpp"
+#include "shader_preprocessor.hpp"
+#include "uniform_blocks.hpp"
+
 template <int I = 0>
 struct shader_entity
 {
@@ -21,22 +35,99 @@ struct shader_entity
     static constexpr auto type = I;
 };
 
+// shader stage given by its source text, e.g. read ahead of time by load_shader_async
+template <int I = 0>
+struct shader_source
+{
+    std::string source;
+    static constexpr auto type = I;
+};
+
+// the stage arguments Shader takes, shader_entity<TYPE> and shader_source<TYPE>
+template <typename T>
+inline constexpr bool is_shader_stage_argument = false;
+template <int I>
+inline constexpr bool is_shader_stage_argument<shader_entity<I>> = true;
+template <int I>
+inline constexpr bool is_shader_stage_argument<shader_source<I>> = true;
+
+// uniform name and its hash, the key of the parameter table of Shader.
+// string literals are hashed at compile time, other strings when they are passed
+struct uniform_name
+{
+    std::string_view name;
+    std::uint64_t hash;
+
+    template <std::size_t N>
+    consteval uniform_name(const char (&literal)[N])
+        : name{ literal, N - 1 }, hash{ fnv1a(name) }
+    {
+    }
+
+    constexpr uniform_name(std::string_view text)
+        : name{ text }, hash{ fnv1a(text) }
+    {
+    }
+
+    uniform_name(const std::string& text)
+        : uniform_name{ std::string_view{ text } }
+    {
+    }
+};
+
 class Shader
 {
 public:
+    // files are run through shader_preprocessor, #include resolves relative to them. sources go to GL as they are
     template<typename ... entity_types>
-    requires requires { (std::convertible_to<entity_types, shader_entity<>>,...); }
+    requires (sizeof...(entity_types) > 0 && (is_shader_stage_argument<std::remove_cvref_t<entity_types>> && ...))
     constexpr Shader(entity_types&&... shaders)
     {
-        id_ = createProgramWithShaders(loadShader(std::forward<entity_types>(shaders))...);
+        const std::array stages{ readStage(std::forward<entity_types>(shaders))... };
+        program_ = gl_program{ createProgram(stages) };
+    }
+    // stages put together elsewhere, e.g. the variants of shader_variants
+    explicit Shader(std::span<const shader_stage> stages)
+    {
+        program_ = gl_program{ createProgram(stages) };
+    }
+    // the program is owned and deleted with the Shader, so a Shader moves but does not copy
+    Shader(const Shader&) = delete;
+    // a moved optional stays engaged, the pending stages are taken so only the new owner checks or deletes them
+    Shader(Shader&& other) noexcept
+        : program_{ std::move(other.program_) }, pending_{ std::exchange(other.pending_, std::nullopt) }, object_block_{ other.object_block_ },
+          parameters_{ std::move(other.parameters_) }, declared_{ std::move(other.declared_) }
+    {
+    }
+    Shader& operator=(const Shader&) = delete;
+    Shader& operator=(Shader&& other) noexcept
+    {
+        if (this != &other)
+        {
+            dropPending();
+            program_ = std::move(other.program_);
+            pending_ = std::exchange(other.pending_, std::nullopt);
+            object_block_ = other.object_block_;
+            parameters_ = std::move(other.parameters_);
+            declared_ = std::move(other.declared_);
+        }
+        return *this;
+    }
+    ~Shader()
+    {
+        dropPending();
     }
-    ~Shader() = default;
 
-    constexpr void use() const
+    // binds the program and uploads the parameters written since. the program filter of gl_state, installed with
+    // the first program, drops the bind when the program is current already
+    void use() const
     {
-        if (id_)
+        finish();
+        if (program_)
         {
-            glUseProgram(id_);
+            glUseProgram(program_);
+            if (parameters_.pending())
+                parameters_.upload();
         }
         else
         {
@@ -44,61 +135,99 @@ public:
         }
     }
 
-    [[nodiscard]] constexpr auto prog_id() const { return id_; }
+    [[nodiscard]] auto prog_id() const
+    {
+        finish();
+        return program_.id();
+    }
+
+    // whether a program submitted by parallel_compile is linked, the first use waits for it otherwise.
+    // true for programs built right away and when the driver cannot tell
+    [[nodiscard]] bool ready() const { return !pending_ || parallel_compile::shared().done(program_); }
+
+    // whether the program declares the Object block, it then takes its model matrix from there
+    [[nodiscard]] bool usesObjectBlock() const
+    {
+        finish();
+        return object_block_;
+    }
+
+    // location of a uniform in this program, -1 (reported once) if the program has no such uniform
+    [[nodiscard]] GLint uniformLocation(uniform_name name) const
+    {
+        finish();
+        const auto index = parameters_.find(name.hash, name.name);
+        return index == shader_parameters::npos ? -1 : parameters_.uniforms()[index].location;
+    }
+
+    // handle of a uniform to write() by, taken once while loading. Unknown names and a T the uniform cannot be set
+    // from are reported here and give an invalid handle
+    template <uniform_value T>
+    [[nodiscard]] auto parameter(uniform_name name) const -> shader_parameter<T>
+    {
+        finish();
+        const auto index = parameters_.find(name.hash, name.name);
+        if (index == shader_parameters::npos || !parameters_.accepts<T>(index))
+            return {};
+        return { index };
+    }
+
+    // stores the value of a uniform, the next use() or set() uploads it with the others written since
+    template <uniform_value T>
+    void write(shader_parameter<T> parameter, const T& value) const
+    {
+        if (parameter.valid())
+            parameters_.write(parameter.index, value);
+    }
 
-    template <typename T>
-    void set(const std::string& name, T&& value) const
+    // parameter() of a uniform the program may leave out, e.g. the material samplers Mesh looks for. Nothing is
+    // reported, the handle is invalid when there is no such uniform of a type T sets
+    template <uniform_value T>
+    [[nodiscard]] auto optionalParameter(uniform_name name) const -> shader_parameter<T>
+    {
+        finish();
+        const auto index = parameters_.index_of(name.hash);
+        if (index == shader_parameters::npos || !parameters_.takes<T>(index))
+            return {};
+        return { index };
+    }
+
+    // write() by name and upload right away
+    template <uniform_value T>
+    void set(uniform_name name, const T& value) const
     {
         use();
-        if constexpr (std::integral<std::remove_cvref_t<T>>)
-        {
-            glUniform1i(glGetUniformLocation(id_, name.data()), static_cast<int>(std::forward<T>(value)));
-        }
-        else if constexpr (std::is_same_v<std::remove_cvref_t<T>, float>)
-        {
-            glUniform1f(glGetUniformLocation(id_, name.data()), std::forward<T>(value));
-        }
-        else if constexpr (std::is_same_v<std::remove_cvref_t<T>, glm::vec2>)
-        {
-            glUniform2fv(glGetUniformLocation(id_, name.data()), 1, glm::value_ptr(std::forward<T>(value)));
-        }
-        else if constexpr (std::is_same_v<std::remove_cvref_t<T>, glm::vec3>)
-        {
-            glUniform3fv(glGetUniformLocation(id_, name.data()), 1, glm::value_ptr(std::forward<T>(value)));
-        }
-        else if constexpr (std::is_same_v<std::remove_cvref_t<T>, glm::vec4>)
-        {
-            glUniform4fv(glGetUniformLocation(id_, name.data()), 1, glm::value_ptr(std::forward<T>(value)));
-        }
-        else if constexpr (std::is_same_v<std::remove_cvref_t<T>, glm::mat2>)
-        {
-            glUniformMatrix2fv(glGetUniformLocation(id_, name.data()), 1, GL_FALSE, glm::value_ptr(std::forward<T>(value)));
-        }
-        else if constexpr (std::is_same_v<std::remove_cvref_t<T>, glm::mat3>)
-        {
-            glUniformMatrix3fv(glGetUniformLocation(id_, name.data()), 1, GL_FALSE, glm::value_ptr(std::forward<T>(value)));
-        }
-        else if constexpr (std::is_same_v<std::remove_cvref_t<T>, glm::mat4>)
-        {
-            glUniformMatrix4fv(glGetUniformLocation(id_, name.data()), 1, GL_FALSE, glm::value_ptr(std::forward<T>(value)));
-        }
-        else
-        {
-            assert(false);
-        }
+        if (const auto index = parameters_.find(name.hash, name.name); index != shader_parameters::npos && parameters_.accepts<T>(index))
+            parameters_.write(index, value);
+        parameters_.upload();
     }
 
-    constexpr operator GLuint() const
+    // the reflected uniforms and blocks of the program
+    [[nodiscard]] auto parameters() const -> const shader_parameters&
+    {
+        finish();
+        return parameters_;
+    }
+
+    operator GLuint() const
     {
         return prog_id();
     }
 
 
 private:
-    auto loadShader(GLenum shader_type, const char* shader_src) const
+    // stages and cache key of a program submitted by parallel_compile, checked by finish()
+    struct pending_link
+    {
+        std::vector<GLuint> shaders;
+        std::uint64_t key;
+        double submit_ms;
+    };
+
+    // compiles without asking how it went
+    static auto submitShader(GLenum shader_type, const char* shader_src)
 	-> GLuint
     {
-        (void)this;
         const auto shader = glCreateShader(shader_type);
         if (shader == 0)
         {
@@ -106,52 +235,157 @@ private:
         }
         glShaderSource(shader, 1, &shader_src, nullptr);
         glCompileShader(shader);
+        return shader;
+    }
 
-        assert(checkCompileErrors(shader));
+    auto loadShader(GLenum shader_type, const char* shader_src) const
+	-> GLuint
+    {
+        const auto shader = submitShader(shader_type, shader_src);
+        checkCompileErrors(shader);
         return shader;
     }
 
+    // links the compiled shaders without asking how it went
+    static auto submitProgram(const std::vector<GLuint>& shaders)
+	-> GLuint
+    {
+        // create program
+        const auto program = glCreateProgram();
+        // attach shader
+        for (const auto shader : shaders)
+            glAttachShader(program, shader);
+        if (program_cache::shared().enabled())
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        // link
+        glLinkProgram(program);
+        return program;
+    }
+
     template<GLint I>
-    auto loadShader(const shader_entity<I>& shader) const
-        -> GLuint
+    static auto readStage(const shader_entity<I>& shader)
+        -> shader_stage
     {
-        std::string file_content;
-        std::ifstream shader_stream{ shader.path };
-        if (not shader_stream)
-        {
-            throw std::ios_base::failure("file does not exist");
-        }
-        try
+        return { static_cast<GLenum>(shader.type), shader_preprocessor::run(read_shader_file(shader.path), shader.path.parent_path()) };
+    }
+
+    template<GLint I>
+    static auto readStage(shader_source<I> shader)
+        -> shader_stage
+    {
+        return { static_cast<GLenum>(shader.type), std::move(shader.source) };
+    }
+
+    // the program of all stages, loaded from its cached binary when program_cache has one. With parallel_compile
+    // enabled a program that has to be compiled is only submitted, finish() checks it
+    auto createProgram(std::span<const shader_stage> stages)
+	-> GLuint
+    {
+        gl_state::shared().install_program_filter();
+        for (const auto& stage : stages)
         {
-            std::stringstream _ss;
-            shader_stream >> _ss.rdbuf();
-            file_content = _ss.str();
+            auto names = shader_preprocessor::declared_uniforms(stage.source);
+            declared_.insert(declared_.end(), std::make_move_iterator(names.begin()), std::make_move_iterator(names.end()));
         }
-        catch (std::ifstream::failure&)
+        auto& cache = program_cache::shared();
+        if (parallel_compile::shared().enabled())
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ\n";
+            const auto start = std::chrono::steady_clock::now();
+            const auto key = cache.enabled() ? cache.key(stages) : 0;
+            if (key)
+            {
+                if (const auto program = cache.load(key))
+                {
+                    bindUniformBlocks(program);
+                    return program;
+                }
+            }
+            pending_link link{ {}, key, 0.0 };
+            link.shaders.reserve(stages.size());
+            for (const auto& stage : stages)
+                link.shaders.push_back(submitShader(stage.type, stage.source.c_str()));
+            const auto program = submitProgram(link.shaders);
+            link.submit_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            pending_ = std::move(link);
+            parallel_compile::shared().submitted();
+            return program;
         }
-        return loadShader(shader.type, file_content.c_str());
+        const auto shader_program = cache.build(stages, [&] {
+            std::vector<GLuint> shaders;
+            shaders.reserve(stages.size());
+            for (const auto& stage : stages)
+                shaders.push_back(loadShader(stage.type, stage.source.c_str()));
+            const auto program = submitProgram(shaders);
+            // check linking result, a program that failed is still returned for the handle to delete
+            checkCompileErrors(program, "PROGRAM");
+            for (const auto shader : shaders)
+                glDeleteShader(shader);
+            return program;
+        });
+        bindUniformBlocks(shader_program);
+        return shader_program;
     }
 
-    template<typename... Shaders>
-        requires (std::same_as<std::invoke_result_t<decltype(glCreateShader), GLenum>, Shaders>&&...)
-    auto createProgramWithShaders(Shaders ... shaders)
-	-> GLuint
+    // checks a submitted program, waiting for the driver if it is not done yet
+    void finish() const
     {
-        (void)this;
-        // create program
-        auto shader_program = glCreateProgram();
-        // attach shader
-        (glAttachShader(shader_program, shaders), ...);
-        // link
-        glLinkProgram(shader_program);
-        // check linking result
-        assert(checkCompileErrors(shader_program, "PROGRAM"));
-        (glDeleteShader(shaders), ...);
-        return shader_program;
+        if (!pending_)
+            return;
+        const auto link = *std::exchange(pending_, std::nullopt);
+        auto& compile = parallel_compile::shared();
+        const auto was_ready = compile.done(program_);
+        const auto start = std::chrono::steady_clock::now();
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program_, GL_LINK_STATUS, &linked);
+        const auto wait_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        compile.finished(was_ready, wait_ms);
+
+        for (const auto shader : link.shaders)
+            checkCompileErrors(shader);
+        // check linking result, a program that failed stays with the handle and is not cached
+        checkCompileErrors(program_, "PROGRAM");
+        for (const auto shader : link.shaders)
+            glDeleteShader(shader);
+        auto& cache = program_cache::shared();
+        cache.compiled(link.submit_ms + wait_ms);
+        if (link.key && linked)
+            cache.store(link.key, program_);
+        bindUniformBlocks(program_);
+    }
+
+    // deletes the shaders of a program that was never checked
+    void dropPending()
+    {
+        if (!pending_)
+            return;
+        for (const auto shader : pending_->shaders)
+            glDeleteShader(shader);
+        pending_.reset();
     }
 
+    // reflects the linked program into the parameter table, checks it against the declared uniforms and points the
+    // shared blocks of uniform_blocks.hpp it declares at their binding points, a block declared with another size
+    // than its struct is reported
+    void bindUniformBlocks(GLuint program) const
+    {
+        parameters_.reflect(program);
+        parameters_.check(declared_);
+        declared_ = {};
+        auto bind = [&](const char* name, GLuint binding, std::size_t size) {
+            const auto* block = parameters_.find_block(name);
+            if (!block)
+                return false;
+            if (static_cast<std::size_t>(block->data_size) != size)
+                std::cout << std::format("program {}: block {} has {} bytes, uniform_blocks.hpp uploads {}\n", program, name,
+                                         block->data_size, size);
+            glUniformBlockBinding(program, block->index, binding);
+            return true;
+        };
+        bind(frame_block::name, frame_block::binding, sizeof(frame_block));
+        object_block_ = bind(object_block::name, object_block::binding, sizeof(object_block));
+    }
+
+    // reports what failed to compile or link, deleting nothing: the caller deletes the shaders and gl_program the program
     bool checkCompileErrors(GLuint shader, std::string_view type_hint = "SHADER") const
     {
         (void)this;
@@ -170,7 +404,6 @@ private:
 			        glGetShaderInfoLog(shader, info_len, nullptr, info_log.data());
 			        std::cout << std::format("Failed to compile shader, reason: {}", info_log);
 		        }
-                glDeleteShader(shader);
                 return false;
 	        }
         }
@@ -190,7 +423,6 @@ private:
                     glGetProgramInfoLog(shader, info_len, nullptr, info_log.data());
                     std::cout << std::format("Failed to link shader, reason:\n{}", info_log);
                 }
-                glDeleteProgram(shader);
                 return false;
             }
         }
@@ -198,5 +430,12 @@ private:
     }
 
 private:
-    GLuint id_{0u};
+    gl_program program_;
+    // set while a submitted program is unchecked, its first use finishes it
+    mutable std::optional<pending_link> pending_;
+    mutable bool object_block_{ false };
+    // reflected uniforms with their staged values, filled when the program is linked or loaded
+    mutable shader_parameters parameters_;
+    // uniforms the stages declare, until the table is checked against them
+    mutable std::vector<std::string> declared_;
 };
\ No newline at end of file
@@ -0,0 +1,427 @@
+#pragma once
+#include <array>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <format>
+#include <span>
+#include <concepts>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "hash.hpp"
+
+// the value types a uniform can be set from
+template <typename T>
+concept uniform_value = std::integral<T> || std::same_as<T, float> || std::same_as<T, glm::vec2> || std::same_as<T, glm::vec3> ||
+                        std::same_as<T, glm::vec4> || std::same_as<T, glm::mat2> || std::same_as<T, glm::mat3> ||
+                        std::same_as<T, glm::mat4>;
+
+// handle of a uniform in the parameter table of one Shader, from Shader::parameter<T>(). It stays valid as long as the
+// Shader does, an invalid handle (unknown name or wrong type, reported when it was taken) makes writes do nothing
+template <uniform_value T>
+struct shader_parameter
+{
+    static constexpr std::uint32_t invalid = ~0u;
+
+    std::uint32_t index{ invalid };
+
+    [[nodiscard]] constexpr auto valid() const -> bool { return index != invalid; }
+};
+
+// The active uniforms and uniform blocks of a linked program, read once with glGetActiveUniform and
+// glGetActiveUniformBlockiv. Every uniform of the default block gets an entry with its GL type and location, array
+// elements one each ("shadowMatrices[2]") with the first also found under the plain name, as GL allows.
+// write() only stores a value in the table, upload() sends the entries written since the last upload with one
+// glUniform* each and leaves out values GL already has. check() reports the uniforms the sources declare but the
+// program dropped once it is linked, find() and accepts() the names and value types callers get wrong when they
+// first ask, each once, where glUniform* used to drop them silently.
+class shader_parameters
+{
+public:
+    static constexpr std::uint32_t npos = ~0u;
+
+    enum class kind : std::uint8_t
+    {
+        int1,
+        uint1,
+        float1,
+        vec2,
+        vec3,
+        vec4,
+        mat2,
+        mat3,
+        mat4,
+        unsupported, // vectors of ints, doubles, ..., nothing the demos set
+    };
+
+    struct uniform
+    {
+        std::string name;
+        GLenum type;
+        GLint location;
+        std::uint32_t offset; // of the value in the table
+        kind value_kind;
+        bool dirty;
+        bool uploaded;
+        bool mismatch_reported;
+    };
+
+    struct block
+    {
+        std::string name;
+        GLuint index;
+        GLint data_size;
+        GLint members;
+    };
+
+    struct statistics
+    {
+        std::size_t writes;
+        std::size_t uploads;
+        std::size_t unchanged; // writes of the value GL already had
+    };
+
+    void reflect(GLuint program)
+    {
+        program_ = program;
+        uniforms_.clear();
+        blocks_.clear();
+        lookup_.clear();
+        block_members_.clear();
+        reported_.clear();
+        dirty_.clear();
+        values_.clear();
+
+        GLint count = 0, max_length = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length);
+        std::string name(static_cast<std::size_t>(std::max(max_length, 1)), '\0');
+        for (GLuint index = 0; index < static_cast<GLuint>(count); index++)
+        {
+            GLsizei length = 0;
+            glGetActiveUniformBlockName(program, index, max_length, &length, name.data());
+            block b{ name.substr(0, static_cast<std::size_t>(length)), index, 0, 0 };
+            glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &b.data_size);
+            glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &b.members);
+            blocks_.push_back(std::move(b));
+        }
+
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+        name.assign(static_cast<std::size_t>(std::max(max_length, 1)), '\0');
+        for (GLuint index = 0; index < static_cast<GLuint>(count); index++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program, index, max_length, &length, &size, &type, name.data());
+            std::string uniform_name = name.substr(0, static_cast<std::size_t>(length));
+
+            GLint block_index = -1;
+            glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &block_index);
+            if (block_index >= 0)
+            {
+                block_members_.emplace(fnv1a(uniform_name), static_cast<std::uint32_t>(block_index));
+                continue;
+            }
+
+            // arrays are reported as name[0] with their size, each element has a location of its own
+            if (size > 1 || uniform_name.ends_with("[0]"))
+            {
+                const auto base = uniform_name.ends_with("[0]") ? uniform_name.substr(0, uniform_name.size() - 3) : uniform_name;
+                for (GLint element = 0; element < size; element++)
+                {
+                    const auto element_name = std::format("{}[{}]", base, element);
+                    add(element_name, type, glGetUniformLocation(program, element_name.c_str()));
+                }
+                lookup_.emplace(fnv1a(base), static_cast<std::uint32_t>(uniforms_.size() - static_cast<std::size_t>(size)));
+                continue;
+            }
+            const auto location = glGetUniformLocation(program, uniform_name.c_str());
+            add(std::move(uniform_name), type, location);
+        }
+    }
+
+    // reports once after linking what the table cannot take: uniforms the sources declare (see
+    // shader_preprocessor::declared_uniforms) that are not active, and active ones of a type no value can be set from.
+    // Setting a dropped uniform later is not reported again
+    void check(std::span<const std::string> declared)
+    {
+        for (const auto& name : declared)
+        {
+            const auto hash = fnv1a(name);
+            if (lookup_.contains(hash) || block_members_.contains(hash) || !reported_.insert(hash).second)
+                continue;
+            std::cout << std::format("program {}: uniform {} is declared but not active, unused or optimized out\n", program_, name);
+        }
+        for (auto& u : uniforms_)
+        {
+            if (u.value_kind != kind::unsupported || u.mismatch_reported)
+                continue;
+            u.mismatch_reported = true;
+            std::cout << std::format("program {}: uniform {} is {}, which cannot be set\n", program_, u.name, type_name(u.type));
+        }
+    }
+
+    // entry of an active uniform, npos if there is none. Nothing is reported, for uniforms a program may leave out
+    [[nodiscard]] auto index_of(std::uint64_t hash) const -> std::uint32_t
+    {
+        const auto it = lookup_.find(hash);
+        return it == lookup_.end() ? npos : it->second;
+    }
+
+    // entry of an active uniform, npos after reporting names the program has no such uniform for
+    [[nodiscard]] auto find(std::uint64_t hash, std::string_view name) -> std::uint32_t
+    {
+        if (const auto index = index_of(hash); index != npos)
+            return index;
+        if (reported_.insert(hash).second)
+        {
+            if (const auto member = block_members_.find(hash); member != block_members_.end())
+                std::cout << std::format("program {}: {} is in uniform block {}, set it through the block\n", program_, name,
+                                         blocks_[member->second].name);
+            else
+                std::cout << std::format("program {}: no active uniform {}, misspelt or optimized out\n", program_, name);
+        }
+        return npos;
+    }
+
+    // whether values of T can be written to the entry
+    template <uniform_value T>
+    [[nodiscard]] auto takes(std::uint32_t index) const -> bool
+    {
+        const auto k = uniforms_[index].value_kind;
+        return std::integral<T> ? k == kind::int1 || k == kind::uint1 : k == kind_of<T>();
+    }
+
+    // takes<T>(index), reporting the first mismatch of an entry
+    template <uniform_value T>
+    [[nodiscard]] auto accepts(std::uint32_t index) -> bool
+    {
+        auto& u = uniforms_[index];
+        const bool match = takes<T>(index);
+        if (!match && !u.mismatch_reported)
+        {
+            u.mismatch_reported = true;
+            std::cout << std::format("program {}: uniform {} is {}, cannot be set from {}\n", program_, u.name, type_name(u.type),
+                                     kind_name(std::integral<T> ? kind::int1 : kind_of<T>()));
+        }
+        return match;
+    }
+
+    // stores value for the next upload(), after accepts<T>(index)
+    template <uniform_value T>
+    void write(std::uint32_t index, const T& value)
+    {
+        auto& u = uniforms_[index];
+        std::array<std::byte, sizeof(glm::mat4)> bytes;
+        std::size_t size = sizeof(T);
+        if constexpr (std::integral<T>)
+        {
+            size = sizeof(GLint);
+            const auto as_uint = static_cast<GLuint>(value);
+            const auto as_int = static_cast<GLint>(value);
+            std::memcpy(bytes.data(), u.value_kind == kind::uint1 ? static_cast<const void*>(&as_uint) : &as_int, size);
+        }
+        else
+            std::memcpy(bytes.data(), &value, size);
+
+        ++stats_.writes;
+        auto* stored = values_.data() + u.offset;
+        if (u.uploaded && !u.dirty && std::memcmp(stored, bytes.data(), size) == 0)
+        {
+            ++stats_.unchanged;
+            return;
+        }
+        std::memcpy(stored, bytes.data(), size);
+        if (!u.dirty)
+        {
+            u.dirty = true;
+            dirty_.push_back(index);
+        }
+    }
+
+    // sends the entries written since the last upload, the program has to be current
+    void upload()
+    {
+        for (const auto index : dirty_)
+        {
+            auto& u = uniforms_[index];
+            const auto* value = values_.data() + u.offset;
+            const auto* floats = reinterpret_cast<const GLfloat*>(value);
+            switch (u.value_kind)
+            {
+            case kind::int1: glUniform1iv(u.location, 1, reinterpret_cast<const GLint*>(value)); break;
+            case kind::uint1: glUniform1uiv(u.location, 1, reinterpret_cast<const GLuint*>(value)); break;
+            case kind::float1: glUniform1fv(u.location, 1, floats); break;
+            case kind::vec2: glUniform2fv(u.location, 1, floats); break;
+            case kind::vec3: glUniform3fv(u.location, 1, floats); break;
+            case kind::vec4: glUniform4fv(u.location, 1, floats); break;
+            case kind::mat2: glUniformMatrix2fv(u.location, 1, GL_FALSE, floats); break;
+            case kind::mat3: glUniformMatrix3fv(u.location, 1, GL_FALSE, floats); break;
+            case kind::mat4: glUniformMatrix4fv(u.location, 1, GL_FALSE, floats); break;
+            case kind::unsupported: break;
+            }
+            u.dirty = false;
+            u.uploaded = true;
+        }
+        stats_.uploads += dirty_.size();
+        dirty_.clear();
+    }
+
+    [[nodiscard]] auto pending() const -> bool { return !dirty_.empty(); }
+    [[nodiscard]] auto uniforms() const -> const std::vector<uniform>& { return uniforms_; }
+    [[nodiscard]] auto blocks() const -> const std::vector<block>& { return blocks_; }
+    [[nodiscard]] auto stats() const -> const statistics& { return stats_; }
+    void reset_stats() { stats_ = {}; }
+
+    // the block named name, nullptr if the program declares none
+    [[nodiscard]] auto find_block(std::string_view name) const -> const block*
+    {
+        for (const auto& b : blocks_)
+        {
+            if (b.name == name)
+                return &b;
+        }
+        return nullptr;
+    }
+
+    void report(std::string_view name) const
+    {
+        std::cout << std::format("program {} ({}): {} uniforms, {} blocks\n", name, program_, uniforms_.size(), blocks_.size());
+        for (const auto& u : uniforms_)
+            std::cout << std::format("  {:<32}{:<12}location {}\n", u.name, type_name(u.type), u.location);
+        for (const auto& b : blocks_)
+            std::cout << std::format("  block {:<26}{:>5} bytes, {} members\n", b.name, b.data_size, b.members);
+    }
+
+    [[nodiscard]] static auto type_name(GLenum type) -> std::string
+    {
+        switch (type)
+        {
+        case GL_BOOL: return "bool";
+        case GL_INT: return "int";
+        case GL_UNSIGNED_INT: return "uint";
+        case GL_FLOAT: return "float";
+        case GL_FLOAT_VEC2: return "vec2";
+        case GL_FLOAT_VEC3: return "vec3";
+        case GL_FLOAT_VEC4: return "vec4";
+        case GL_FLOAT_MAT2: return "mat2";
+        case GL_FLOAT_MAT3: return "mat3";
+        case GL_FLOAT_MAT4: return "mat4";
+        case GL_SAMPLER_2D: return "sampler2D";
+        case GL_SAMPLER_CUBE: return "samplerCube";
+        case GL_SAMPLER_2D_ARRAY: return "sampler2DArray";
+        case GL_SAMPLER_2D_SHADOW: return "sampler2DShadow";
+        default: return is_sampler(type) ? "sampler" : std::format("{:#06x}", type);
+        }
+    }
+
+private:
+    void add(std::string name, GLenum type, GLint location)
+    {
+        const auto index = static_cast<std::uint32_t>(uniforms_.size());
+        const auto value_kind = kind_of(type);
+        lookup_.emplace(fnv1a(name), index);
+        uniforms_.push_back({ std::move(name), type, location, static_cast<std::uint32_t>(values_.size()), value_kind, false, false, false });
+        values_.resize(values_.size() + kind_bytes(value_kind));
+    }
+
+    [[nodiscard]] static auto is_sampler(GLenum type) -> bool
+    {
+        switch (type)
+        {
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_2D_RECT: case GL_SAMPLER_2D_RECT_SHADOW:
+        case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_BUFFER: case GL_SAMPLER_1D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_ARRAY_SHADOW: case GL_SAMPLER_CUBE_SHADOW: case GL_SAMPLER_2D_MULTISAMPLE:
+        case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_INT_SAMPLER_1D: case GL_INT_SAMPLER_2D: case GL_INT_SAMPLER_3D: case GL_INT_SAMPLER_CUBE:
+        case GL_INT_SAMPLER_2D_RECT: case GL_INT_SAMPLER_1D_ARRAY: case GL_INT_SAMPLER_2D_ARRAY: case GL_INT_SAMPLER_BUFFER:
+        case GL_INT_SAMPLER_2D_MULTISAMPLE: case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_1D: case GL_UNSIGNED_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_3D:
+        case GL_UNSIGNED_INT_SAMPLER_CUBE: case GL_UNSIGNED_INT_SAMPLER_2D_RECT: case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+        case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY: case GL_UNSIGNED_INT_SAMPLER_BUFFER: case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+        case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // samplers and bools are set as ints
+    [[nodiscard]] static auto kind_of(GLenum type) -> kind
+    {
+        switch (type)
+        {
+        case GL_BOOL:
+        case GL_INT: return kind::int1;
+        case GL_UNSIGNED_INT: return kind::uint1;
+        case GL_FLOAT: return kind::float1;
+        case GL_FLOAT_VEC2: return kind::vec2;
+        case GL_FLOAT_VEC3: return kind::vec3;
+        case GL_FLOAT_VEC4: return kind::vec4;
+        case GL_FLOAT_MAT2: return kind::mat2;
+        case GL_FLOAT_MAT3: return kind::mat3;
+        case GL_FLOAT_MAT4: return kind::mat4;
+        default: return is_sampler(type) ? kind::int1 : kind::unsupported;
+        }
+    }
+
+    template <uniform_value T>
+    [[nodiscard]] static constexpr auto kind_of() -> kind
+    {
+        if constexpr (std::integral<T>)
+            return kind::int1;
+        else if constexpr (std::same_as<T, float>)
+            return kind::float1;
+        else if constexpr (std::same_as<T, glm::vec2>)
+            return kind::vec2;
+        else if constexpr (std::same_as<T, glm::vec3>)
+            return kind::vec3;
+        else if constexpr (std::same_as<T, glm::vec4>)
+            return kind::vec4;
+        else if constexpr (std::same_as<T, glm::mat2>)
+            return kind::mat2;
+        else if constexpr (std::same_as<T, glm::mat3>)
+            return kind::mat3;
+        else
+            return kind::mat4;
+    }
+
+    [[nodiscard]] static constexpr auto kind_bytes(kind k) -> std::size_t
+    {
+        constexpr std::array<std::size_t, 10> bytes{ 4, 4, 4, 8, 12, 16, 16, 36, 64, 0 };
+        return bytes[static_cast<std::size_t>(k)];
+    }
+
+    [[nodiscard]] static constexpr auto kind_name(kind k) -> std::string_view
+    {
+        constexpr std::array<std::string_view, 10> names{ "an integer", "an integer", "float", "vec2", "vec3", "vec4",
+                                                          "mat2",       "mat3",       "mat4",  "unsupported" };
+        return names[static_cast<std::size_t>(k)];
+    }
+
+    GLuint program_{ 0 };
+    std::vector<uniform> uniforms_;
+    std::vector<block> blocks_;
+    // the values of all entries back to back, kind_bytes each
+    std::vector<std::byte> values_;
+    std::vector<std::uint32_t> dirty_;
+    // name hash -> entry, 64 bit FNV-1a makes collisions between the names of one program negligible
+    std::unordered_map<std::uint64_t, std::uint32_t> lookup_;
+    // name hash -> block, for the uniforms a block holds
+    std::unordered_map<std::uint64_t, std::uint32_t> block_members_;
+    // names already reported missing
+    std::unordered_set<std::uint64_t> reported_;
+    statistics stats_{};
+};
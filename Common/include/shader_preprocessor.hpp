@@ -0,0 +1,339 @@
+#pragma once
+#include <span>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <format>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <iostream>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+// text of a shader file, throws std::ios_base::failure when there is no such file
+[[nodiscard]] inline auto read_shader_file(const std::filesystem::path& path) -> std::string
+{
+    std::ifstream shader_stream{ path };
+    if (not shader_stream)
+    {
+        throw std::ios_base::failure("file does not exist");
+    }
+    std::string file_content;
+    try
+    {
+        std::stringstream _ss;
+        shader_stream >> _ss.rdbuf();
+        file_content = _ss.str();
+    }
+    catch (std::ifstream::failure&)
+    {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ\n";
+    }
+    return file_content;
+}
+
+// The two directives GLSL lacks, resolved before the source goes to GL:
+//   #include "shadow.glsl"   replaced by the file, relative to the directory of the including file. A file is
+//                            included once per stage, the same include again is dropped
+//   defines                  "NAME" or "NAME VALUE", inserted as #define lines right after #version
+// Lines are kept as they are otherwise, so a source without includes and defines comes back unchanged. Compile
+// errors in an included file report lines counted in the expanded source.
+class shader_preprocessor
+{
+public:
+    [[nodiscard]] static auto run(std::string_view source, const std::filesystem::path& directory,
+                                  std::span<const std::string_view> defines = {}) -> std::string
+    {
+        shader_preprocessor preprocessor;
+        std::string result;
+        result.reserve(source.size());
+        preprocessor.expand(source, directory, result);
+        if (!defines.empty())
+            insert_defines(result, defines);
+        return result;
+    }
+
+    // The uniforms the live code of an expanded source declares outside of blocks, struct uniforms by their members
+    // ("light.ambient", "pointLights[1].position"), plain arrays by their name, as shader_parameters finds them.
+    // #ifdef and #ifndef are followed with the #defines of the source, code under #if and #elif is left out, as are
+    // struct arrays sized by anything but a number or a #define of one
+    [[nodiscard]] static auto declared_uniforms(std::string_view source) -> std::vector<std::string>
+    {
+        const auto code = live_code(source);
+        const auto tokens = tokenize(code);
+        std::unordered_map<std::string_view, std::vector<declaration>> structs;
+        std::vector<std::string> uniforms;
+        int depth = 0;
+        for (std::size_t i = 0; i < tokens.size(); i++)
+        {
+            const auto token = tokens[i];
+            if (token == "{")
+                ++depth;
+            else if (token == "}")
+                --depth;
+            else if (depth == 0 && token == "struct" && i + 2 < tokens.size() && tokens[i + 2] == "{")
+            {
+                auto& members = structs[tokens[i + 1]];
+                for (i += 3; i < tokens.size() && tokens[i] != "}";)
+                    read_declaration(tokens, i, members);
+            }
+            else if (depth == 0 && token == "uniform" && i + 2 < tokens.size() && tokens[i + 2] != "{")
+            {
+                std::vector<declaration> declared;
+                ++i;
+                read_declaration(tokens, i, declared);
+                --i;
+                for (const auto& d : declared)
+                    expand_uniform(structs, d, std::string{ d.name }, uniforms);
+            }
+        }
+        return uniforms;
+    }
+
+private:
+    // type, name and element count of a variable, count 0 for no array and -1 for a size that is not known
+    struct declaration
+    {
+        std::string_view type;
+        std::string_view name;
+        int count;
+    };
+
+    // the declarations of "type name[N], name;" starting at tokens[i], i ends past the ';'
+    static void read_declaration(const std::vector<std::string_view>& tokens, std::size_t& i, std::vector<declaration>& out)
+    {
+        static const std::unordered_set<std::string_view> qualifiers{ "lowp", "mediump", "highp", "const", "flat", "smooth" };
+        while (i < tokens.size() && qualifiers.contains(tokens[i]))
+            ++i;
+        if (i >= tokens.size())
+            return;
+        const auto type = tokens[i++];
+        while (i < tokens.size() && tokens[i] != ";" && tokens[i] != "}")
+        {
+            if (tokens[i] == ",")
+            {
+                ++i;
+                continue;
+            }
+            declaration d{ type, tokens[i++], 0 };
+            if (i < tokens.size() && tokens[i] == "[")
+            {
+                d.count = i + 2 < tokens.size() && tokens[i + 2] == "]" ? to_count(tokens[i + 1]) : -1;
+                while (i < tokens.size() && tokens[i] != "]")
+                    ++i;
+                ++i;
+            }
+            // initializers of const members and the like
+            while (i < tokens.size() && tokens[i] != "," && tokens[i] != ";" && tokens[i] != "}")
+                ++i;
+            out.push_back(d);
+        }
+        if (i < tokens.size() && tokens[i] == ";")
+            ++i;
+    }
+
+    static void expand_uniform(const std::unordered_map<std::string_view, std::vector<declaration>>& structs, const declaration& d,
+                               const std::string& name, std::vector<std::string>& out)
+    {
+        const auto members = structs.find(d.type);
+        if (members == structs.end())
+        {
+            out.push_back(name);
+            return;
+        }
+        auto expand_members = [&](const std::string& prefix) {
+            for (const auto& member : members->second)
+                expand_uniform(structs, member, prefix + '.' + std::string{ member.name }, out);
+        };
+        if (d.count == 0)
+            expand_members(name);
+        for (int element = 0; element < d.count; element++)
+            expand_members(std::format("{}[{}]", name, element));
+    }
+
+    static auto to_count(std::string_view token) -> int
+    {
+        int count = -1;
+        const auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), count);
+        return error == std::errc{} && end == token.data() + token.size() ? count : -1;
+    }
+
+    // identifiers and numbers as one token, any other character but blanks as one of its own
+    static auto tokenize(std::string_view code) -> std::vector<std::string_view>
+    {
+        std::vector<std::string_view> tokens;
+        auto word = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+        for (std::size_t i = 0; i < code.size();)
+        {
+            if (std::isspace(static_cast<unsigned char>(code[i])))
+            {
+                ++i;
+                continue;
+            }
+            auto end = i + 1;
+            if (word(code[i]))
+            {
+                while (end < code.size() && word(code[end]))
+                    ++end;
+            }
+            tokens.push_back(code.substr(i, end - i));
+            i = end;
+        }
+        return tokens;
+    }
+
+    // source without comments, directives and the code of #ifdef branches not taken. #defines of a number replace
+    // the name in the code, the array sizes they give are all declared_uniforms() needs
+    static auto live_code(std::string_view source) -> std::string
+    {
+        struct branch
+        {
+            bool parent_live;
+            bool taken;
+            bool known;
+        };
+        std::vector<branch> branches;
+        std::unordered_map<std::string, std::string> defines;
+        auto live = [&] { return branches.empty() || (branches.back().known && branches.back().parent_live && branches.back().taken); };
+
+        std::string code;
+        bool in_comment = false;
+        while (!source.empty())
+        {
+            const auto end = source.find('\n');
+            std::string line{ source.substr(0, end) };
+            source.remove_prefix(end == std::string_view::npos ? source.size() : end + 1);
+
+            // comments first, a directive can carry one
+            std::string stripped;
+            for (std::size_t i = 0; i < line.size(); i++)
+            {
+                if (in_comment)
+                {
+                    if (line.compare(i, 2, "*/") == 0)
+                    {
+                        in_comment = false;
+                        ++i;
+                    }
+                    continue;
+                }
+                if (line.compare(i, 2, "//") == 0)
+                    break;
+                if (line.compare(i, 2, "/*") == 0)
+                {
+                    in_comment = true;
+                    ++i;
+                    continue;
+                }
+                stripped += line[i];
+            }
+
+            const auto tokens = tokenize(stripped);
+            if (!tokens.empty() && tokens[0] == "#")
+            {
+                const auto directive = tokens.size() > 1 ? tokens[1] : std::string_view{};
+                const auto name = tokens.size() > 2 ? std::string{ tokens[2] } : std::string{};
+                if (directive == "ifdef" || directive == "ifndef")
+                {
+                    const auto defined = defines.contains(name);
+                    branches.push_back({ live(), directive == "ifdef" ? defined : !defined, true });
+                }
+                else if (directive == "if")
+                    branches.push_back({ live(), false, false });
+                else if (directive == "elif" && !branches.empty())
+                    branches.back().known = false;
+                else if (directive == "else" && !branches.empty())
+                    branches.back().taken = !branches.back().taken;
+                else if (directive == "endif" && !branches.empty())
+                    branches.pop_back();
+                else if (directive == "define" && live() && !name.empty())
+                    defines[name] = tokens.size() > 3 ? std::string{ tokens[3] } : std::string{};
+                else if (directive == "undef" && live())
+                    defines.erase(name);
+                continue;
+            }
+            if (!live())
+                continue;
+            for (const auto token : tokens)
+            {
+                const auto define = defines.find(std::string{ token });
+                code += define != defines.end() && to_count(define->second) >= 0 ? std::string_view{ define->second } : token;
+                code += ' ';
+            }
+            code += '\n';
+        }
+        return code;
+    }
+
+    void expand(std::string_view source, const std::filesystem::path& directory, std::string& result)
+    {
+        while (!source.empty())
+        {
+            const auto end = source.find('\n');
+            const auto line = source.substr(0, end);
+            source.remove_prefix(end == std::string_view::npos ? source.size() : end + 1);
+
+            if (const auto file = include_of(line); !file.empty())
+            {
+                const auto path = (directory / file).lexically_normal();
+                if (included_.insert(path.generic_string()).second)
+                {
+                    expand(read_shader_file(path), path.parent_path(), result);
+                    if (!result.empty() && result.back() != '\n')
+                        result += '\n';
+                }
+                continue;
+            }
+            result += line;
+            if (end != std::string_view::npos)
+                result += '\n';
+        }
+    }
+
+    // the file of an #include "file" line, empty for other lines
+    static auto include_of(std::string_view line) -> std::string_view
+    {
+        constexpr std::string_view blanks = " \t";
+        const auto first = line.find_first_not_of(blanks);
+        if (first == std::string_view::npos || line[first] != '#')
+            return {};
+        line.remove_prefix(first + 1);
+        line.remove_prefix(std::min(line.find_first_not_of(blanks), line.size()));
+        constexpr std::string_view directive = "include";
+        if (!line.starts_with(directive))
+            return {};
+        line.remove_prefix(directive.size());
+        const auto open = line.find('"');
+        const auto close = open == std::string_view::npos ? open : line.find('"', open + 1);
+        if (close == std::string_view::npos)
+            return {};
+        return line.substr(open + 1, close - open - 1);
+    }
+
+    // after the #version line, which GLSL wants first, or at the start without one
+    static void insert_defines(std::string& source, std::span<const std::string_view> defines)
+    {
+        std::string lines;
+        for (const auto define : defines)
+        {
+            lines += "#define ";
+            lines += define;
+            lines += '\n';
+        }
+        std::size_t at = 0;
+        if (const auto version = source.find("#version"); version != std::string::npos)
+        {
+            const auto end = source.find('\n', version);
+            if (end == std::string::npos)
+                source += '\n';
+            at = end == std::string::npos ? source.size() : end + 1;
+        }
+        source.insert(at, lines);
+    }
+
+    std::unordered_set<std::string> included_;
+};
@@ -0,0 +1,132 @@
+#pragma once
+#include <format>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+
+#include <glad/glad.h>
+
+#include "shader.hpp"
+#include "shader_preprocessor.hpp"
+
+// One program specialized at compile time for each combination of feature toggles it is used with, instead of
+// branching on uniforms in every fragment. Bit i of a mask turns on features[i], the stages see it as
+// #define features[i] and test it with #ifdef. A variant is built by the first get() of its mask and kept, so a
+// toggle costs a compile once and a program switch after that.
+//   enum shadow_feature : std::uint32_t { POISSON = 1 << 0, BIAS = 1 << 1 };
+//   shader_variants entity{ { "POISSON", "BIAS" }, shader_entity<GL_VERTEX_SHADER>{ ... }, ... };
+//   const Shader& shader = entity.get((poisson ? POISSON : 0u) | (bias ? BIAS : 0u));
+// on_first_use() sets up each variant before get() first hands it out, for the uniforms set once (sampler units)
+// that every variant needs. prepare() only builds, so with parallel_compile the variants are submitted together.
+// features are kept as views, string literals as above. The files are read once, the variants differ only in their
+// defines and go through program_cache each.
+class shader_variants
+{
+public:
+    template <int... I>
+    explicit shader_variants(std::vector<std::string_view> features, shader_entity<I>... stages)
+        : features_{ std::move(features) }
+    {
+        assert(features_.size() <= 32);
+        (stages_.push_back({ static_cast<GLenum>(I), read_shader_file(stages.path), stages.path.parent_path() }), ...);
+    }
+
+    shader_variants(const shader_variants&) = delete;
+    shader_variants& operator=(const shader_variants&) = delete;
+
+    // setup runs once on every variant, when get() first returns it
+    void on_first_use(void (*setup)(const Shader&))
+    {
+        setup_ = setup;
+        for (auto& [mask, v] : variants_)
+            v.set_up = false;
+    }
+
+    // the variant of mask, built on first use
+    [[nodiscard]] auto get(std::uint32_t mask) -> const Shader&
+    {
+        auto it = variants_.find(mask);
+        if (it == variants_.end())
+            it = build(mask);
+        auto& v = it->second;
+        if (!v.set_up && setup_)
+            setup_(v.shader);
+        v.set_up = true;
+        return v.shader;
+    }
+
+    // builds every combination of the features in mask ahead of first use, e.g. while the demo loads
+    void prepare(std::uint32_t mask)
+    {
+        for (std::uint32_t subset = mask;; subset = (subset - 1) & mask)
+        {
+            if (!variants_.contains(subset))
+                build(subset);
+            if (subset == 0)
+                break;
+        }
+    }
+
+    [[nodiscard]] auto features() const -> const std::vector<std::string_view>& { return features_; }
+    [[nodiscard]] auto size() const -> std::size_t { return variants_.size(); }
+
+    // the defines of mask, in feature order
+    [[nodiscard]] auto defines(std::uint32_t mask) const -> std::vector<std::string_view>
+    {
+        std::vector<std::string_view> defines;
+        for (std::size_t i = 0; i < features_.size(); i++)
+        {
+            if (mask & (1u << i))
+                defines.push_back(features_[i]);
+        }
+        return defines;
+    }
+
+    void report(std::string_view name) const
+    {
+        std::cout << std::format("shader variants {}: {} of {} built\n", name, variants_.size(), std::size_t{ 1 } << features_.size());
+        for (const auto& [mask, v] : variants_)
+        {
+            std::string toggles;
+            for (const auto define : defines(mask))
+                toggles += std::format(" {}", define);
+            std::cout << std::format("  {:#06x}{}\n", mask, toggles.empty() ? " (none)" : toggles);
+        }
+    }
+
+private:
+    struct stage
+    {
+        GLenum type;
+        std::string source;
+        std::filesystem::path directory;
+    };
+
+    struct variant
+    {
+        Shader shader;
+        bool set_up;
+    };
+
+    auto build(std::uint32_t mask) -> std::unordered_map<std::uint32_t, variant>::iterator
+    {
+        assert(features_.size() == 32 || (mask >> features_.size()) == 0);
+        const auto variant_defines = defines(mask);
+        std::vector<shader_stage> stages;
+        stages.reserve(stages_.size());
+        for (const auto& s : stages_)
+            stages.push_back({ s.type, shader_preprocessor::run(s.source, s.directory, variant_defines) });
+        return variants_.try_emplace(mask, Shader{ std::span<const shader_stage>{ stages } }, false).first;
+    }
+
+    std::vector<std::string_view> features_;
+    std::vector<stage> stages_;
+    // node based, the Shaders get() hands out stay where they are
+    std::unordered_map<std::uint32_t, variant> variants_;
+    void (*setup_)(const Shader&) = nullptr;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <string_view>
+
+// Start up timing of the demos, measured from static initialization of the process.
+//   report_startup("assets loaded");   prints the time since start
+//   report_first_frame();              call after every glfwSwapBuffers, prints once
+
+inline const auto process_start_time = std::chrono::steady_clock::now();
+
+[[nodiscard]] inline auto startup_elapsed_ms() -> double
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - process_start_time).count();
+}
+
+inline void report_startup(std::string_view event)
+{
+    std::cout << std::format("{}: {:.1f} ms after start\n", event, startup_elapsed_ms());
+}
+
+inline void report_first_frame()
+{
+    static bool reported = false;
+    if (reported)
+        return;
+    reported = true;
+    report_startup("time to first frame");
+}
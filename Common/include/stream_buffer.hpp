@@ -0,0 +1,200 @@
+#pragma once
+#include <span>
+#include <array>
+#include <format>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+#include <glad/glad.h>
+
+#include "gl_handle.hpp"
+
+// Ring buffer for data written every frame: vertices built on the CPU, uniform blocks, instance attributes.
+// Data is copied in with write(), which returns its offset in id(). One buffer serves every target, and the
+// callers bind it with that offset: glBindBufferRange for uniform blocks, or a draw's first vertex for vertex data
+// written with the vertex stride as alignment.
+//
+// Where GL 4.4 is loaded the buffer is immutable storage, mapped once, persistent and coherent. It is split into
+// frames_in_flight regions, and one frame writes into one region. end_frame() puts a fence behind the frame's draws.
+// begin_frame() waits on the fence of the region about to be reused, which normally signaled long ago, so
+// writing never makes the driver sync implicitly.
+// On the 3.3 contexts every write maps its range unsynchronized. When the buffer is full it is orphaned:
+// glBufferData with no data gets fresh storage, and draws still in flight keep the old one. Draw what was
+// written before the next write, because that write may orphan. Both paths bind the buffer to
+// GL_COPY_WRITE_BUFFER only, which leaves the vertex and element buffer bindings alone.
+// Like the rest of the GL side it is only used from the context thread.
+class stream_buffer
+{
+public:
+    static constexpr std::size_t frames_in_flight = 3;
+
+    struct statistics
+    {
+        std::size_t bytes;
+        std::size_t writes;
+        // begin_frame() calls that found the GPU still reading the region
+        std::size_t waits;
+        std::size_t orphans;
+    };
+
+    // bytes_per_frame bounds what one frame writes, alignment padding included
+    explicit stream_buffer(std::size_t bytes_per_frame)
+        : region_size_{ (bytes_per_frame + 255) / 256 * 256 }, persistent_{ GLAD_GL_VERSION_4_4 != 0 }
+    {
+        buffer_ = gl_buffer::create();
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+        if (persistent_)
+        {
+            constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, capacity(), nullptr, flags);
+            mapped_ = static_cast<std::byte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, capacity(), flags));
+            end_ = region_size_;
+        }
+        else
+        {
+            glBufferData(GL_COPY_WRITE_BUFFER, capacity(), nullptr, GL_STREAM_DRAW);
+        }
+    }
+
+    stream_buffer(const stream_buffer&) = delete;
+    stream_buffer& operator=(const stream_buffer&) = delete;
+
+    ~stream_buffer()
+    {
+        for (auto& fence : fences_)
+        {
+            if (fence)
+                glDeleteSync(fence);
+        }
+    }
+
+    [[nodiscard]] auto id() const -> GLuint { return buffer_; }
+    [[nodiscard]] auto persistent() const -> bool { return persistent_; }
+    [[nodiscard]] auto capacity() const -> std::size_t { return region_size_ * frames_in_flight; }
+
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, the alignment to write uniform blocks with
+    [[nodiscard]] static auto uniform_alignment() -> std::size_t
+    {
+        static const auto alignment = [] {
+            GLint value = 256;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+            return static_cast<std::size_t>(value);
+        }();
+        return alignment;
+    }
+
+    // call before the first write of a frame
+    void begin_frame()
+    {
+        current_ = {};
+        if (!persistent_)
+            return;
+
+        const auto region = frame_ % frames_in_flight;
+        head_ = region * region_size_;
+        end_ = head_ + region_size_;
+        if (auto& fence = fences_[region])
+        {
+            // flush on the first check, so the fence cannot wait on commands never sent
+            if (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+            {
+                ++current_.waits;
+                while (glClientWaitSync(fence, 0, 1'000'000) == GL_TIMEOUT_EXPIRED)
+                {
+                }
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    // call after the last draw reading what this frame wrote
+    void end_frame()
+    {
+        if (persistent_)
+            fences_[frame_ % frames_in_flight] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        ++frame_;
+        last_ = current_;
+        total_.bytes += current_.bytes;
+        total_.writes += current_.writes;
+        total_.waits += current_.waits;
+        total_.orphans += current_.orphans;
+    }
+
+    // copies size bytes and returns their offset in id(), a multiple of alignment (any positive value)
+    [[nodiscard]] auto write(const void* data, std::size_t size, std::size_t alignment = 16) -> GLintptr
+    {
+        auto offset = (head_ + alignment - 1) / alignment * alignment;
+        if (persistent_)
+        {
+            if (offset + size > end_)
+                throw std::length_error(std::format("stream_buffer: a frame wrote more than {} bytes", region_size_));
+            std::memcpy(mapped_ + offset, data, size);
+        }
+        else
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+            if (offset + size > capacity())
+            {
+                if (size > capacity())
+                    throw std::length_error(std::format("stream_buffer: a write of {} bytes does not fit", size));
+                glBufferData(GL_COPY_WRITE_BUFFER, capacity(), nullptr, GL_STREAM_DRAW);
+                ++current_.orphans;
+                offset = 0;
+            }
+            constexpr GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+            if (const auto target = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size, flags))
+            {
+                std::memcpy(target, data, size);
+                glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            }
+        }
+        head_ = offset + size;
+        current_.bytes += size;
+        ++current_.writes;
+        return static_cast<GLintptr>(offset);
+    }
+
+    template <typename T, std::size_t Extent>
+    [[nodiscard]] auto write(std::span<T, Extent> values, std::size_t alignment = alignof(T)) -> GLintptr
+    {
+        return write(values.data(), values.size_bytes(), alignment);
+    }
+
+    // one uniform block, laid out by the caller to match std140
+    template <typename T>
+    [[nodiscard]] auto write_uniform(const T& block) -> GLintptr
+    {
+        return write(&block, sizeof(T), uniform_alignment());
+    }
+
+    [[nodiscard]] auto last_frame() const -> statistics { return last_; }
+
+    void report(std::string_view name) const
+    {
+        const auto frames = static_cast<double>(std::max<std::size_t>(frame_, 1));
+        std::cout << std::format("stream buffer {}: {} KiB {}, {} frames, per frame {:.1f} bytes in {:.1f} writes, "
+                                 "{} waits, {} orphans\n",
+                                 name, capacity() / 1024, persistent_ ? "persistent" : "orphaned", frame_,
+                                 total_.bytes / frames, total_.writes / frames, total_.waits, total_.orphans);
+    }
+
+private:
+    // deleting the buffer unmaps it
+    gl_buffer buffer_;
+    std::size_t region_size_;
+    bool persistent_;
+    std::byte* mapped_{ nullptr };
+    std::array<GLsync, frames_in_flight> fences_{};
+    std::size_t frame_{ 0 };
+    // next free byte, and the end of the current region when persistent
+    std::size_t head_{ 0 };
+    std::size_t end_{ 0 };
+    statistics current_{};
+    statistics last_{};
+    statistics total_{};
+};
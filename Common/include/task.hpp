@@ -0,0 +1,389 @@
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <variant>
+#include <utility>
+#include <optional>
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+
+#include "thread_pool.hpp"
+
+// Coroutine tasks for asset loading.
+//
+//   task<T>                  lazy coroutine, starts when awaited (or started with start()) and resumes its awaiter when done
+//   schedule_on(pool)        continues the coroutine on a thread pool worker
+//   resume_on_main_thread()  continues the coroutine on the GL thread, the next time the render loop calls
+//                            main_thread_queue::shared().poll()
+//   when_all(tasks)          runs tasks concurrently, resumes with all their results
+//   start(task)              runs a task to completion in the background, poll the returned async_result every frame
+//
+// a typical loader reads and decodes on the pool and hops to the main thread for GL calls:
+//   auto load() -> task<GLuint> {
+//       co_await schedule_on(thread_pool::shared());
+//       decoded_image image{ "a.png" };
+//       co_await resume_on_main_thread();
+//       ... upload ...
+//   }
+
+template <typename T = void>
+class task;
+
+namespace detail
+{
+    struct task_promise_base
+    {
+        std::coroutine_handle<> continuation{ std::noop_coroutine() };
+        std::exception_ptr exception;
+
+        struct final_awaiter
+        {
+            bool await_ready() noexcept { return false; }
+
+            // symmetric transfer, the awaiter continues without growing the stack
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept
+            {
+                return finished.promise().continuation;
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        final_awaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() noexcept { exception = std::current_exception(); }
+    };
+
+    template <typename T>
+    struct task_promise : task_promise_base
+    {
+        std::optional<T> value;
+
+        task<T> get_return_object() noexcept;
+
+        template <typename U>
+        void return_value(U&& result)
+        {
+            value.emplace(std::forward<U>(result));
+        }
+
+        T take()
+        {
+            if (exception)
+                std::rethrow_exception(exception);
+            return std::move(*value);
+        }
+    };
+
+    template <>
+    struct task_promise<void> : task_promise_base
+    {
+        task<void> get_return_object() noexcept;
+
+        void return_void() noexcept {}
+
+        void take()
+        {
+            if (exception)
+                std::rethrow_exception(exception);
+        }
+    };
+
+    // eagerly started coroutine nobody awaits, its frame frees itself when it finishes
+    struct detached
+    {
+        struct promise_type
+        {
+            detached get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+}
+
+template <typename T>
+class [[nodiscard]] task
+{
+public:
+    using promise_type = detail::task_promise<T>;
+
+    task(task&& other) noexcept
+        : handle_{ std::exchange(other.handle_, {}) }
+    {
+    }
+
+    task& operator=(task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_)
+                handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    ~task()
+    {
+        if (handle_)
+            handle_.destroy();
+    }
+
+    // awaiting starts the task, the awaiting coroutine resumes on whatever thread the task finishes on
+    auto operator co_await() && noexcept
+    {
+        struct awaiter
+        {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().take(); }
+        };
+        return awaiter{ handle_ };
+    }
+
+private:
+    friend promise_type;
+
+    explicit task(std::coroutine_handle<promise_type> handle) noexcept
+        : handle_{ handle }
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+template <typename T>
+task<T> detail::task_promise<T>::get_return_object() noexcept
+{
+    return task<T>{ std::coroutine_handle<task_promise>::from_promise(*this) };
+}
+
+inline task<void> detail::task_promise<void>::get_return_object() noexcept
+{
+    return task<void>{ std::coroutine_handle<task_promise>::from_promise(*this) };
+}
+
+// continues the awaiting coroutine on a worker of pool
+[[nodiscard]] inline auto schedule_on(thread_pool& pool)
+{
+    struct awaiter
+    {
+        thread_pool& pool;
+
+        bool await_ready() noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { pool.post([handle] { handle.resume(); }); }
+        void await_resume() noexcept {}
+    };
+    return awaiter{ pool };
+}
+
+// continuations waiting for the GL thread, the render loop runs them once per frame with poll()
+class main_thread_queue
+{
+public:
+    // never destroyed, pool workers finishing their last jobs during exit may still post to it
+    static main_thread_queue& shared()
+    {
+        static auto* queue = new main_thread_queue;
+        return *queue;
+    }
+
+    void post(std::coroutine_handle<> handle)
+    {
+        std::scoped_lock lock{ mutex_ };
+        queue_.push_back(handle);
+    }
+
+    // resumes everything queued so far, continuations queued while polling wait for the next call.
+    // returns the number of resumed coroutines
+    std::size_t poll()
+    {
+        std::vector<std::coroutine_handle<>> ready;
+        {
+            std::scoped_lock lock{ mutex_ };
+            ready.swap(queue_);
+        }
+        for (auto handle : ready)
+            handle.resume();
+        return ready.size();
+    }
+
+    [[nodiscard]] auto schedule()
+    {
+        struct awaiter
+        {
+            main_thread_queue& queue;
+
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { queue.post(handle); }
+            void await_resume() noexcept {}
+        };
+        return awaiter{ *this };
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::coroutine_handle<>> queue_;
+};
+
+[[nodiscard]] inline auto resume_on_main_thread()
+{
+    return main_thread_queue::shared().schedule();
+}
+
+namespace detail
+{
+    template <typename T>
+    using result_slot = std::conditional_t<std::is_void_v<T>, std::monostate, std::optional<T>>;
+
+    struct when_all_counter
+    {
+        std::atomic<std::size_t> remaining;
+        std::coroutine_handle<> parent;
+
+        // true for the last arrival, which resumes the parent
+        bool arrive() noexcept { return remaining.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+    };
+
+    template <typename T>
+    detached when_all_child(task<T> child, when_all_counter& counter, result_slot<T>& slot, std::exception_ptr& error)
+    {
+        try
+        {
+            if constexpr (std::is_void_v<T>)
+                co_await std::move(child);
+            else
+                slot.emplace(co_await std::move(child));
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        // nothing of the parent frame may be touched after this, it can be gone once resumed
+        if (counter.arrive())
+            counter.parent.resume();
+    }
+}
+
+template <typename T>
+using when_all_result = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+// runs every task at once, the results keep the order of tasks. rethrows the first failure once all finished
+template <typename T>
+auto when_all(std::vector<task<T>> tasks) -> task<when_all_result<T>>
+{
+    // one extra count for the parent, so children finishing during the start cannot resume it early
+    detail::when_all_counter counter{ tasks.size() + 1, {} };
+    std::vector<detail::result_slot<T>> slots(tasks.size());
+    std::vector<std::exception_ptr> errors(tasks.size());
+
+    struct awaiter
+    {
+        std::vector<task<T>>& tasks;
+        detail::when_all_counter& counter;
+        std::vector<detail::result_slot<T>>& slots;
+        std::vector<std::exception_ptr>& errors;
+
+        bool await_ready() noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> parent)
+        {
+            counter.parent = parent;
+            for (std::size_t i = 0; i < tasks.size(); ++i)
+                detail::when_all_child(std::move(tasks[i]), counter, slots[i], errors[i]);
+            return !counter.arrive(); // everything finished inline, keep going
+        }
+
+        void await_resume() noexcept {}
+    };
+    co_await awaiter{ tasks, counter, slots, errors };
+
+    for (const auto& error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+    if constexpr (!std::is_void_v<T>)
+    {
+        std::vector<T> results;
+        results.reserve(slots.size());
+        for (auto& slot : slots)
+            results.push_back(std::move(*slot));
+        co_return results;
+    }
+}
+
+// result of a started task, polled by the render loop
+template <typename T>
+class async_result
+{
+public:
+    [[nodiscard]] bool ready() const { return state_->ready.load(std::memory_order_acquire); }
+
+    // only valid once ready() returned true, rethrows the failure of the task
+    decltype(auto) get()
+    {
+        if (state_->exception)
+            std::rethrow_exception(state_->exception);
+        if constexpr (!std::is_void_v<T>)
+            return (*state_->value);
+    }
+
+private:
+    template <typename U>
+    friend auto start(task<U> work) -> async_result<U>;
+
+    struct state
+    {
+        std::atomic<bool> ready{ false };
+        detail::result_slot<T> value;
+        std::exception_ptr exception;
+    };
+
+    explicit async_result(std::shared_ptr<state> s)
+        : state_{ std::move(s) }
+    {
+    }
+
+    std::shared_ptr<state> state_;
+};
+
+// runs work in the background, it executes inline until its first hop to another thread
+template <typename T>
+auto start(task<T> work) -> async_result<T>
+{
+    using state = typename async_result<T>::state;
+    auto shared = std::make_shared<state>();
+    [](task<T> work, std::shared_ptr<state> s) -> detail::detached {
+        try
+        {
+            if constexpr (std::is_void_v<T>)
+                co_await std::move(work);
+            else
+                s->value.emplace(co_await std::move(work));
+        }
+        catch (...)
+        {
+            s->exception = std::current_exception();
+        }
+        s->ready.store(true, std::memory_order_release);
+    }(std::move(work), shared);
+    return async_result<T>{ std::move(shared) };
+}
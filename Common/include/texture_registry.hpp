@@ -0,0 +1,174 @@
+#pragma once
+#include <span>
+#include <format>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include <filesystem>
+#include <unordered_map>
+#include <system_error>
+
+#include <glad/glad.h>
+
+#include "hash.hpp"
+#include "gl_handle.hpp"
+
+// Process wide, reference counted table of 2D textures loaded from files.
+// Looked up by the canonical path of the image (plus an optional variant tag, e.g. srgb), so every Model and
+// every loadTexture helper ends up with the same GL name for the same file. Loaders that decode through
+// decoded_image also pass the hash of the file content to resolve(), which folds a fresh name into an
+// existing one holding the same image, e.g. when it is copied next to several models. The hash is taken
+// where the file is read for decoding, acquire() itself never touches the file.
+// Like the rest of the GL side it is only used from the context thread.
+class texture_registry
+{
+public:
+    struct acquire_result
+    {
+        GLuint id;
+        // true if the caller got a fresh texture name and has to upload the pixels itself
+        bool created;
+    };
+
+    struct statistics
+    {
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t live;
+    };
+
+    static texture_registry& shared()
+    {
+        static texture_registry registry;
+        return registry;
+    }
+
+    // returns the texture for path and takes a reference on it
+    [[nodiscard]] auto acquire(const std::filesystem::path& path, std::string_view variant = {})
+        -> acquire_result
+    {
+        auto key = make_key(path, variant);
+        if (const auto it = paths_.find(key); it != paths_.end())
+            return hit(it->second);
+
+        auto texture = gl_texture::create();
+        const GLuint id = texture;
+        paths_.emplace(key, id);
+        entries_.emplace(id, entry{ 1, 0, { std::move(key) }, std::move(texture) });
+        ++misses_;
+        return { id, true };
+    }
+
+    // call with the file hash (decoded_image::content()) before uploading a texture acquire() created.
+    // returns id if it holds the first image with this content, the caller uploads as usual. otherwise the
+    // paths and references of id move to the texture already holding the image, id is deleted and the
+    // existing name is returned: the caller skips the upload and uses that name wherever it handed out id
+    [[nodiscard]] auto resolve(GLuint id, std::uint64_t content, std::string_view variant = {}) -> GLuint
+    {
+        if (content == 0)
+            return id;
+        content = fnv1a(std::as_bytes(std::span{ variant }), content);
+        if (content == 0)
+            content = 1;
+
+        auto fresh = entries_.find(id);
+        if (fresh == entries_.end())
+            return id;
+        const auto [it, inserted] = contents_.emplace(content, id);
+        if (inserted)
+        {
+            fresh->second.content = content;
+            return id;
+        }
+
+        // same image under another path, its paths become aliases
+        auto& existing = entries_.at(it->second);
+        for (auto& key : fresh->second.paths)
+        {
+            paths_.at(key) = it->second;
+            existing.paths.push_back(std::move(key));
+        }
+        existing.refs += fresh->second.refs;
+        // the request that created id turns out to share the image
+        ++hits_;
+        --misses_;
+        // deletes the fresh texture
+        entries_.erase(fresh);
+        return it->second;
+    }
+
+    // drops a reference, the texture is deleted with the last one
+    void release(GLuint id)
+    {
+        const auto it = entries_.find(id);
+        if (it == entries_.end() || --it->second.refs != 0)
+            return;
+
+        for (const auto& key : it->second.paths)
+            paths_.erase(key);
+        if (it->second.content != 0)
+            contents_.erase(it->second.content);
+        // deletes the texture
+        entries_.erase(it);
+    }
+
+    // deletes every texture still registered, whatever its references. The registry outlives the context,
+    // glfw_session clears it before glfwTerminate()
+    void clear()
+    {
+        entries_.clear();
+        paths_.clear();
+        contents_.clear();
+    }
+
+    [[nodiscard]] auto stats() const -> statistics
+    {
+        return { hits_, misses_, entries_.size() };
+    }
+
+    void report(std::ostream& os = std::cout) const
+    {
+        os << std::format("texture registry: {} hits, {} misses, {} live textures\n", hits_, misses_, entries_.size());
+    }
+
+private:
+    struct entry
+    {
+        std::size_t refs;
+        std::uint64_t content;
+        std::vector<std::string> paths;
+        gl_texture texture;
+    };
+
+    auto hit(GLuint id) -> acquire_result
+    {
+        ++entries_.at(id).refs;
+        ++hits_;
+        return { id, false };
+    }
+
+    static auto make_key(const std::filesystem::path& path, std::string_view variant)
+        -> std::string
+    {
+        std::error_code ec;
+        auto canonical = std::filesystem::weakly_canonical(path, ec);
+        if (ec)
+            canonical = std::filesystem::absolute(path).lexically_normal();
+
+        auto key = canonical.generic_string();
+        if (!variant.empty())
+        {
+            key += '|';
+            key += variant;
+        }
+        return key;
+    }
+
+    std::unordered_map<GLuint, entry> entries_;
+    std::unordered_map<std::string, GLuint> paths_;
+    std::unordered_map<std::uint64_t, GLuint> contents_;
+    std::size_t hits_{ 0 };
+    std::size_t misses_{ 0 };
+};
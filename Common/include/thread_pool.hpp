@@ -0,0 +1,103 @@
+#pragma once
+#include <mutex>
+#include <deque>
+#include <memory>
+#include <future>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+
+// fixed size worker pool for CPU side jobs (decoding, mesh processing...).
+// jobs must not touch GL, the context only lives on the main thread.
+class thread_pool
+{
+public:
+    explicit thread_pool(unsigned int thread_count = default_thread_count())
+    {
+        workers_.reserve(thread_count);
+        for (unsigned int i = 0; i < thread_count; ++i)
+        {
+            workers_.emplace_back([this](std::stop_token stop) { work(stop); });
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool()
+    {
+        {
+            std::scoped_lock lock{ mutex_ };
+            for (auto& worker : workers_)
+                worker.request_stop();
+        }
+        cv_.notify_all();
+        // jthread joins on destruction
+    }
+
+    // process wide pool, created on first use
+    static thread_pool& shared()
+    {
+        static thread_pool pool;
+        return pool;
+    }
+
+    static unsigned int default_thread_count()
+    {
+        // leave one core to the GL thread
+        return std::max(1u, std::thread::hardware_concurrency() - 1);
+    }
+
+    [[nodiscard]] std::size_t size() const { return workers_.size(); }
+
+    template <typename F>
+    auto submit(F&& job) -> std::future<std::invoke_result_t<std::decay_t<F>>>
+    {
+        using result_t = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<result_t()>>(std::forward<F>(job));
+        auto future = task->get_future();
+        {
+            std::scoped_lock lock{ mutex_ };
+            jobs_.emplace_back([task] { (*task)(); });
+        }
+        cv_.notify_one();
+        return future;
+    }
+
+    // fire and forget, for jobs that report back on their own (coroutine resumption...)
+    template <typename F>
+    void post(F&& job)
+    {
+        {
+            std::scoped_lock lock{ mutex_ };
+            jobs_.emplace_back(std::forward<F>(job));
+        }
+        cv_.notify_one();
+    }
+
+private:
+    void work(std::stop_token stop)
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock lock{ mutex_ };
+                cv_.wait(lock, [&] { return stop.stop_requested() || !jobs_.empty(); });
+                if (jobs_.empty())
+                    return; // stop requested and nothing left to do
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+            job();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> jobs_;
+    std::vector<std::jthread> workers_;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Uniform blocks shared by the programs of every demo. Shader binds a block with one of these names to its fixed
+// binding point when it links, a program only has to declare the block:
+//
+//   layout (std140) uniform Frame      // camera state, uploaded once per frame by frame_uniforms
+//   {
+//       mat4 view;
+//       mat4 projection;
+//       mat4 viewProj;
+//       vec3 viewPos;
+//       float time;
+//   };
+//   layout (std140) uniform Object     // per draw, render_queue fills it for programs that declare it
+//   {
+//       mat4 model;
+//       mat4 normalMatrix;             // transpose(inverse(model)), used as mat3(normalMatrix)
+//   };
+//
+// the structs below mirror the std140 layouts, members in the same order
+
+struct frame_block
+{
+    static constexpr GLuint binding = 0;
+    static constexpr const char* name = "Frame";
+
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 view_projection;
+    // a vec3 followed by a float shares one 16 byte slot in std140
+    glm::vec3 view_position;
+    float time;
+};
+static_assert(sizeof(frame_block) == 208);
+
+struct object_block
+{
+    static constexpr GLuint binding = 1;
+    static constexpr const char* name = "Object";
+
+    glm::mat4 model;
+    // a mat3 has padded columns in std140, a mat4 keeps both sides simple
+    glm::mat4 normal_matrix;
+};
+static_assert(sizeof(object_block) == 128);
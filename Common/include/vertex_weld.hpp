@@ -0,0 +1,62 @@
+#pragma once
+#include <bit>
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "hash.hpp"
+#include "mesh.hpp"
+
+// Vertex welding.
+// Importers without shared vertex indices (OBJ...) emit one vertex per triangle corner,
+// welding merges the bitwise identical ones and rewrites the indices to the survivors.
+// Runs on the final Vertex, so corners with different normals, uvs or tangents stay apart.
+
+// welds vertices in place, the unique vertices are moved to the front in first occurrence order.
+// indices refer to vertices with base_vertex added, and still do afterwards.
+// returns the number of unique vertices, the ones past it are left unspecified.
+[[nodiscard]] inline auto weld_vertices(std::span<Vertex> vertices, std::span<unsigned int> indices, unsigned int base_vertex = 0)
+    -> std::size_t
+{
+    // Vertex is made of 4 byte fields only, no padding takes part in the bytewise hash and compare
+    constexpr auto empty = ~0u;
+
+    const auto count = vertices.size();
+    if (count == 0)
+        return 0;
+
+    // open addressing, at most half full
+    const auto mask = std::bit_ceil(count * 2) - 1;
+    std::vector<unsigned int> table(mask + 1, empty);
+    std::vector<unsigned int> remap(count);
+
+    unsigned int unique = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto slot = static_cast<std::size_t>(fnv1a(vertices[i], fnv_offset_basis)) & mask;
+        while (true)
+        {
+            const auto candidate = table[slot];
+            if (candidate == empty)
+            {
+                // every slot below unique already holds a welded vertex, so this never overwrites a live one
+                if (unique != i)
+                    vertices[unique] = vertices[i];
+                table[slot] = unique;
+                remap[i] = unique++;
+                break;
+            }
+            if (std::memcmp(&vertices[candidate], &vertices[i], sizeof(Vertex)) == 0)
+            {
+                remap[i] = candidate;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    for (auto& index : indices)
+        index = remap[index - base_vertex] + base_vertex;
+    return unique;
+}
@@ -9,7 +9,11 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shader.hpp"
+#include "shader_variants.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
 #include "camera.hpp"
+#include "texture_registry.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -37,6 +41,12 @@ bool firstMouse = true;
 bool gammaEnabled = false;
 bool gammaKeyPressed = false;
 
+// toggle of shaders/floor.fs, compiled into a variant of its own
+enum floor_feature : std::uint32_t
+{
+    GAMMA = 1 << 0,
+};
+
 
 Camera camera{ {-0.2f, 0.3f, 5.0} };
 
@@ -45,7 +55,7 @@ int main()
     //-------------------------------------
     // glfw: initialize and configure
     //-------------------------------------
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -62,7 +72,6 @@ int main()
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -86,7 +95,8 @@ int main()
     Shader boxShader(
         shader_entity<GL_VERTEX_SHADER> {std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/material.vs"},
         shader_entity<GL_FRAGMENT_SHADER> {std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/material.fs"});
-    Shader floorShader(
+    shader_variants floorShaders(
+        { "GAMMA" },
         shader_entity<GL_VERTEX_SHADER> {std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/floor.vs"},
         shader_entity<GL_FRAGMENT_SHADER> {std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/floor.fs"});
     Shader lightSrcShader(
@@ -269,7 +279,8 @@ int main()
     boxShader.set("material.specular", 1);
     boxShader.set("material.shininess", 32.0f);
 
-    floorShader.set("floorTexture", 0);
+    floorShaders.prepare(GAMMA);
+    floorShaders.on_first_use([](const Shader& shader) { shader.set("floorTexture", 0); });
 
     //-------------------------------------------------------------------------
     // global setting
@@ -351,6 +362,7 @@ int main()
         */
         // floor
         {
+            const Shader& floorShader = floorShaders.get(gammaEnabled ? GAMMA : 0u);
             floorShader.use();
             floorShader.set("view", view);
             floorShader.set("projection", projection);
@@ -359,7 +371,6 @@ int main()
             glUniform3fv(glGetUniformLocation(floorShader, "lightPositions"), 4, &pointLightPositions[0][0]);
             glUniform3fv(glGetUniformLocation(floorShader, "lightColors"), 4, &lightColors[0][0]);
             floorShader.set("viewPos", camera.Position);
-            floorShader.set("gamma", gammaEnabled);
 
             glBindVertexArray(floor_vao);
             glActiveTexture(GL_TEXTURE0);
@@ -395,13 +406,13 @@ int main()
 
         // Swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
         glfwPollEvents();
     }
     glDeleteVertexArrays(1, &cubeVAO);
     glDeleteVertexArrays(1, &lightVAO);
     glDeleteBuffers(1, &vbo);
 
-    glfwTerminate();
     return 0;
 }
 
@@ -468,8 +479,10 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 
 unsigned int loadTexture(const std::filesystem::path& path, bool gammaCorrection)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // shared with every Model and helper in the process, only the first request decodes the file
+    const auto [textureID, created] = texture_registry::shared().acquire(path, gammaCorrection ? "srgb" : "");
+    if (!created)
+        return textureID;
 
     int width, height, nrComponents;
     if (const auto data = ::stbi_load(path.generic_string().c_str(), &width, &height, &nrComponents, 0))
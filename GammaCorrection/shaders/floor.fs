@@ -12,7 +12,6 @@ uniform sampler2D floorTexture;
 uniform vec3 lightPositions[4];
 uniform vec3 lightColors[4];
 uniform vec3 viewPos;
-uniform bool gamma;
 
 
 vec3 BlinnPhong(vec3 normal, vec3 fragPos, vec3 lightPos, vec3 lightColor)
@@ -33,7 +32,11 @@ vec3 BlinnPhong(vec3 normal, vec3 fragPos, vec3 lightPos, vec3 lightColor)
     // attenuation
     float max_distance = 1.5;
     float distance = length(lightPos - fragPos);
-    float attenuation = 1.0 / (gamma ? distance * distance: distance);
+#ifdef GAMMA
+    float attenuation = 1.0 / (distance * distance);
+#else
+    float attenuation = 1.0 / distance;
+#endif
 
     diffuse *= attenuation;
     specular *= attenuation;
@@ -51,10 +54,9 @@ void main()
         lighting += BlinnPhong(fs_in.Normal, fs_in.FragPos, lightPositions[i], lightColors[i]);
     }
 
-    if (gamma)
-    {
-        color = pow(color, vec3(1.0/2.2));
-    }
+#ifdef GAMMA
+    color = pow(color, vec3(1.0/2.2));
+#endif
 
     color *= lighting;
 
@@ -8,6 +8,8 @@
 #include <chrono>
 
 #include "Shader.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
 
 auto vertexShaderSource = R"(
 #version 330 core 
@@ -49,7 +51,7 @@ void processInput(GLFWwindow* window)
 int main()
 {
     // window setup
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -57,7 +59,6 @@ int main()
     auto window = glfwCreateWindow(800, 800, "LearnOpenGL", nullptr, nullptr);
     if (!window) {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -168,6 +169,7 @@ int main()
         glDrawElements(GL_TRIANGLES, 12, GL_UNSIGNED_INT, nullptr);
 
         glfwSwapBuffers(window);
+        report_first_frame();
         glfwPollEvents();
     }
 
@@ -177,6 +179,5 @@ int main()
     glDeleteBuffers(2, vbo);
     glDeleteProgram(shaderProgram);
 
-    glfwTerminate();
 	return 0;
 }
\ No newline at end of file
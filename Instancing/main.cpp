@@ -9,7 +9,16 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shader.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
+#include "gl_state.hpp"
+#include "gl_handle.hpp"
+#include "gpu_arena.hpp"
+#include "gpu_memory.hpp"
+#include "frame_uniforms.hpp"
+#include "frustum.hpp"
 #include "camera.hpp"
+#include "texture_registry.hpp"
 #include "model.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -47,7 +56,7 @@ int main()
     //-------------------------------------
     // glfw: initialize and configure
     //-------------------------------------
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -64,7 +73,6 @@ int main()
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -81,6 +89,11 @@ int main()
         std::cout << "Failed to initialize GLAD\n";
         return -1;
     }
+    // drop redundant state changes, counted per frame
+    gl_state::shared().install();
+    // record the storage of every buffer, texture and renderbuffer, owned by the demo unless a scope says otherwise
+    gpu_memory::shared().install();
+    const gpu_memory::owner_scope owner{ PROJECT_NAME };
 
     //-------------------------------------
     // Create shader
@@ -99,43 +112,53 @@ int main()
     // Initialize model
     //-------------------------------------
     Model planetModel { (std::filesystem::current_path() / "../../../../resource/planet/planet.obj").generic_string() };
-    Model rockModel { (std::filesystem::current_path() / "../../../../resource/rock/rock.obj").generic_string() };
+    // 10'000 instances per draw, the rocks use the compact vertex layout to cut vertex fetch bandwidth
+    Model rockModel { (std::filesystem::current_path() / "../../../../resource/rock/rock.obj").generic_string(), false, { .compactVertices = true } };
     int amount = 10'000;
     auto modelMatrices = genModelMatrices(amount);
 
     //-------------------------------------
     // VAO VBO EBO... and vertex attributes
     //-------------------------------------
+    // instance matrices are bucketed by level of detail every frame, each level draws a contiguous slice
     unsigned int instanceVBO;
     glGenBuffers(1, &instanceVBO);
     glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * amount, modelMatrices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * amount, modelMatrices.data(), GL_DYNAMIC_DRAW);
+
+    // points the instance matrix attribute of the bound VAO at the slice starting with instance first
+    auto setInstanceAttributes = [instanceVBO](std::size_t first)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        const auto base = first * sizeof(glm::mat4);
+        for (unsigned int column = 0; column < 4; column++)
+            glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(base + column * sizeof(glm::vec4)));
+    };
 
     // overwrite the attribute
     for (auto&& mesh : rockModel.meshes)
     {
-        auto vao = mesh.VAO;
-        glBindVertexArray(vao);
-
-        auto vec4_size = sizeof(glm::vec4);
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 4, GL_FLOAT,GL_FALSE, sizeof(glm::mat4), nullptr);
-
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE,sizeof(glm::mat4), reinterpret_cast<void*>(vec4_size));
-
-        glEnableVertexAttribArray(5);
-        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE ,sizeof(glm::mat4), reinterpret_cast<void*>(2 * vec4_size));
-
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(3 * vec4_size));
+        glBindVertexArray(mesh.VAO);
 
-        glVertexAttribDivisor(3, 1);
-        glVertexAttribDivisor(4, 1);
-        glVertexAttribDivisor(5, 1);
-        glVertexAttribDivisor(6, 1);
+        for (unsigned int column = 0; column < 4; column++)
+        {
+            glEnableVertexAttribArray(3 + column);
+            glVertexAttribDivisor(3 + column, 1);
+        }
+        setInstanceAttributes(0);
         glBindVertexArray(0);
     }
+    std::vector<glm::mat4> bucketedMatrices(amount);
+    std::vector<std::size_t> instanceLods(amount);
+    // bounding sphere of every rock per mesh, placed once since the rocks do not move
+    std::vector<std::vector<glm::vec4>> rockSpheres;
+    for (const auto& mesh : rockModel.meshes)
+    {
+        auto& spheres = rockSpheres.emplace_back(amount);
+        for (int i = 0; i < amount; i++)
+            spheres[i] = world_sphere(mesh.boundsCenter, mesh.boundsRadius, modelMatrices[i]);
+    }
+    std::vector<std::uint8_t> rockVisible(amount);
 
     //--------------------------------------
     // global setting
@@ -159,22 +182,18 @@ int main()
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-
-        defaultShader.use();
-        defaultShader.set("view", view);
-        defaultShader.set("projection", projection);
-        asteroidShader.use();
-        asteroidShader.set("view", view);
-        asteroidShader.set("projection", projection);
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
+        // both shaders read the camera from the Frame block
+        frame_uniforms::shared().begin_frame();
+        frame_uniforms::shared().set_frame(camera, projection, currentFrame);
+        const auto view = frustum::of(camera, projection);
         {
             defaultShader.use();
             glm::mat4 model{ 1.0f };
             model = glm::translate(model, glm::vec3(0.0f, -3.0f, 0.0f));
             model = glm::scale(model, glm::vec3(4.0f, 4.0f, 4.0f));
             defaultShader.set("model", model);
-            planetModel.Draw(defaultShader);
+            planetModel.Draw(defaultShader, view, camera, model, SCR_HEIGHT);
 
         }
         {
@@ -182,20 +201,66 @@ int main()
             asteroidShader.set("material1.diffuse", 0);
             glActiveTexture(GL_TEXTURE0);
             glBindTexture(GL_TEXTURE_2D, rockModel.textures_loaded[0].id);
-            for (auto& mesh : rockModel.meshes)
+            for (std::size_t m = 0; m < rockModel.meshes.size(); m++)
             {
+                auto& mesh = rockModel.meshes[m];
+                // only the rocks in view are bucketed and drawn
+                const auto visible = view.cull_spheres(rockSpheres[m], rockVisible);
+                cull_counters::shared().add(visible, amount - visible);
+                if (visible == 0)
+                    continue;
+                // count the instances per level, then scatter their matrices so every level is one slice
+                std::vector<std::size_t> firstInstance(mesh.lods.size() + 1, 0);
+                for (int i = 0; i < amount; i++)
+                {
+                    if (!rockVisible[i])
+                        continue;
+                    instanceLods[i] = select_lod(mesh, modelMatrices[i], camera, SCR_HEIGHT);
+                    firstInstance[instanceLods[i] + 1]++;
+                }
+                for (std::size_t lod = 1; lod < firstInstance.size(); lod++)
+                    firstInstance[lod] += firstInstance[lod - 1];
+                auto next = firstInstance;
+                for (int i = 0; i < amount; i++)
+                {
+                    if (rockVisible[i])
+                        bucketedMatrices[next[instanceLods[i]]++] = modelMatrices[i];
+                }
+
+                glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::mat4) * visible, bucketedMatrices.data());
+
                 glBindVertexArray(mesh.VAO);
-                glDrawElementsInstanced(GL_TRIANGLES, static_cast<unsigned int>(mesh.indices.size()), GL_UNSIGNED_INT, 0, amount);
+                for (std::size_t lod = 0; lod < mesh.lods.size(); lod++)
+                {
+                    const auto count = firstInstance[lod + 1] - firstInstance[lod];
+                    if (count == 0)
+                        continue;
+                    setInstanceAttributes(firstInstance[lod]);
+                    glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(mesh.lods[lod].indexCount), mesh.indexType,
+                                            reinterpret_cast<void*>(mesh.indexByteOffset(lod)), static_cast<GLsizei>(count));
+                }
                 glBindVertexArray(0);
             }
         }
 
         // Swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
+        gl_state::shared().end_frame();
+        gl_objects::shared().end_frame();
+        cull_counters::shared().end_frame();
         glfwPollEvents();
     }
 
-    glfwTerminate();
+    gl_state::shared().report();
+    cull_counters::shared().report();
+    gl_objects::shared().report();
+    gpu_arena::vertices().report();
+    gpu_arena::indices().report();
+    gpu_memory::shared().report();
+    gpu_memory::shared().save_json(PROJECT_NAME "_gpu_memory.json");
+    frame_uniforms::shared().report();
     return 0;
 }
 
@@ -251,8 +316,11 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 
 unsigned int loadTexture(const std::filesystem::path& path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // shared with every Model and helper in the process, only the first request decodes the file
+    const auto [textureID, created] = texture_registry::shared().acquire(path);
+    if (!created)
+        return textureID;
+    const gpu_memory::owner_scope owner{ path.generic_string() };
 
     int width, height, nrComponents;
     if (const auto data = ::stbi_load(path.generic_string().c_str(), &width, &height, &nrComponents, 0))
@@ -5,11 +5,17 @@ layout (location = 3) in mat4 aInstanceMatrix;
 
 out vec2 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec3 viewPos;
+    float time;
+};
 
 void main()
 {
     TexCoords = aTexCoords;
-    gl_Position = projection * view * aInstanceMatrix * vec4(aPos, 1.0f); 
+    gl_Position = viewProj * aInstanceMatrix * vec4(aPos, 1.0f); 
 }
\ No newline at end of file
@@ -3,10 +3,14 @@ out vec4 FragColor;
 
 in vec2 TexCoord;
 
-uniform sampler2D texture_diffuse1;
+struct Material {
+    sampler2D diffuse;
+};
+
+uniform Material material1;
 
 
 void main()
 {
-    FragColor = texture(texture_diffuse1, TexCoord);
+    FragColor = texture(material1.diffuse, TexCoord);
 }
\ No newline at end of file
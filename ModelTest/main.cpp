@@ -9,8 +9,16 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shader.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
+#include "gl_state.hpp"
+#include "gl_handle.hpp"
+#include "gpu_arena.hpp"
+#include "gpu_memory.hpp"
 #include "camera.hpp"
+#include "texture_registry.hpp"
 #include "model.hpp"
+#include "async_assets.hpp"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "ASSIMP/code/Common/Win32DebugLogStream.h"
@@ -37,14 +45,13 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void processInput(GLFWwindow* window);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 unsigned int loadTexture(const std::filesystem::path&);
-unsigned int loadCubemap(const std::vector<std::filesystem::path>&);
 
 int main()
 {
     //-------------------------------------
     // glfw: initialize and configure
     //-------------------------------------
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -61,7 +68,6 @@ int main()
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -80,6 +86,11 @@ int main()
         std::cout << "Failed to initialize GLAD\n";
         return -1;
     }
+    // drop redundant state changes, counted per frame
+    gl_state::shared().install();
+    // record the storage of every buffer, texture and renderbuffer, owned by the demo unless a scope says otherwise
+    gpu_memory::shared().install();
+    const gpu_memory::owner_scope owner{ PROJECT_NAME };
 
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
@@ -92,25 +103,26 @@ int main()
     //-------------------------------------
     // Create shader
     //-------------------------------------
+    // the axis shader also draws the placeholders, everything else loads in the background (see async_assets.hpp)
     Shader axisShader(
         shader_entity<GL_VERTEX_SHADER> {std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/axis.vs"},
         shader_entity<GL_FRAGMENT_SHADER> { std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/axis.fs"}
     );
-    Shader modelShader(
+    auto modelShaderLoad = start(load_shader_async(
         shader_entity<GL_VERTEX_SHADER> { std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/" "model.vs"},
         shader_entity<GL_FRAGMENT_SHADER> { std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/" "model.fs"}
-    );
-    Shader skyboxShader(
+    ));
+    auto skyboxShaderLoad = start(load_shader_async(
         shader_entity<GL_VERTEX_SHADER> { std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/skybox.vs"},
         shader_entity<GL_FRAGMENT_SHADER> { std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/skybox.fs"}
-    );
-    Shader manShader(
+    ));
+    auto manShaderLoad = start(load_shader_async(
         shader_entity<GL_VERTEX_SHADER> { std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/man.vs"},
         shader_entity<GL_FRAGMENT_SHADER> {std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/man.fs"}
-    );
+    ));
 
-    //Model modelInstance{ std::filesystem::current_path() / "../../../../resource/nanosuit_reflection/nanosuit.obj" };
-    Model modelInstance{ std::filesystem::current_path() / "../../../../resource/zzz/joe.pmx" };
+    //auto modelLoad = start(Model::loadAsync(std::filesystem::current_path() / "../../../../resource/nanosuit_reflection/nanosuit.obj"));
+    auto modelLoad = start(Model::loadAsync(std::filesystem::current_path() / "../../../../resource/zzz/joe.pmx"));
 
     // load textures
     // -------------
@@ -122,7 +134,7 @@ int main()
         std::filesystem::current_path() / "../../../../resource/skybox/front.jpg",
         std::filesystem::current_path() / "../../../../resource/skybox/back.jpg"
     };
-    auto cubemapTexture = loadCubemap(face_paths);
+    auto cubemapLoad = start(load_cubemap_async(std::move(face_paths)));
 
     GLfloat axis_vertices[] = {
         -10.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,  // ԭ, ɫ
@@ -285,6 +297,7 @@ int main()
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
     auto model = glm::mat4{ 1.0 };
+    bool assetsReady = false;
 
     // Main loop
     while (!glfwWindowShouldClose(window))
@@ -297,6 +310,15 @@ int main()
         // input
         processInput(window);
 
+        // finish the uploads of the background loaders
+        main_thread_queue::shared().poll();
+        if (!assetsReady && modelLoad.ready() && cubemapLoad.ready()
+            && modelShaderLoad.ready() && skyboxShaderLoad.ready() && manShaderLoad.ready())
+        {
+            assetsReady = true;
+            report_startup("assets loaded");
+        }
+
         auto view = camera.GetViewMatrix();
         auto projection = glm::perspective(glm::radians(camera.Zoom), static_cast<float>(SCR_WIDTH / SCR_HEIGHT), 0.1f, 100.0f);
 
@@ -314,62 +336,84 @@ int main()
             glDrawArrays(GL_LINES, 0, 6);
 
         }
+        if (!assetsReady)
         {
-           // cubes
-            modelShader.use();
-            modelShader.set("projection", projection);
-            modelShader.set("view", view);
-            modelShader.set("cameraPos", camera.Position);
-
+            // placeholders where the cubes and the model will be, colored by their normals
             glBindVertexArray(cubeVAO);
-            modelShader.set("skybox", 0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-
-            model = glm::translate(glm::mat4{ 1.0f }, glm::vec3(-1.0f, 0.0f, -1.0f));
-            modelShader.set("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-
-            model = glm::translate(glm::mat4{ 1.0f }, glm::vec3(2.0f, 0.0f, 0.0f));
-            modelShader.set("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-        }
-        {
-            manShader.use();
-            // directional light
-            manShader.set("light.direction", glm::vec3{ 0.0f, 10.0f, 0.0f });
-            manShader.set("light.ambient", glm::vec3{ 0.5f, 0.5f, 0.5f });
-            manShader.set("light.diffuse", glm::vec3{ 0.4f, 0.4f, 0.4f });
-            manShader.set("light.specular", glm::vec3{ 1.0f, 1.0f, 1.0f });
-
-            auto model = glm::mat4{ 1.0 };
-            model = glm::rotate(model, glm::radians(currentFrame * 10), glm::vec3{ 0.0, 1.0, 0.0 });
-            model = glm::scale(model, { 0.2, 0.2, 0.2 });
-
-            manShader.set("model", model);
-            manShader.set("view", view);
-            manShader.set("projection", projection);
-            manShader.set("viewPos", camera.Position);
-
-            manShader.set("skybox", 4);
-            glActiveTexture(GL_TEXTURE4);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-            modelInstance.Draw(manShader);
+            for (const auto& position : { glm::vec3{ 0.0f }, glm::vec3{ -1.0f, 0.0f, -1.0f }, glm::vec3{ 2.0f, 0.0f, 0.0f } })
+            {
+                axisShader.set("model", glm::translate(glm::mat4{ 1.0f }, position));
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+            }
         }
+        else
         {
-            // skybox
-            glDepthFunc(GL_LEQUAL);
-            skyboxShader.use();
-            auto skyboxView = glm::mat4(glm::mat3(view));
-            skyboxShader.set("view", skyboxView);
-            skyboxShader.set("projection", projection);
-            glBindVertexArray(skyboxVAO);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+            Shader& modelShader = modelShaderLoad.get();
+            Shader& skyboxShader = skyboxShaderLoad.get();
+            Shader& manShader = manShaderLoad.get();
+            Model& modelInstance = *modelLoad.get();
+            const auto cubemapTexture = cubemapLoad.get();
+
+            {
+               // cubes
+                modelShader.use();
+                modelShader.set("projection", projection);
+                modelShader.set("view", view);
+                modelShader.set("cameraPos", camera.Position);
+
+                glBindVertexArray(cubeVAO);
+                modelShader.set("skybox", 0);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+
+                model = glm::translate(glm::mat4{ 1.0f }, glm::vec3(-1.0f, 0.0f, -1.0f));
+                modelShader.set("model", model);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+
+                model = glm::translate(glm::mat4{ 1.0f }, glm::vec3(2.0f, 0.0f, 0.0f));
+                modelShader.set("model", model);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+            }
+            {
+                manShader.use();
+                // directional light
+                manShader.set("light.direction", glm::vec3{ 0.0f, 10.0f, 0.0f });
+                manShader.set("light.ambient", glm::vec3{ 0.5f, 0.5f, 0.5f });
+                manShader.set("light.diffuse", glm::vec3{ 0.4f, 0.4f, 0.4f });
+                manShader.set("light.specular", glm::vec3{ 1.0f, 1.0f, 1.0f });
+
+                auto model = glm::mat4{ 1.0 };
+                model = glm::rotate(model, glm::radians(currentFrame * 10), glm::vec3{ 0.0, 1.0, 0.0 });
+                model = glm::scale(model, { 0.2, 0.2, 0.2 });
+
+                manShader.set("model", model);
+                manShader.set("view", view);
+                manShader.set("projection", projection);
+                manShader.set("viewPos", camera.Position);
+
+                manShader.set("skybox", 4);
+                glActiveTexture(GL_TEXTURE4);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+                modelInstance.Draw(manShader);
+            }
+            {
+                // skybox
+                glDepthFunc(GL_LEQUAL);
+                skyboxShader.use();
+                auto skyboxView = glm::mat4(glm::mat3(view));
+                skyboxShader.set("view", skyboxView);
+                skyboxShader.set("projection", projection);
+                glBindVertexArray(skyboxVAO);
+                glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+            }
         }
 
         // Swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
+        gl_state::shared().end_frame();
+        gl_objects::shared().end_frame();
         glfwPollEvents();
     }
 
@@ -379,7 +423,12 @@ int main()
     glDeleteBuffers(1, &quadVBO);
 
 
-    glfwTerminate();
+    gl_state::shared().report();
+    gl_objects::shared().report();
+    gpu_arena::vertices().report();
+    gpu_arena::indices().report();
+    gpu_memory::shared().report();
+    gpu_memory::shared().save_json(PROJECT_NAME "_gpu_memory.json");
     return 0;
 }
 
@@ -435,8 +484,11 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 
 unsigned int loadTexture(const std::filesystem::path& path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // shared with every Model and helper in the process, only the first request decodes the file
+    const auto [textureID, created] = texture_registry::shared().acquire(path);
+    if (!created)
+        return textureID;
+    const gpu_memory::owner_scope owner{ path.generic_string() };
 
     int width, height, nrComponents;
     if (const auto data = ::stbi_load(path.generic_string().c_str(), &width, &height, &nrComponents, 0))
@@ -470,34 +522,3 @@ unsigned int loadTexture(const std::filesystem::path& path)
 
     return textureID;
 }
-
-unsigned int loadCubemap(const std::vector<std::filesystem::path>& faces_path)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces_path.size(); i++)
-    {
-        if (unsigned char* data = stbi_load(faces_path[i].generic_string().c_str(), &width, &height, &nrChannels, 0))
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
-            );
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cube map texture failed to load at path: " << faces_path[i] << '\n';
-            stbi_image_free(data);
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
-}
\ No newline at end of file
@@ -9,7 +9,18 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shader.hpp"
+#include "shader_variants.hpp"
+#include "program_cache.hpp"
+#include "parallel_compile.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
+#include "gl_state.hpp"
+#include "gl_handle.hpp"
+#include "gpu_arena.hpp"
+#include "gpu_memory.hpp"
+#include "render_queue.hpp"
 #include "camera.hpp"
+#include "texture_registry.hpp"
 #include "model.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -33,6 +44,13 @@ bool stopRotatePressed = false;
 bool pcfEnabled = false;
 bool pcfKeyPressed = false;
 
+// toggles of shaders/shadow.glsl and shader.vs, the variants of the lit shaders are compiled with them
+enum shadow_feature : std::uint32_t
+{
+    PCF = 1 << 0,
+    REVERSE_NORMALS = 1 << 1,
+};
+
 Camera camera{{0.0f, 0.0f, 3.0f}};
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -41,8 +59,8 @@ void processInput(GLFWwindow* window);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 unsigned int loadTexture(const std::filesystem::path&);
 
-void renderScene(const Shader&);
-void renderCube();
+void submitScene(render_queue&, const Shader& room, const Shader& cubes, const render_queue::material*);
+unsigned int cubeVertexArray();
 void renderQuad();
 
 
@@ -51,7 +69,7 @@ int main()
     //-------------------------------------
     // glfw: initialize and configure
     //-------------------------------------
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -68,7 +86,6 @@ int main()
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -85,6 +102,13 @@ int main()
         std::cout << "Failed to initialize GLAD\n";
         return -1;
     }
+    // drop redundant state changes, counted per frame
+    gl_state::shared().install();
+    // record the storage of every buffer, texture and renderbuffer, owned by the demo unless a scope says otherwise
+    gpu_memory::shared().install();
+    const gpu_memory::owner_scope owner{ PROJECT_NAME };
+    // the shaders below are submitted together and checked at their first use
+    parallel_compile::shared().enable(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 
     //-------------------------------------
     // Create shader
@@ -108,7 +132,8 @@ int main()
                 std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/depth.gs"
             }
             );
-    Shader defaultShader(
+    shader_variants defaultShaders(
+            { "PCF", "REVERSE_NORMALS" },
             shader_entity<GL_VERTEX_SHADER>{
                 std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/shader.vs"
             },
@@ -124,7 +149,8 @@ int main()
                 std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/light_cube.fs"
             }
             );
-    Shader manShader(
+    shader_variants manShaders(
+            { "PCF" },
             shader_entity<GL_VERTEX_SHADER>{
                 std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/man.vs"
             },
@@ -132,8 +158,16 @@ int main()
                 std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/man.fs"
             }
             );
+    // the room is lit from inside with reversed normals, the cubes as they are, with and without pcf
+    defaultShaders.prepare(PCF | REVERSE_NORMALS);
+    manShaders.prepare(PCF);
+    // from program_cache/ when an earlier run left the binaries there, compare with a run after deleting it.
+    // the programs compiled are only submitted here, time to first frame includes waiting for them
+    report_startup("shaders submitted");
+    program_cache::shared().report();
 
-    Model modelInstance{std::filesystem::current_path() / "../../../../resource/zzz/joe.pmx"};
+    // packed as well, every shadow face draws the whole model with one call
+    Model modelInstance{std::filesystem::current_path() / "../../../../resource/zzz/joe.pmx", false, { .packMeshes = true }};
 
     unsigned int woodTexture = loadTexture(std::filesystem::current_path() / "../../../../resource/textures/wood.png");
 
@@ -163,6 +197,7 @@ int main()
     // attach depth texture as FBO's depth buffer
     glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
     glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap, 0);
+    gpu_memory::shared().set_owner(gpu_memory::kind::texture, depthCubemap, "shadow pass depth cubemap");
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -170,11 +205,23 @@ int main()
     //--------------------------------------
     // global opengl setting
     //--------------------------------------
-    defaultShader.use();
-    defaultShader.set("diffuseTexture", 0);
-    defaultShader.set("depthMap", 1);
+    defaultShaders.on_first_use([](const Shader& shader) {
+        shader.set("diffuseTexture", 0);
+        shader.set("depthMap", 1);
+    });
+
+    manShaders.on_first_use([](const Shader& shader) { shader.set("depthMap", 3); });
 
-    manShader.set("depthMap", 3);
+    // wood on unit 0, the depth cube map on unit 1, for the samplers set above
+    const render_queue::material sceneMaterial{ { { 0, GL_TEXTURE_2D, woodTexture }, { 1, GL_TEXTURE_CUBE_MAP, depthCubemap } } };
+    render_queue shadowQueue, cameraQueue;
+
+    // handles of the depth pass uniforms, written by index every frame and uploaded together by its first use
+    std::array<shader_parameter<glm::mat4>, 6> shadowMatrices;
+    for (unsigned int i = 0; i < 6; ++i)
+        shadowMatrices[i] = simpleDepthShader.parameter<glm::mat4>(std::format("shadowMatrices[{}]", i));
+    const auto depthFarPlane = simpleDepthShader.parameter<float>("far_plane");
+    const auto depthLightPos = simpleDepthShader.parameter<glm::vec3>("lightPos");
 
     // lighting info
     // -------------
@@ -231,14 +278,15 @@ int main()
         glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
         glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
             glClear(GL_DEPTH_BUFFER_BIT);
-            simpleDepthShader.use();
             for (unsigned int i = 0; i < 6; ++i)
-                simpleDepthShader.set("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
-            simpleDepthShader.set("far_plane", far_plane);
-            simpleDepthShader.set("lightPos", lightPos);
-            renderScene(simpleDepthShader);
-            simpleDepthShader.set("model", man_model);
-            modelInstance.Draw(simpleDepthShader);
+                simpleDepthShader.write(shadowMatrices[i], shadowTransforms[i]);
+            simpleDepthShader.write(depthFarPlane, far_plane);
+            simpleDepthShader.write(depthLightPos, lightPos);
+            shadowQueue.begin(lightPos, far_plane);
+            submitScene(shadowQueue, simpleDepthShader, simpleDepthShader, nullptr);
+            // same level as the camera pass, so the model shadows itself consistently
+            modelInstance.SubmitPacked(shadowQueue, simpleDepthShader, camera, man_model, SCR_HEIGHT, { .cull = true });
+            shadowQueue.flush();
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
         // 2. render scene as normal 
@@ -248,23 +296,22 @@ int main()
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
                 static_cast<float>(SCR_WIDTH) / static_cast<float>(SCR_HEIGHT), 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
-        defaultShader.use();
-        defaultShader.set("projection", projection);
-        defaultShader.set("view", view);
-        defaultShader.set("lightPos", lightPos);
-        defaultShader.set("viewPos", camera.Position);
-        defaultShader.set("pcfEnabled", pcfEnabled);
-        defaultShader.set("far_plane", far_plane);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, woodTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
-        renderScene(defaultShader);
-
-        // render model
+        const std::uint32_t pcf = pcfEnabled ? PCF : 0u;
+        const Shader& defaultShader = defaultShaders.get(pcf);
+        const Shader& roomShader = defaultShaders.get(pcf | REVERSE_NORMALS);
+        const Shader& manShader = manShaders.get(pcf);
+        for (const Shader* shader : { &defaultShader, &roomShader })
+        {
+            shader->set("projection", projection);
+            shader->set("view", view);
+            shader->set("lightPos", lightPos);
+            shader->set("viewPos", camera.Position);
+            shader->set("far_plane", far_plane);
+        }
+
+        // model
         manShader.set("viewPos", camera.Position);
         manShader.set("far_plane", far_plane);
-        manShader.set("pcfEnabled", pcfEnabled);
         manShader.set("light.position", lightPos);
         manShader.set("light.ambient", glm::vec3{0.5f, 0.5f, 0.5f});
         manShader.set("light.diffuse", glm::vec3{0.4f, 0.4f, 0.4f});
@@ -274,18 +321,21 @@ int main()
         manShader.set("light.quadratic", 0.032f);
         manShader.set("projection", projection);
         manShader.set("view", view);
-        manShader.set("model", man_model);
-        glActiveTexture(GL_TEXTURE3);   // start from 3
+        // the mesh textures take the units from 0, the depth cube map stays on 3 for the whole pass
+        glActiveTexture(GL_TEXTURE3);
         glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
-        modelInstance.Draw(manShader);
 
-        // render lightcube 
-        lightSrcShader.use();
+        // lightcube
         lightSrcShader.set("projection", projection);
         lightSrcShader.set("view", view);
-        lightSrcShader.set("model", light_model);
         lightSrcShader.set("cubeColor", glm::vec3{1.0, 1.0, 1.0});
-        renderCube();
+
+        cameraQueue.begin(camera.Position, 100.0f);
+        submitScene(cameraQueue, roomShader, defaultShader, &sceneMaterial);
+        // meshes outside the view are left out of the camera pass, the shadow faces still draw them
+        modelInstance.Submit(cameraQueue, manShader, frustum{ projection * view }, camera, man_model, SCR_HEIGHT, { .cull = true });
+        cameraQueue.submit(lightSrcShader, nullptr, cubeVertexArray(), GL_TRIANGLES, 0, 36, light_model, { .cull = true });
+        cameraQueue.flush();
 
         // render debug
         //depthViewShader.use();
@@ -297,10 +347,25 @@ int main()
 
         // Swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
+        gl_state::shared().end_frame();
+        gl_objects::shared().end_frame();
+        cull_counters::shared().end_frame();
         glfwPollEvents();
     }
 
-    glfwTerminate();
+    gl_state::shared().report();
+    cull_counters::shared().report();
+    gl_objects::shared().report();
+    gpu_arena::vertices().report();
+    gpu_arena::indices().report();
+    gpu_memory::shared().report();
+    parallel_compile::shared().report();
+    defaultShaders.report("default");
+    manShaders.report("man");
+    gpu_memory::shared().save_json(PROJECT_NAME "_gpu_memory.json");
+    shadowQueue.report("shadow pass");
+    cameraQueue.report("camera pass");
     return 0;
 }
 
@@ -308,54 +373,44 @@ int main()
 // renders the 3D scene
 // --------------------
 // meshes
-void renderScene(const Shader& shader)
+void submitScene(render_queue& queue, const Shader& room, const Shader& shader, const render_queue::material* material)
 {
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    // ------------------------------------------------------------------
     // room cube
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::scale(model, glm::vec3(5.0f));
-    shader.set("model", model);
     // note that we disable culling here since we render 'inside' the cube instead of the usual 'outside' which throws off the normal culling methods.
-    glDisable(GL_CULL_FACE);
-    shader.set("reverse_normals", true); // A small little hack to invert normals when drawing cube from the inside so lighting still works.
-    renderCube();
-    shader.set("reverse_normals", false); // and of course disable it
-    glEnable(GL_CULL_FACE);
-    // cubes
+    // The room shader inverts the normals so lighting still works from the inside.
+    queue.submit(room, material, cubeVertexArray(), GL_TRIANGLES, 0, 36, model, { .cull = false });
+    // cubes, culled and with their normals as they are
+    const render_queue::options cubes{ .cull = true };
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(4.0f, -3.5f, 0.0));
     model = glm::scale(model, glm::vec3(0.5f));
-    shader.set("model", model);
-    renderCube();
+    queue.submit(shader, material, cubeVertexArray(), GL_TRIANGLES, 0, 36, model, cubes);
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(2.0f, 3.0f, 1.0));
     model = glm::scale(model, glm::vec3(0.75f));
-    shader.set("model", model);
-    renderCube();
+    queue.submit(shader, material, cubeVertexArray(), GL_TRIANGLES, 0, 36, model, cubes);
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-3.0f, -1.0f, 0.0));
     model = glm::scale(model, glm::vec3(0.5f));
-    shader.set("model", model);
-    renderCube();
+    queue.submit(shader, material, cubeVertexArray(), GL_TRIANGLES, 0, 36, model, cubes);
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-1.5f, 1.0f, 1.5));
     model = glm::scale(model, glm::vec3(0.5f));
-    shader.set("model", model);
-    renderCube();
+    queue.submit(shader, material, cubeVertexArray(), GL_TRIANGLES, 0, 36, model, cubes);
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-1.5f, 2.0f, -3.0));
     model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
     model = glm::scale(model, glm::vec3(0.75f));
-    shader.set("model", model);
-    renderCube();
+    queue.submit(shader, material, cubeVertexArray(), GL_TRIANGLES, 0, 36, model, cubes);
 }
 
-// renderCube() renders a 1x1 3D cube in NDC.
-// -------------------------------------------------
+// cubeVertexArray() returns a 1x1 3D cube in NDC, 36 vertices, created on the first call
+// -------------------------------------------------------------------------------------
 unsigned int cubeVAO = 0;
 unsigned int cubeVBO = 0;
-void renderCube()
+unsigned int cubeVertexArray()
 {
     // initialize (if necessary)
     if (cubeVAO == 0)
@@ -420,10 +475,7 @@ void renderCube()
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
     }
-    // render Cube
-    glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    return cubeVAO;
 }
 
 // renderQuad() renders a 1x1 XY quad in NDC
@@ -504,8 +556,11 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 
 unsigned int loadTexture(const std::filesystem::path& path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // shared with every Model and helper in the process, only the first request decodes the file
+    const auto [textureID, created] = texture_registry::shared().acquire(path);
+    if (!created)
+        return textureID;
+    const gpu_memory::owner_scope owner{ path.generic_string() };
 
     int width, height, nrComponents;
     if (const auto data = ::stbi_load(path.generic_string().c_str(), &width, &height, &nrComponents, 0))
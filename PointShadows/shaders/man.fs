@@ -32,55 +32,8 @@ uniform vec3 viewPos;
 uniform float far_plane;
 
 uniform bool shadows;
-uniform bool pcfEnabled;
 
-vec3 sampleOffsetDirections[20] = vec3[]
-(
-   vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
-   vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
-   vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
-   vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
-   vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
-);
-
-float ShadowCalculation(vec3 fragPos)
-{
-    float shadow = 0.0;
-    int samples = 20;
-    float viewDistance = length(viewPos - fragPos);
-    //float diskRadius = 0.05;
-    float diskRadius = (1.0 + (viewDistance / far_plane)) / 25.0;
-
-    // Get vector between fragment position and light position
-    vec3 fragToLight = fragPos - light.position;
-    // Now get current linear depth as the length between the fragment and light position
-    float currentDepth = length(fragToLight);
-
-    if (!pcfEnabled)
-    {
-        float bias = 0.005;
-        // Use the light to fragment vector to sample from the depth map    
-        float closestDepth = texture(depthMap, fragToLight).r;
-        // It is currently in linear range between [0,1]. Re-transform back to original value
-        closestDepth *= far_plane;
-        // Now test for shadows
-        shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
-    }
-    else 
-    {
-        float bias = 0.15;
-        for(int i = 0; i < samples; ++i)
-        {
-            float closestDepth = texture(depthMap, fragToLight + sampleOffsetDirections[i] * diskRadius).r;
-            closestDepth *= far_plane;   // undo mapping [0;1]
-            if(currentDepth - bias > closestDepth)
-                shadow += 1.0;
-        }
-        shadow /= float(samples);
-    }
-
-    return shadow;
-}
+#include "shadow.glsl"
 
 void shadowDebug(vec3 fragPos)
 {
@@ -105,7 +58,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
     // calculate shadow
-    float shadow = shadows ? ShadowCalculation(Position) : 0.0;
+    float shadow = shadows ? ShadowCalculation(Position, light.position) : 0.0;
     // combine results
     vec3 ambient = light.ambient * vec3(texture(material1.diffuse, TexCoords));
     vec3 diffuse = light.diffuse * diff * vec3(texture(material1.diffuse, TexCoords));
@@ -14,16 +14,6 @@ uniform vec3 lightPos;
 uniform vec3 viewPos;
 
 uniform float far_plane;
-uniform bool pcfEnabled;
-
-vec3 sampleOffsetDirections[20] = vec3[]
-(
-   vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
-   vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
-   vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
-   vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
-   vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
-);
 
 float random(vec4 seed4)
 {
@@ -31,44 +21,7 @@ float random(vec4 seed4)
    return fract(sin(dot_product) * 43758.5453);
 }
 
-float ShadowCalculation(vec3 fragPos)
-{
-    float shadow = 0.0;
-    int samples = 20;
-    float viewDistance = length(viewPos - fragPos);
-    //float diskRadius = 0.05;
-    float diskRadius = (1.0 + (viewDistance / far_plane)) / 25.0;
-
-    // Get vector between fragment position and light position
-    vec3 fragToLight = fragPos - lightPos;
-    // Now get current linear depth as the length between the fragment and light position
-    float currentDepth = length(fragToLight);
-
-    if (!pcfEnabled)
-    {
-        float bias = 0.005;
-        // Use the light to fragment vector to sample from the depth map    
-        float closestDepth = texture(depthMap, fragToLight).r;
-        // It is currently in linear range between [0,1]. Re-transform back to original value
-        closestDepth *= far_plane;
-        // Now test for shadows
-        shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
-    }
-    else 
-    {
-        float bias = 0.15;
-        for(int i = 0; i < samples; ++i)
-        {
-            float closestDepth = texture(depthMap, fragToLight + sampleOffsetDirections[i] * diskRadius).r;
-            closestDepth *= far_plane;   // undo mapping [0;1]
-            if(currentDepth - bias > closestDepth)
-                shadow += 1.0;
-        }
-        shadow /= float(samples);
-    }
-
-    return shadow;
-}
+#include "shadow.glsl"
 
 void shadowDebug(vec3 fragPos)
 {
@@ -101,7 +54,7 @@ void main()
     // calculate shadow
     if (true) 
     {
-        float shadow =  ShadowCalculation(fs_in.FragPos);                      
+        float shadow =  ShadowCalculation(fs_in.FragPos, lightPos);                      
         vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;    
     
         FragColor = vec4(lighting, 1.0);
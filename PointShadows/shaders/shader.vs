@@ -15,15 +15,15 @@ uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
 
-uniform bool reverse_normals;
-
 void main()
 {
     vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
-    if(reverse_normals) // a slight hack to make sure the outer large cube displays lighting from the 'inside' instead of the default 'outside'.
-        vs_out.Normal = transpose(inverse(mat3(model))) * (-1.0 * aNormal);
-    else
-        vs_out.Normal = transpose(inverse(mat3(model))) * aNormal;
+    // a slight hack to make sure the outer large cube displays lighting from the 'inside' instead of the default 'outside'.
+#ifdef REVERSE_NORMALS
+    vs_out.Normal = transpose(inverse(mat3(model))) * (-1.0 * aNormal);
+#else
+    vs_out.Normal = transpose(inverse(mat3(model))) * aNormal;
+#endif
     vs_out.TexCoords = aTexCoords;
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+// shadow of a fragment in the omnidirectional depth cube map, included by shader.fs and man.fs after they declare
+// uniform samplerCube depthMap, vec3 viewPos and float far_plane. Specialized by shader_variants:
+//   PCF  20 taps around the light to fragment vector instead of one
+
+vec3 sampleOffsetDirections[20] = vec3[]
+(
+   vec3( 1,  1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1,  1,  1), 
+   vec3( 1,  1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1,  1, -1),
+   vec3( 1,  1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1,  1,  0),
+   vec3( 1,  0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1,  0, -1),
+   vec3( 0,  1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0,  1, -1)
+);
+
+float ShadowCalculation(vec3 fragPos, vec3 lightPosition)
+{
+    float shadow = 0.0;
+    int samples = 20;
+    float viewDistance = length(viewPos - fragPos);
+    //float diskRadius = 0.05;
+    float diskRadius = (1.0 + (viewDistance / far_plane)) / 25.0;
+
+    // Get vector between fragment position and light position
+    vec3 fragToLight = fragPos - lightPosition;
+    // Now get current linear depth as the length between the fragment and light position
+    float currentDepth = length(fragToLight);
+
+#ifndef PCF
+    {
+        float bias = 0.005;
+        // Use the light to fragment vector to sample from the depth map    
+        float closestDepth = texture(depthMap, fragToLight).r;
+        // It is currently in linear range between [0,1]. Re-transform back to original value
+        closestDepth *= far_plane;
+        // Now test for shadows
+        shadow = currentDepth - bias > closestDepth ? 1.0 : 0.0;
+    }
+#else
+    {
+        float bias = 0.15;
+        for(int i = 0; i < samples; ++i)
+        {
+            float closestDepth = texture(depthMap, fragToLight + sampleOffsetDirections[i] * diskRadius).r;
+            closestDepth *= far_plane;   // undo mapping [0;1]
+            if(currentDepth - bias > closestDepth)
+                shadow += 1.0;
+        }
+        shadow /= float(samples);
+    }
+#endif
+
+    return shadow;
+}
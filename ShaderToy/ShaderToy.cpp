@@ -4,6 +4,8 @@
 #include <chrono>
 
 #include "Shader.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
@@ -20,7 +22,7 @@ int main()
     //******************************
     // window setup
     //******************************
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -28,7 +30,6 @@ int main()
     const auto window = glfwCreateWindow(800, 800, "LearnOpenGL", nullptr, nullptr);
     if (!window) {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -127,6 +128,7 @@ int main()
 
         // swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
         glfwPollEvents();
     }
 
@@ -135,6 +137,5 @@ int main()
     glDeleteVertexArrays(2,vao);
     glDeleteBuffers(2, vbo);
 
-    glfwTerminate();
 	return 0;
 }
\ No newline at end of file
@@ -9,7 +9,19 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include "shader.hpp"
+#include "shader_variants.hpp"
+#include "program_cache.hpp"
+#include "parallel_compile.hpp"
+#include "startup_timer.hpp"
+#include "glfw_session.hpp"
+#include "gl_state.hpp"
+#include "gl_handle.hpp"
+#include "gpu_arena.hpp"
+#include "gpu_memory.hpp"
+#include "frame_uniforms.hpp"
+#include "render_queue.hpp"
 #include "camera.hpp"
+#include "texture_registry.hpp"
 #include "model.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -39,14 +51,22 @@ bool stopRotatePressed = false;
 bool bias = false;
 bool biasPressed = false;
 
+// toggles of shaders/shadow.glsl, the variants of the lit shaders are compiled with them
+enum shadow_feature : std::uint32_t
+{
+    POISSON = 1 << 0,
+    BIAS = 1 << 1,
+};
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void processInput(GLFWwindow* window);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 unsigned int loadTexture(const std::filesystem::path&);
 
-void renderScene(const Shader&);
-void renderCube();
+void submitScene(render_queue&, const Shader&, const render_queue::material*);
+unsigned int cubeVertexArray();
+unsigned int planeVertexArray();
 void renderQuad();
 
 
@@ -55,7 +75,7 @@ int main()
     //-------------------------------------
     // glfw: initialize and configure
     //-------------------------------------
-    glfwInit();
+    const glfw_session glfw;
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -72,7 +92,6 @@ int main()
     if (window == nullptr)
     {
         std::cout << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -89,6 +108,13 @@ int main()
         std::cout << "Failed to initialize GLAD\n";
         return -1;
     }
+    // drop redundant state changes, counted per frame
+    gl_state::shared().install();
+    // record the storage of every buffer, texture and renderbuffer, owned by the demo unless a scope says otherwise
+    gpu_memory::shared().install();
+    const gpu_memory::owner_scope owner{ PROJECT_NAME };
+    // the shaders below are submitted together and checked at their first use
+    parallel_compile::shared().enable(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 
     //-------------------------------------
     // Create shader
@@ -101,7 +127,8 @@ int main()
         shader_entity<GL_VERTEX_SHADER>{std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/depth.vs" },
         shader_entity<GL_FRAGMENT_SHADER >{std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/depth.fs"}
     );
-    Shader entityShader(
+    shader_variants entityShaders(
+        { "POISSON", "BIAS" },
         shader_entity<GL_VERTEX_SHADER>{std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/shader.vs" },
         shader_entity<GL_FRAGMENT_SHADER >{std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/shader.fs"}
     );
@@ -109,15 +136,24 @@ int main()
         shader_entity<GL_VERTEX_SHADER>{std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/light_cube.vs" },
         shader_entity<GL_FRAGMENT_SHADER >{std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/light_cube.fs"}
     );
-    Shader manShader(
+    shader_variants manShaders(
+        { "POISSON", "BIAS" },
         shader_entity<GL_VERTEX_SHADER> { std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/man.vs"},
         shader_entity<GL_FRAGMENT_SHADER> {std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/man.fs"}
     );
     Shader axisShader(
         shader_entity<GL_VERTEX_SHADER> {std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/axis.vs"},
         shader_entity<GL_FRAGMENT_SHADER> { std::filesystem::current_path() / "../../../../" PROJECT_NAME "/shaders/axis.fs"});
+    // every toggle combination up front, P and B switch programs instead of branching per fragment
+    entityShaders.prepare(POISSON | BIAS);
+    manShaders.prepare(POISSON | BIAS);
+    // from program_cache/ when an earlier run left the binaries there, compare with a run after deleting it.
+    // the programs compiled are only submitted here, time to first frame includes waiting for them
+    report_startup("shaders submitted");
+    program_cache::shared().report();
 
-    Model modelInstance{ std::filesystem::current_path() / "../../../../resource/zzz/joe.pmx" };
+    // packed as well, the depth pass draws the whole model with one call
+    Model modelInstance{ std::filesystem::current_path() / "../../../../resource/zzz/joe.pmx", false, { .packMeshes = true } };
 
     unsigned int woodTexture = loadTexture(std::filesystem::current_path() / "../../../../resource/textures/wood.png");
 
@@ -168,6 +204,7 @@ int main()
     // attach depth texture as FBO's depth buffer
     glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
+    gpu_memory::shared().set_owner(gpu_memory::kind::texture, depthMap, "shadow pass depth map");
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -178,10 +215,16 @@ int main()
     glEnable(GL_DEPTH_TEST);
     depthViewShader.set("depthMap", 0);
 
-    entityShader.set("diffuseTexture", 0);
-    entityShader.set("shadowMap", 1);
+    entityShaders.on_first_use([](const Shader& shader) {
+        shader.set("diffuseTexture", 0);
+        shader.set("shadowMap", 1);
+    });
 
-    manShader.set("shadowMap", 3);
+    manShaders.on_first_use([](const Shader& shader) { shader.set("shadowMap", 3); });
+
+    // wood on unit 0, the shadow map on unit 1, for the samplers set above
+    const render_queue::material sceneMaterial{ { { 0, GL_TEXTURE_2D, woodTexture }, { 1, GL_TEXTURE_2D, depthMap } } };
+    render_queue shadowQueue, cameraQueue;
 
     // lighting info
     // -------------
@@ -202,6 +245,8 @@ int main()
         // input
         // -----
         processInput(window);
+        // the Object blocks of both passes and the Frame block of the camera pass are written from here on
+        frame_uniforms::shared().begin_frame();
 
         // render
         // ------
@@ -228,16 +273,15 @@ int main()
         auto depthMVP = lightProjection * lightView ;
 
         // render scene from light's point of view
-        simpleDepthShader.use();
         simpleDepthShader.set("lightSpaceMatrix", depthMVP);
         glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
         glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
             glClear(GL_DEPTH_BUFFER_BIT);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, woodTexture);
-            renderScene(simpleDepthShader);
-            simpleDepthShader.set("model", man_model);
-            modelInstance.Draw(simpleDepthShader);
+            shadowQueue.begin(lightPos, far_plane);
+            submitScene(shadowQueue, simpleDepthShader, nullptr);
+            // same level as the camera pass, so the model shadows itself consistently
+            modelInstance.SubmitPacked(shadowQueue, simpleDepthShader, camera, man_model, SCR_HEIGHT);
+            shadowQueue.flush();
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
         // reset viewport
@@ -245,55 +289,37 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // render real scene
-        entityShader.use();
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        entityShader.set("projection", projection);
-        entityShader.set("view", view);
-        entityShader.set("viewPos", camera.Position);
+        frame_uniforms::shared().set_frame(camera, projection, currentFrame);
+        const std::uint32_t features = (poisson ? POISSON : 0u) | (bias ? BIAS : 0u);
+        const Shader& entityShader = entityShaders.get(features);
+        const Shader& manShader = manShaders.get(features);
         entityShader.set("lightDirection", lightPos - glm::vec3{ 0.0, 0.0, 0.0 });
         entityShader.set("lightSpaceMatrix", depthMVP);
-        entityShader.set("poisson", poisson);
-        entityShader.set("biasEnabled", bias);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, woodTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, depthMap);
-        renderScene(entityShader);
 
-        manShader.set("viewPos", camera.Position);
         manShader.set("lightPos", lightPos);
         manShader.set("light.direction",  lightPos - glm::vec3{ 0.0, 0.0, 0.0 });
         manShader.set("light.ambient", glm::vec3{ 0.5f, 0.5f, 0.5f });
         manShader.set("light.diffuse", glm::vec3{ 0.4f, 0.4f, 0.4f });
         manShader.set("light.specular", glm::vec3{ 1.0f, 1.0f, 1.0f });
-        manShader.set("projection", projection);
         manShader.set("lightSpaceMatrix", depthMVP);
-        manShader.set("view", view);
-        manShader.set("model", man_model);
-        manShader.set("poisson", poisson);
-        manShader.set("biasEnabled", bias);
+        // the mesh textures take the units from 0, the shadow map stays on 3 for the whole pass
         glActiveTexture(GL_TEXTURE3);
         glBindTexture(GL_TEXTURE_2D, depthMap);
-        modelInstance.Draw(manShader);
 
-        lightSrcShader.use();
-        lightSrcShader.set("projection", projection);
-        lightSrcShader.set("view", view);
+        lightSrcShader.set("cubeColor", glm::vec3{ 1.0,1.0,1.0 });
         auto model = glm::mat4{1.0f};
         model = glm::translate(model, lightPos);
         model = glm::scale(model, {0.1, 0.1, 0.1});
-        lightSrcShader.set("model", model);
-        lightSrcShader.set("cubeColor", glm::vec3{ 1.0,1.0,1.0 });
-        renderCube();
+
+        cameraQueue.begin(camera.Position, 100.0f);
+        submitScene(cameraQueue, entityShader, &sceneMaterial);
+        // meshes outside the view are left out of the camera pass, the shadow pass still draws them
+        modelInstance.Submit(cameraQueue, manShader, frustum::of(camera, projection), camera, man_model, SCR_HEIGHT);
+        cameraQueue.submit(lightSrcShader, nullptr, cubeVertexArray(), GL_TRIANGLES, 0, 36, model);
         // axis
-        model = glm::mat4(1.0f);
-        axisShader.use();
-        axisShader.set("projection", projection);
-        axisShader.set("view", view);
-        axisShader.set("model", model);
-        glBindVertexArray(axis_vao);
-        glDrawArrays(GL_LINES, 0, 6);
+        cameraQueue.submit(axisShader, nullptr, axis_vao, GL_LINES, 0, 6, glm::mat4(1.0f), { .layer = 1 });
+        cameraQueue.flush();
 
         // render debug
         depthViewShader.use();
@@ -305,77 +331,92 @@ int main()
 
         // Swap frame buffer
         glfwSwapBuffers(window);
+        report_first_frame();
+        gl_state::shared().end_frame();
+        gl_objects::shared().end_frame();
+        cull_counters::shared().end_frame();
         glfwPollEvents();
     }
 
-    glfwTerminate();
+    gl_state::shared().report();
+    cull_counters::shared().report();
+    gl_objects::shared().report();
+    gpu_arena::vertices().report();
+    gpu_arena::indices().report();
+    gpu_memory::shared().report();
+    parallel_compile::shared().report();
+    entityShaders.report("entity");
+    manShaders.report("man");
+    gpu_memory::shared().save_json(PROJECT_NAME "_gpu_memory.json");
+    shadowQueue.report("shadow pass");
+    cameraQueue.report("camera pass");
+    frame_uniforms::shared().report();
     return 0;
 }
 
 
-// renders the 3D scene
-// --------------------
-// meshes
-void renderScene(const Shader& shader)
+// queues the 3D scene
+// -------------------
+void submitScene(render_queue& queue, const Shader& shader, const render_queue::material* material)
 {
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    // ------------------------------------------------------------------
-    // meshes
-    unsigned int planeVAO;
-    float planeVertices[] = {
-        // positions            // normals         // texcoords
-        -25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,   0.0f, 25.0f,
-        -25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,   0.0f,  0.0f,
-         25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,  25.0f,  0.0f,
-
-        -25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,   0.0f, 25.0f,
-         25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,  25.0f,  0.0f,
-         25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,  25.0f, 25.0f
-    };
-    // plane VAO
-    unsigned int planeVBO;
-    glGenVertexArrays(1, &planeVAO);
-    glGenBuffers(1, &planeVBO);
-    glBindVertexArray(planeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glBindVertexArray(0);
-
     // floor
     glm::mat4 model = glm::mat4(1.0f);
-    shader.set("model", model);
-    glBindVertexArray(planeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    queue.submit(shader, material, planeVertexArray(), GL_TRIANGLES, 0, 6, model);
     // cubes
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(0.0f, 1.5f, 0.0));
     model = glm::scale(model, glm::vec3(0.5f));
-    shader.set("model", model);
-    renderCube();
+    queue.submit(shader, material, cubeVertexArray(), GL_TRIANGLES, 0, 36, model);
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(2.0f, 0.0f, 1.0));
     model = glm::scale(model, glm::vec3(0.5f));
-    shader.set("model", model);
-    renderCube();
+    queue.submit(shader, material, cubeVertexArray(), GL_TRIANGLES, 0, 36, model);
     model = glm::mat4(1.0f);
     model = glm::translate(model, glm::vec3(-1.0f, 0.0f, 2.0));
     model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
     model = glm::scale(model, glm::vec3(0.25));
-    shader.set("model", model);
-    renderCube();
+    queue.submit(shader, material, cubeVertexArray(), GL_TRIANGLES, 0, 36, model);
 }
 
-// renderCube() renders a 1x1 3D cube in NDC.
-// -------------------------------------------------
+// planeVertexArray() returns the floor, created on the first call
+// ----------------------------------------------------------------
+unsigned int planeVAO = 0;
+unsigned int planeVBO = 0;
+unsigned int planeVertexArray()
+{
+    if (planeVAO == 0)
+    {
+        float planeVertices[] = {
+            // positions            // normals         // texcoords
+            -25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,   0.0f, 25.0f,
+            -25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,   0.0f,  0.0f,
+             25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,  25.0f,  0.0f,
+
+            -25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,   0.0f, 25.0f,
+             25.0f, -0.5f,  25.0f,  0.0f, 1.0f, 0.0f,  25.0f,  0.0f,
+             25.0f, -0.5f, -25.0f,  0.0f, 1.0f, 0.0f,  25.0f, 25.0f
+        };
+        glGenVertexArrays(1, &planeVAO);
+        glGenBuffers(1, &planeVBO);
+        glBindVertexArray(planeVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+        glBindVertexArray(0);
+    }
+    return planeVAO;
+}
+
+// cubeVertexArray() returns a 1x1 3D cube in NDC, 36 vertices, created on the first call
+// -------------------------------------------------------------------------------------
 unsigned int cubeVAO = 0;
 unsigned int cubeVBO = 0;
-void renderCube()
+unsigned int cubeVertexArray()
 {
     // initialize (if necessary)
     if (cubeVAO == 0)
@@ -441,10 +482,7 @@ void renderCube()
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
     }
-    // render Cube
-    glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glBindVertexArray(0);
+    return cubeVAO;
 }
 
 // renderQuad() renders a 1x1 XY quad in NDC
@@ -561,8 +599,11 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 
 unsigned int loadTexture(const std::filesystem::path& path)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    // shared with every Model and helper in the process, only the first request decodes the file
+    const auto [textureID, created] = texture_registry::shared().acquire(path);
+    if (!created)
+        return textureID;
+    const gpu_memory::owner_scope owner{ path.generic_string() };
 
     int width, height, nrComponents;
     if (const auto data = ::stbi_load(path.generic_string().c_str(), &width, &height, &nrComponents, 0))
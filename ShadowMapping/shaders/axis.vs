@@ -4,13 +4,23 @@ layout (location = 1) in vec3 aColor;
 
 out vec3 Color;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec3 viewPos;
+    float time;
+};
+layout (std140) uniform Object
+{
+    mat4 model;
+    mat4 normalMatrix;
+};
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = viewProj * model * vec4(aPos, 1.0);
 	Color = aColor;
 
 }
\ No newline at end of file
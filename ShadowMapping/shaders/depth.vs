@@ -1,8 +1,12 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
+layout (std140) uniform Object
+{
+    mat4 model;
+    mat4 normalMatrix;
+};
 uniform mat4 lightSpaceMatrix;
-uniform mat4 model;
 
 void main()
 {
@@ -1,11 +1,21 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec3 viewPos;
+    float time;
+};
+layout (std140) uniform Object
+{
+    mat4 model;
+    mat4 normalMatrix;
+};
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = viewProj * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -8,16 +8,26 @@ out vec3 Position;
 out vec2 TexCoord;
 out vec4 FragPosLightSpace;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+layout (std140) uniform Frame
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec3 viewPos;
+    float time;
+};
+layout (std140) uniform Object
+{
+    mat4 model;
+    mat4 normalMatrix;
+};
 uniform mat4 lightSpaceMatrix;
 
 void main()
 {
     TexCoord = aTexCoord;
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = mat3(normalMatrix) * aNormal;
     Position = vec3(model * vec4(aPos, 1.0));
     FragPosLightSpace = lightSpaceMatrix * vec4(Position, 1.0);
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    gl_Position = viewProj * model * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -6,9 +6,9 @@ in vec3 Position;
 in vec2 TexCoords;
 
 struct Material {
-    sampler2D texture_diffuse1;
-    sampler2D texture_specular1;
-    sampler2D texture_reflection1;
+    sampler2D diffuse;
+    sampler2D specular;
+    sampler2D reflection;
     float shininess;
 }; 
 
@@ -24,7 +24,7 @@ uniform vec3 viewPos;
 uniform samplerCube skybox;
 
 uniform DirLight light;
-uniform Material material;
+uniform Material material1;
 
 void main()
 {             
@@ -33,18 +33,18 @@ void main()
     // reflection
     vec3 I = -viewDir;
     vec3 R = reflect(I, normal);
-    vec3 reflectMap = vec3(texture(material.texture_reflection1, TexCoords)); // where to reflect
+    vec3 reflectMap = vec3(texture(material1.reflection, TexCoords)); // where to reflect
     vec3 reflection = texture(skybox, R).rgb * reflectMap;
     // ambient
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
+    vec3 ambient = light.ambient * vec3(texture(material1.diffuse, TexCoords));
     // diffuse
     vec3 lightDir = normalize(light.direction);
     float diff_influence = max(dot(normal, lightDir), 0.0);
-    vec3 diffuse = light.diffuse * diff_influence *  vec3(texture(material.texture_diffuse1, TexCoords));
+    vec3 diffuse = light.diffuse * diff_influence *  vec3(texture(material1.diffuse, TexCoords));
     // specular
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec_influence = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
-    vec3 specular = light.specular * spec_influence * vec3(texture(material.texture_specular1, TexCoords));
+    vec3 specular = light.specular * spec_influence * vec3(texture(material1.specular, TexCoords));
     
     vec3 result =  ambient + diffuse + specular + reflection;
 